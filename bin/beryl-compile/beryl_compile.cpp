@@ -0,0 +1,98 @@
+#include <cstddef>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <boost/program_options.hpp>
+
+#include "beryl/read_zone.hpp"
+#include "beryl/zone_image.hpp"
+#include "common/version.hpp"
+
+int main(int argc, const char* argv[]) {
+  namespace po = boost::program_options;
+  po::variables_map vm;
+  try {
+    po::options_description opt_desc{"Options"};
+    // clang-format off
+    opt_desc.add_options()
+      ("help,h", "Print the help message")
+      ("version,v", "Print version")
+      ("output,o", po::value<std::string>(),
+       "The zone image file, defaults to the zone file name with `.zim` "
+       "appended")
+      ("threads,j",
+       po::value<std::size_t>()->default_value(
+           std::max(1U, std::thread::hardware_concurrency())),
+       "The number of threads parsing the zone file");
+    po::options_description hidden_desc;
+    hidden_desc.add_options()
+      ("zone", po::value<std::string>());
+    // clang-format on
+    po::options_description all_desc;
+    all_desc.add(opt_desc).add(hidden_desc);
+    po::positional_options_description pos_desc;
+    pos_desc.add("zone", 1);
+
+    po::store(po::command_line_parser(argc, argv)
+                  .options(all_desc)
+                  .positional(pos_desc)
+                  .run(),
+              vm);
+    po::notify(vm);
+
+    if (vm.find("help") != vm.end()) {
+      constexpr const char* desc_msg =
+          "Description:\n"
+          "  Compiles a zone file into a binary zone image, which the server\n"
+          "  maps into memory without parsing.\n\n"
+          "Usage:\n"
+          "  beryl-compile [options] <zone file>";
+      constexpr const char* example_msg =
+          "Examples:\n"
+          "  prompt> beryl-compile -o example.com.zim example.com.zone\n";
+      std::cout << desc_msg << "\n\n"
+                << opt_desc << "\n"
+                << example_msg << std::endl;
+      return 0;
+    }
+    if (vm.find("version") != vm.end()) {
+      std::cout << common::version << std::endl;
+      return 0;
+    }
+    if (vm.find("zone") == vm.end()) {
+      std::cerr << "no zone file is given" << std::endl;
+      return 1;
+    }
+  } catch (const po::error& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  const auto& zone = vm["zone"].as<std::string>();
+  auto output = vm.find("output") != vm.end() ? vm["output"].as<std::string>()
+                                              : zone + ".zim";
+  try {
+    beryl::zone_image_writer writer;
+    beryl::read_zone(zone, writer,
+                     std::max<std::size_t>(1, vm["threads"].as<std::size_t>()));
+    std::ofstream os(output, std::ios::binary | std::ios::trunc);
+    if (!os) {
+      throw std::runtime_error("can't open `" + output + "`");
+    }
+    writer.write(os);
+    os.close();
+    if (!os) {
+      throw std::runtime_error("can't write `" + output + "`");
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -1,22 +1,107 @@
+#include <pthread.h>
+#include <signal.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <boost/program_options.hpp>
 
+#include "beryl/query_responder.hpp"
+#include "beryl/tcp_server.hpp"
+#include "beryl/udp_server.hpp"
+#include "beryl/zone_config.hpp"
+#include "beryl/zone_replicas.hpp"
+#include "beryl/zone_table.hpp"
 #include "common/version.hpp"
 
 int main(int argc, const char* argv[]) {
+  std::vector<std::string> image_paths;
+  std::string config_path;
+  std::size_t thread_count = 0;
+  bool prerender = false;
+  bool numa_replicas = false;
+  beryl::udp_server_options server_options;
+  std::string io_engine;
+  std::size_t tcp_idle_timeout = 10000;
+  beryl::tcp_server_options tcp_options;
   try {
     namespace po = boost::program_options;
     po::options_description opt_desc{"Options"};
     // clang-format off
     opt_desc.add_options()
       ("help,h", "Print the help message")
-      ("version,v", "Print version");
+      ("version,v", "Print version")
+      ("zone-image,z",
+       po::value<std::vector<std::string>>(&image_paths)->composing(),
+       "A zone image made by beryl-compile to serve, can be repeated")
+      ("config,c", po::value<std::string>(&config_path),
+       "A configuration in the format of named.conf listing the zones "
+       "to serve")
+      ("threads,j",
+       po::value<std::size_t>(&thread_count)->default_value(
+           std::max(1U, std::thread::hardware_concurrency())),
+       "The number of threads loading the zones of the configuration")
+      ("prerender", po::bool_switch(&prerender),
+       "Render the answers of the zones of the configuration on loading "
+       "them")
+      ("address,a",
+       po::value<std::string>(&server_options.address)->default_value(
+           server_options.address),
+       "The address to serve the zones on")
+      ("port,p",
+       po::value<std::uint16_t>(&server_options.port)->default_value(
+           server_options.port),
+       "The port to serve the zones on over UDP and TCP")
+      ("server-threads",
+       po::value<std::size_t>(&server_options.thread_count)->default_value(0),
+       "The number of threads serving queries, each with a socket of its "
+       "own; zero for one per CPU")
+      ("batch-size",
+       po::value<std::size_t>(&server_options.batch_size)->default_value(
+           server_options.batch_size),
+       "The most datagrams received or sent with one system call")
+      ("io-engine", po::value<std::string>(&io_engine)->default_value("asio"),
+       "The way the threads exchange datagrams: `asio` or `io_uring`")
+      ("sqpoll", po::bool_switch(&server_options.sqpoll),
+       "With io_uring, let a kernel thread poll the submissions")
+      ("tcp-idle-timeout",
+       po::value<std::size_t>(&tcp_idle_timeout)->default_value(
+           tcp_idle_timeout),
+       "The milliseconds after which a TCP connection sending no queries "
+       "is closed")
+      ("tcp-max-connections",
+       po::value<std::size_t>(&tcp_options.max_connections)->default_value(
+           tcp_options.max_connections),
+       "The most TCP connections a thread keeps open")
+      ("no-pinning", po::bool_switch(),
+       "Don't pin the threads serving queries to CPUs")
+      ("numa-replicas", po::bool_switch(&numa_replicas),
+       "Keep a copy of the zones on every NUMA node for the threads "
+       "serving queries on the node");
     // clang-format on
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, opt_desc), vm);
     po::notify(vm);
+    server_options.pin_threads = !vm["no-pinning"].as<bool>();
+    tcp_options.address = server_options.address;
+    tcp_options.thread_count = server_options.thread_count;
+    tcp_options.pin_threads = server_options.pin_threads;
+    tcp_options.idle_timeout = std::chrono::milliseconds(tcp_idle_timeout);
+    if (io_engine == "io_uring") {
+      server_options.engine = beryl::io_engine::io_uring;
+    } else if (io_engine != "asio") {
+      throw po::validation_error(
+          po::validation_error::invalid_option_value, "io-engine", io_engine);
+    }
 
     if (vm.find("help") != vm.end()) {
       constexpr const char* desc_msg =
@@ -26,8 +111,8 @@ int main(int argc, const char* argv[]) {
           "  beryl [options]";
       constexpr const char* example_msg =
           "Examples:\n"
-          "  prompt> beryl\n"
-          "  No meaningfull functionality yet.\n";
+          "  prompt> beryl -c named.conf -p 8853\n"
+          "  prompt> beryl -z movie.edu.zim -p 8853\n";
       std::cout << desc_msg << "\n\n"
                 << opt_desc << "\n"
                 << example_msg << std::endl;
@@ -42,6 +127,110 @@ int main(int argc, const char* argv[]) {
     return 1;
   }
 
-  std::cout << "No meaningfull functionality yet." << std::endl;
+  beryl::zone_table zones;
+  // the zones of the configuration, reloaded on SIGHUP
+  std::vector<beryl::zone_config_entry> zone_entries;
+  if (!config_path.empty()) {
+    try {
+      auto config = beryl::read_zone_config(config_path);
+      zone_entries = config.zones;
+      auto errors =
+          beryl::load_zones(config.zones, zones,
+                            std::max<std::size_t>(1, thread_count), prerender);
+      for (const auto& e : errors) {
+        std::cerr << "zone `" << e.zone << "`: " << e.message << std::endl;
+      }
+      std::cout << config_path << ": " << zones.size() << " of "
+                << config.zones.size() << " zones loaded" << std::endl;
+      if (prerender) {
+        std::size_t answer_count = 0;
+        std::size_t memory_usage = 0;
+        for (const auto& entry : zones.snapshot()) {
+          if (const auto* templates = entry.second->templates()) {
+            answer_count += templates->size();
+            memory_usage += templates->memory_usage();
+          }
+        }
+        std::cout << answer_count << " answers rendered, " << memory_usage
+                  << " bytes" << std::endl;
+      }
+    } catch (const std::exception& e) {
+      std::cerr << config_path << ": " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  // The images are served from their mappings, along with the zones of
+  // the configuration; an image replaces a zone with the same origin,
+  // which isn't reloaded from its file then.
+  try {
+    for (const auto& path : image_paths) {
+      auto z = beryl::open_zone_image(path);
+      std::cout << path << ": " << z->record_count() << " records"
+                << std::endl;
+      zones.publish(std::move(z));
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (config_path.empty() && image_paths.empty()) {
+    return 0;
+  }
+
+  // The signals are taken by `sigwait` below rather than by the threads
+  // serving queries, which inherit the mask.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGHUP);
+  ::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  try {
+    std::optional<beryl::zone_replicas> replicas;
+    if (numa_replicas) {
+      replicas.emplace(zones);
+      std::cout << "zones copied to " << replicas->nodes().size()
+                << " NUMA nodes" << std::endl;
+    }
+    const beryl::zone_replicas* replicas_ptr = replicas ? &*replicas : nullptr;
+    beryl::udp_server server(zones, server_options, replicas_ptr);
+    // the port picked for UDP if it is zero
+    tcp_options.port = server.port();
+    beryl::tcp_server tcp(zones, tcp_options, replicas_ptr);
+    server.start();
+    tcp.start();
+    std::cout << "serving on " << server_options.address << " port "
+              << server.port() << " with " << server.thread_count()
+              << " threads" << std::endl;
+    // SIGHUP reloads the zone files while the queries are being answered
+    for (int signal = 0; ::sigwait(&signals, &signal) == 0 &&
+                         signal == SIGHUP;) {
+      if (zone_entries.empty()) {
+        continue;
+      }
+      std::size_t change_count = 0;
+      for (const auto& entry : zone_entries) {
+        try {
+          auto diff = beryl::reload_zone(zones, entry, prerender);
+          change_count += diff.removed.size() + diff.added.size();
+        } catch (const std::exception& e) {
+          std::cerr << "zone `" << entry.name << "`: " << e.what()
+                    << std::endl;
+        }
+      }
+      if (replicas) {
+        replicas->update();
+      }
+      std::cout << config_path << ": reloaded, " << change_count
+                << " records changed" << std::endl;
+    }
+    tcp.stop();
+    server.stop();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
   return 0;
 }
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include "beryl/chrono.hpp"
+#include "beryl/domain_name.hpp"
+#include "beryl/timing_wheel.hpp"
+
+namespace beryl::_impl {
+// @param name - `domain_name` or `domain_name_view`; both yield the same
+//     hash for the same name.
+template <typename Name>
+std::size_t cache_key_hash(const Name& name, std::uint16_t tag) noexcept {
+  static constexpr std::size_t prime = 31;
+  return name.hash() * prime + tag;
+}
+
+// The same hash value picks both a shard and a bucket within the shard.
+// Scramble the bits for the former so that all the keys of a shard do not
+// end up in the same fraction of buckets.
+inline std::size_t
+cache_shard_index(std::size_t hash, std::size_t shard_count) noexcept {
+  static constexpr std::uint64_t golden_ratio = 0x9E3779B97F4A7C15ULL;
+  static constexpr unsigned shift = 32;
+  return static_cast<std::size_t>(
+             (static_cast<std::uint64_t>(hash) * golden_ratio) >> shift) %
+         shard_count;
+}
+
+// A shard of a concurrent cache keyed by a domain name and a 16 bit tag,
+// e.g. a record type. The shard is guarded by its own mutex. Within
+// the shard:
+// -- expired entries are evicted by a hierarchical timing wheel keyed
+//    on the expiration time of the entry;
+// -- the capacity is enforced with the SIEVE eviction algorithm, which
+//    needs only one bit of state per entry and doesn't reorder entries
+//    on cache hits.
+// Each entry takes a share of the capacity, a charge, which is defined
+// by the user of the shard, e.g. a count of bytes or just one.
+template <typename Value>
+class cache_shard {
+public:
+  using value_type = Value;
+
+  cache_shard(std::size_t capacity, const chrono::time_point& now)
+      : _capacity(capacity), _wheel(now) {}
+  cache_shard(const cache_shard&) = delete;
+  cache_shard& operator=(const cache_shard&) = delete;
+
+  // @param name - `domain_name` or `domain_name_view`.
+  template <typename Name>
+  std::optional<value_type> find(std::size_t hash, const Name& name,
+                                 std::uint16_t tag,
+                                 const chrono::time_point& now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = lookup(hash, name, tag);
+    if (it == _entries.end()) {
+      return std::nullopt;
+    }
+    if (it->second.expiration <= now) {
+      erase(it);
+      return std::nullopt;
+    }
+    it->second.visited = true;
+    return it->second.value;
+  }
+
+  // Replaces the entry for the key, if any. An entry which doesn't fit into
+  // the shard is not inserted.
+  void insert(std::size_t hash, const domain_name& name, std::uint16_t tag,
+              value_type value, const chrono::time_point& expiration,
+              std::size_t charge, const chrono::time_point& now) {
+    if (charge > _capacity) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    advance(now);
+    if (auto it = lookup(hash, name, tag); it != _entries.end()) {
+      _usage -= it->second.charge;
+      it->second.value = std::move(value);
+      it->second.expiration = expiration;
+      it->second.charge = charge;
+      it->second.id = ++_last_id;
+      _usage += charge;
+      _wheel.schedule(expiration, std::make_pair(hash, it->second.id));
+    } else {
+      auto& e = _entries
+                    .emplace(hash, entry{hash, name, tag, ++_last_id,
+                                         std::move(value), expiration, charge,
+                                         false, nullptr, nullptr})
+                    ->second;
+      link_as_newest(e);
+      _usage += charge;
+      _wheel.schedule(expiration, std::make_pair(hash, e.id));
+    }
+    while (_usage > _capacity) {
+      evict();
+    }
+  }
+
+  void expire(const chrono::time_point& now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    advance(now);
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+  }
+
+  [[nodiscard]] std::size_t usage() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _usage;
+  }
+
+private:
+  using wheel_item = std::pair<std::size_t, std::uint64_t>;
+
+  struct entry {
+    std::size_t hash;
+    domain_name name;
+    std::uint16_t tag;
+    // Distinguishes the entry from the entries previously stored
+    // under the same key, whose expiration events may be still pending
+    // in the timing wheel.
+    std::uint64_t id;
+    value_type value;
+    chrono::time_point expiration;
+    std::size_t charge;
+    // SIEVE state
+    bool visited;
+    entry* newer;
+    entry* older;
+  };
+  using entry_map = std::unordered_multimap<std::size_t, entry>;
+
+public:
+  // An approximate count of bytes taken by an entry besides its value.
+  static constexpr std::size_t entry_overhead =
+      sizeof(typename entry_map::value_type) + 2 * sizeof(void*) +
+      sizeof(std::pair<std::int64_t, wheel_item>);
+
+private:
+  template <typename Name>
+  typename entry_map::iterator
+  lookup(std::size_t hash, const Name& name, std::uint16_t tag) {
+    auto [first, last] = _entries.equal_range(hash);
+    for (; first != last; ++first) {
+      if (first->second.tag == tag &&
+          domain_name_view(first->second.name) == domain_name_view(name)) {
+        return first;
+      }
+    }
+    return _entries.end();
+  }
+
+  void advance(const chrono::time_point& now) {
+    _wheel.advance(now, [this, &now](wheel_item item) {
+      auto [first, last] = _entries.equal_range(item.first);
+      for (; first != last; ++first) {
+        if (first->second.id == item.second) {
+          if (first->second.expiration <= now) {
+            erase(first);
+          }
+          return;
+        }
+      }
+    });
+  }
+
+  void link_as_newest(entry& e) noexcept {
+    e.newer = nullptr;
+    e.older = _head;
+    if (_head) {
+      _head->newer = &e;
+    }
+    _head = &e;
+    if (!_tail) {
+      _tail = &e;
+    }
+  }
+
+  void unlink(entry& e) noexcept {
+    if (_hand == &e) {
+      _hand = e.newer;
+    }
+    (e.newer ? e.newer->older : _head) = e.older;
+    (e.older ? e.older->newer : _tail) = e.newer;
+  }
+
+  void erase(typename entry_map::iterator it) {
+    unlink(it->second);
+    _usage -= it->second.charge;
+    _entries.erase(it);
+  }
+
+  // The hand moves from the oldest entry towards the newest one, clears
+  // the `visited` bit of the entries it passes and evicts the first entry
+  // without the bit set.
+  void evict() {
+    assert(_tail && "evicting from an empty shard");
+    entry* victim = _hand ? _hand : _tail;
+    while (victim->visited) {
+      victim->visited = false;
+      victim = victim->newer ? victim->newer : _tail;
+    }
+    _hand = victim->newer;
+    auto [first, last] = _entries.equal_range(victim->hash);
+    for (; first != last; ++first) {
+      if (&first->second == victim) {
+        erase(first);
+        return;
+      }
+    }
+    assert(false && "an entry of the eviction queue is not in the index");
+  }
+
+  mutable std::mutex _mutex;
+  std::size_t _capacity;
+  std::size_t _usage = 0;
+  entry_map _entries;
+  std::uint64_t _last_id = 0;
+  entry* _head = nullptr;
+  entry* _tail = nullptr;
+  entry* _hand = nullptr;
+  timing_wheel<wheel_item> _wheel;
+};
+}  // namespace beryl::_impl
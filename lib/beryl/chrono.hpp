@@ -1,14 +1,26 @@
 #pragma once
 
 #include <cstdint>
+#include <ctime>
 
 #include <chrono>
 
 namespace beryl::chrono {
 using seconds = std::chrono::duration<std::int64_t>;
 using time_point = std::chrono::time_point<std::chrono::system_clock, seconds>;
-inline time_point now() {
-  return time_point(std::chrono::duration_cast<time_point::duration>(
-      std::chrono::system_clock::now().time_since_epoch()));
+
+// The coarse real-time clock is updated once per scheduler tick, i.e. its
+// resolution is a few milliseconds. That is way finer than the one second
+// resolution of `time_point` but reading the coarse clock doesn't need to
+// access the hardware counter, thus it is several times cheaper than
+// `std::chrono::system_clock::now()`.
+inline time_point now() noexcept {
+  timespec ts{};
+  ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  return time_point(seconds(ts.tv_sec));
 }
+
+// The records of a zone never expire, so their TTLs don't depend on the
+// time: pass this one to compute them without reading the clock.
+inline constexpr time_point zone_time{};
 }  // namespace beryl::chrono
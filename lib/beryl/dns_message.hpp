@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <optional>
+#include <string_view>
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/record_class.hpp"
+#include "beryl/record_type.hpp"
+#include "beryl/wire.hpp"
+
+namespace beryl {
+// DNS message constants of RFC 1035, section 4.1.1.
+namespace dns {
+inline constexpr std::size_t header_size = 12;
+// the size limit of a UDP message without EDNS
+inline constexpr std::size_t max_udp_size = 512;
+// the size limit of a TCP message, which is prefixed with its 16 bit size
+inline constexpr std::size_t max_tcp_size = 65535;
+
+inline constexpr std::uint16_t flag_qr = 0x8000;
+inline constexpr std::uint16_t flag_aa = 0x0400;
+inline constexpr std::uint16_t flag_tc = 0x0200;
+inline constexpr std::uint16_t flag_rd = 0x0100;
+inline constexpr unsigned opcode_shift = 11;
+inline constexpr std::uint16_t opcode_mask = 0xf;
+inline constexpr std::uint16_t rcode_mask = 0xf;
+
+enum class rcode : std::uint16_t {
+  no_error = 0,
+  format_error = 1,
+  server_failure = 2,
+  name_error = 3,
+  not_implemented = 4,
+  refused = 5
+};
+
+inline constexpr std::uint16_t class_in = 1;
+inline constexpr std::uint16_t type_any = 255;
+
+inline constexpr std::size_t flags_offset = 2;
+inline constexpr std::size_t qdcount_offset = 4;
+inline constexpr std::size_t ancount_offset = 6;
+inline constexpr std::size_t nscount_offset = 8;
+inline constexpr std::size_t arcount_offset = 10;
+// the type and the class following the name of a question
+inline constexpr std::size_t question_fixed_size = 4;
+}  // namespace dns
+
+// A name in the uncompressed wire format, as it is in a message: labels
+// from the leftmost one, each preceded by its length, and the root label.
+// The labels keep the case they are sent in.
+class wire_name_view {
+public:
+  class const_iterator
+      : public boost::iterator_facade<const_iterator, const std::string_view,
+                                      boost::forward_traversal_tag,
+                                      std::string_view> {
+  public:
+    [[nodiscard]] std::string_view dereference() const noexcept {
+      return std::string_view(_pos + 1, static_cast<unsigned char>(*_pos));
+    }
+    [[nodiscard]] bool equal(const const_iterator& other) const noexcept {
+      return _pos == other._pos;
+    }
+    void increment() noexcept { _pos += static_cast<unsigned char>(*_pos) + 1; }
+
+  private:
+    friend class wire_name_view;
+    friend class boost::iterator_core_access;
+
+    explicit const_iterator(const char* pos) noexcept : _pos(pos) {}
+
+    const char* _pos;
+  };
+
+  // @param data - a valid name with nothing after it, e.g. the prefix of
+  //     a message `wire::name_length` measures
+  explicit wire_name_view(std::string_view data) noexcept : _data(data) {}
+
+  // @return the name in the wire format, including the root label
+  [[nodiscard]] std::string_view data() const noexcept { return _data; }
+
+  [[nodiscard]] const_iterator begin() const noexcept {
+    return const_iterator(_data.data());
+  }
+  // the root label
+  [[nodiscard]] const_iterator end() const noexcept {
+    return const_iterator(_data.data() + _data.size() - 1);
+  }
+
+  // Builds the name, in lower case, e.g. to look it up in the zones. Any
+  // octets make a label, see `domain_name::from_wire`.
+  [[nodiscard]] domain_name to_domain_name() const {
+    return domain_name::from_wire(_data);
+  }
+
+private:
+  std::string_view _data;
+};
+
+class dns_question {
+public:
+  dns_question(wire_name_view name, std::uint16_t qtype,
+               std::uint16_t qclass, std::string_view data) noexcept
+      : _name(name), _qtype(qtype), _qclass(qclass), _data(data) {}
+
+  [[nodiscard]] const wire_name_view& name() const noexcept { return _name; }
+  // the type as is, e.g. `dns::type_any` or a type beryl doesn't support
+  [[nodiscard]] std::uint16_t qtype() const noexcept { return _qtype; }
+  [[nodiscard]] std::uint16_t qclass() const noexcept { return _qclass; }
+  // the entry of the question section, as a response repeats it
+  [[nodiscard]] std::string_view data() const noexcept { return _data; }
+
+  // @return the type or nothing if it isn't one of `record_type`
+  [[nodiscard]] std::optional<record_type> supported_type() const noexcept {
+    for (const auto& entry : _impl::record_type_names) {
+      if (static_cast<std::uint16_t>(entry.first) == _qtype) {
+        return entry.first;
+      }
+    }
+    return std::nullopt;
+  }
+  // @return the class or nothing if it isn't one of `record_class`
+  [[nodiscard]] std::optional<record_class> supported_class() const noexcept {
+    if (_qclass != dns::class_in) {
+      return std::nullopt;
+    }
+    return record_class::in;
+  }
+
+private:
+  wire_name_view _name;
+  std::uint16_t _qtype;
+  std::uint16_t _qclass;
+  std::string_view _data;
+};
+
+// A DNS message in the buffer it is received to. Neither the view nor
+// the question taken from it copy or allocate anything; the buffer has to
+// outlive them. The header is checked on `parse`, the question section on
+// `question`, each in a number of steps bounded by the limits of
+// the header and of a name, whatever the message is.
+class dns_message_view {
+public:
+  // @return the view or nothing if the message is shorter than the header
+  static std::optional<dns_message_view>
+  parse(std::string_view message) noexcept {
+    if (message.size() < dns::header_size) {
+      return std::nullopt;
+    }
+    return dns_message_view(message);
+  }
+
+  [[nodiscard]] std::string_view data() const noexcept { return _data; }
+
+  [[nodiscard]] std::uint16_t id() const noexcept {
+    return wire::get_uint16(_data.data());
+  }
+  [[nodiscard]] std::uint16_t flags() const noexcept {
+    return wire::get_uint16(_data.data() + dns::flags_offset);
+  }
+  [[nodiscard]] bool is_response() const noexcept {
+    return flags() & dns::flag_qr;
+  }
+  [[nodiscard]] std::uint16_t opcode() const noexcept {
+    return flags() >> dns::opcode_shift & dns::opcode_mask;
+  }
+  [[nodiscard]] std::uint16_t question_count() const noexcept {
+    return wire::get_uint16(_data.data() + dns::qdcount_offset);
+  }
+  [[nodiscard]] std::uint16_t answer_count() const noexcept {
+    return wire::get_uint16(_data.data() + dns::ancount_offset);
+  }
+  [[nodiscard]] std::uint16_t authority_count() const noexcept {
+    return wire::get_uint16(_data.data() + dns::nscount_offset);
+  }
+  [[nodiscard]] std::uint16_t additional_count() const noexcept {
+    return wire::get_uint16(_data.data() + dns::arcount_offset);
+  }
+
+  // The question of a query, the only entry of its question section. Any
+  // sections following it are left unchecked.
+  //
+  // @return the question or nothing if the section isn't a single entry,
+  //     its name is invalid or compressed, or it runs past the message
+  [[nodiscard]] std::optional<dns_question> question() const noexcept {
+    if (question_count() != 1) {
+      return std::nullopt;
+    }
+    std::string_view rest = _data.substr(dns::header_size);
+    std::size_t name_size = wire::name_length(rest);
+    if (name_size == 0 ||
+        rest.size() - name_size < dns::question_fixed_size) {
+      return std::nullopt;
+    }
+    const char* fixed = rest.data() + name_size;
+    return dns_question(wire_name_view(rest.substr(0, name_size)),
+                        wire::get_uint16(fixed), wire::get_uint16(fixed + 2),
+                        rest.substr(0, name_size + dns::question_fixed_size));
+  }
+
+private:
+  explicit dns_message_view(std::string_view data) noexcept : _data(data) {}
+
+  std::string_view _data;
+};
+}  // namespace beryl
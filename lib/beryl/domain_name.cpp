@@ -28,6 +28,22 @@ bool label_is_valid(const std::string_view& label) noexcept {
 }
 }  // namespace
 
+bool is_valid_domain_name(const std::string_view& str) noexcept {
+  if (str == ".") {
+    return true;
+  }
+  if (!(str.size() <= max_domain_name_length && str_ends_with(str, '.'))) {
+    return false;
+  }
+  for (const auto& label :
+       tokenizer(std::string_view(str.data(), str.size() - 1), '.')) {
+    if (!label_is_valid(label)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 label_view::label_view(const std::string_view& l)
     : _label(label_is_valid(l) ? l : throw label_error(l)) {}
 
@@ -37,7 +53,7 @@ domain_name::domain_name(const std::string_view& str) {
     _dname = boost::container::string();
     return;
   }
-  if (!(str.size() <= max_domain_name_length && str_ends_with(str, '.'))) {
+  if (!is_valid_domain_name(str)) {
     throw domain_name_error(str);
   }
 
@@ -47,9 +63,6 @@ domain_name::domain_name(const std::string_view& str) {
   // Otherwise, `labels` yields the final empty label which is not needed.
   tokenizer labels(std::string_view(str.data(), str.size() - 1), '.');
   for (const auto& label : labels) {
-    if (!label_is_valid(label)) {
-      throw domain_name_error(str);
-    }
     pos -= label.size() + 1;
     _dname[pos] = static_cast<char>(-1 * static_cast<char>(label.size()));
     _dname.replace(pos + 1, label.size(), label);
@@ -60,4 +73,24 @@ domain_name::domain_name(const std::string_view& str) {
   }
 }
 
+domain_name domain_name::from_wire(std::string_view data) {
+  domain_name name;
+  // The wire format is one octet longer, for the root label, and has
+  // the labels the other way round.
+  name._dname = boost::container::string(data.size() - 1, '#');
+  std::size_t pos = name._dname.size();
+  for (std::size_t i = 0; data[i] != '\0';) {
+    auto length = static_cast<unsigned char>(data[i]);
+    pos -= length + 1U;
+    name._dname[pos] = static_cast<char>(-1 * static_cast<char>(length));
+    for (std::size_t j = 1; j <= length; ++j) {
+      char c = data[i + j];
+      name._dname[pos + j] =
+          c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    i += length + 1U;
+  }
+  return name;
+}
+
 }  // namespace beryl
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <iterator>
 #include <stdexcept>
 #include <string>
@@ -13,14 +14,13 @@ namespace beryl {
 class label_error : public std::runtime_error {
 public:
   explicit label_error(const std::string_view& label)
-      : std::runtime_error(std::string("invalid label: `") + label.data() +
-                           "`") {}
+      : std::runtime_error("invalid label: `" + std::string(label) + "`") {}
 };
 class domain_name_error : public std::runtime_error {
 public:
   explicit domain_name_error(const std::string_view& domain_name)
-      : std::runtime_error(std::string("invalid domain name: `") +
-                           domain_name.data() + "`") {}
+      : std::runtime_error("invalid domain name: `" +
+                           std::string(domain_name) + "`") {}
 };
 
 namespace _impl {
@@ -106,7 +106,10 @@ public:
       return _label;
     }
     [[nodiscard]] bool equal(const const_iterator& other) const noexcept {
-      return _label == other._label;
+      // Labels are compared by position rather than by content, otherwise
+      // an iterator would be equal to another one pointing to
+      // an identical label, e.g. in `foo.foo.`.
+      return _label.data() == other._label.data();
     }
     void increment() noexcept {
       const char* data = _label.data();
@@ -147,9 +150,18 @@ public:
   bool operator!=(const T& other) const noexcept {
     return !(*static_cast<const T*>(this) == *static_cast<const T*>(&other));
   }
+
+  [[nodiscard]] std::size_t hash() const noexcept {
+    return std::hash<std::string_view>()(
+        std::string_view(static_cast<const T*>(this)->_dname));
+  }
 };
 }  // namespace _impl
 
+// @return whether `str` is a valid fully qualified domain name, i.e.
+//     whether `domain_name(str)` succeeds.
+[[nodiscard]] bool is_valid_domain_name(const std::string_view& str) noexcept;
+
 class domain_name : public _impl::domain_name_extender<domain_name> {
 public:
   // @param str - a fully qualified domain name, must end with dot.
@@ -166,13 +178,24 @@ public:
   // // @throw domain_name_error if str is not a valid domain name
   // domain_name(const std::vector<std::byte>& bytes);
 
-  domain_name& remove_subdomain() {
-    boost::container::string::const_reverse_iterator delim = std::find_if(
-        _dname.crbegin(), _dname.crend(), [](char c) { return c < 0; });
-    if (delim != _dname.crend()) {
-      ++delim;
+  // Builds the name from one in the uncompressed wire format, e.g. the name
+  // of a question, in lower case. Unlike the constructor it takes labels
+  // of any octets, e.g. `_dmarc`, as only host names are limited to
+  // letters, digits and hyphens.
+  //
+  // @param data - a valid name with nothing after it, see
+  //     `wire::name_length`
+  [[nodiscard]] static domain_name from_wire(std::string_view data);
+
+  domain_name& remove_subdomain() noexcept {
+    // The labels are walked from the top level one, as their octets, unlike
+    // the lengths, aren't told apart by the sign.
+    std::size_t last = 0;
+    for (std::size_t pos = 0; pos < _dname.size();
+         pos += 1 + static_cast<std::size_t>(-_dname[pos])) {
+      last = pos;
     }
-    _dname.erase(delim.base(), _dname.cend());
+    _dname.erase(last);
     return *this;
   }
   domain_name& add_subdomain(const label_view& l) {
@@ -184,6 +207,9 @@ public:
 private:
   friend class domain_name_extender<domain_name>;
 
+  // the root
+  domain_name() = default;
+
   boost::container::string _dname;
 };
 
@@ -192,7 +218,7 @@ public:
   domain_name_view(domain_name::const_iterator begin,
                    domain_name::const_iterator end) noexcept
       : _dname(begin->data() - 1,
-               static_cast<std::size_t>(end->data() - (begin->data() - 1))) {}
+               static_cast<std::size_t>(end->data() - begin->data())) {}
   explicit domain_name_view(const domain_name& dname) noexcept
       : domain_name_view(dname.begin(), dname.end()) {}
   domain_name_view(const domain_name& dname, std::size_t label_count) noexcept
@@ -208,6 +234,14 @@ private:
   std::string_view _dname;
 };
 
+class domain_name_hash {
+public:
+  template <typename T>
+  std::size_t operator()(const T& dname) const noexcept {
+    return dname.hash();
+  }
+};
+
 // mostly for testing and debug purposes
 template <typename T>
 std::enable_if_t<std::is_same_v<T, domain_name> ||
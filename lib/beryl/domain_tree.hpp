@@ -1,10 +1,13 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
 
 #include <algorithm>
+#include <atomic>
 #include <forward_list>
 #include <iterator>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -17,6 +20,12 @@ namespace beryl {
 // a limited time frame. A radix tree would be much more suitable here.
 // @todo Evaluate https://github.com/antirez/rax and _adapt_ it
 // to the usecase of `domain_tree`.
+//
+// A copy shares the nodes with the original. `insert` and `erase_if` copy
+// the shared nodes on the path to the name they change, so a copy is
+// changed, e.g. on a reload, while other threads read the original.
+// The values reached through the cursors of a copy are shared though and
+// must not be changed.
 template <typename T>
 class domain_tree {
 public:
@@ -26,7 +35,7 @@ private:
   class node {
   private:
     using node_container_type =
-        std::vector<std::pair<label, std::unique_ptr<node>>>;
+        std::vector<std::pair<label, std::shared_ptr<node>>>;
     using value_container_type = std::forward_list<value_type>;
 
   public:
@@ -70,13 +79,24 @@ private:
       return (pos != _children.end() && pos->first == l)
                  ? std::pair(pos, false)
                  : std::pair(_children.emplace(pos, label(l),
-                                               std::make_unique<node>()),
+                                               std::make_shared<node>()),
                              true);
     }
     value_iterator add_value(const value_type& value) {
       _values.push_front(value);
       return _values.begin();
     }
+    template <typename Predicate>
+    std::size_t remove_values_if(Predicate& pred) {
+      std::size_t count = 0;
+      _values.remove_if([&pred, &count](const value_type& value) {
+        bool remove = pred(value);
+        count += remove;
+        return remove;
+      });
+      return count;
+    }
+    void erase_child(iterator it) { _children.erase(it); }
 
   private:
     iterator find_child_insert_pos(const label_view& l) noexcept {
@@ -195,6 +215,11 @@ public:
                                     typename node::const_value_iterator>;
 
   domain_tree() : _root(std::make_unique<node>()) {}
+  domain_tree(const domain_tree& other)
+      : _root(std::make_unique<node>(*other._root)) {}
+  domain_tree(domain_tree&&) noexcept = default;
+  domain_tree& operator=(const domain_tree&) = delete;
+  domain_tree& operator=(domain_tree&&) noexcept = default;
 
   cursor begin() {
     cursor cur = root();
@@ -216,6 +241,33 @@ public:
     return cur;
   }
 
+  // Removes the values of `dname` satisfying `pred` along with the nodes
+  // left with neither values nor children, so that the tree is the same as
+  // if the removed values had never been inserted.
+  //
+  // @return the number of the removed values
+  template <typename Predicate>
+  std::size_t erase_if(const domain_name& dname, Predicate pred) {
+    cursor cur = root();
+    for (const auto& label : dname) {
+      auto n = cur.current_node();
+      auto child_node = n->find(label);
+      if (child_node == n->children_end()) {
+        return 0;
+      }
+      unshare(child_node);
+      cur.decend_to_child(child_node);
+    }
+    std::size_t count = cur.current_node()->remove_values_if(pred);
+    while (!cur.is_root() && cur.current_node()->values_empty() &&
+           cur.current_node()->children_empty()) {
+      auto it = cur._stack.back();
+      cur.ascend_to_parent();
+      cur.current_node()->erase_child(it);
+    }
+    return count;
+  }
+
   cursor find(const domain_name& dname) {
     cursor cur = root();
     for (const auto& label : dname) {
@@ -291,6 +343,18 @@ public:
   }
 
 private:
+  // Makes the node `child` refers to one of this tree only, copying it if
+  // other trees share it.
+  static void unshare(typename node::iterator child) {
+    if (child->second.use_count() > 1) {
+      child->second = std::make_shared<node>(*child->second);
+    } else {
+      // The trees which shared the node may have been dropped by other
+      // threads; their reads of the node happen before the changes.
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+  }
+
   cursor root() noexcept { return cursor(_root.get()); }
   const_cursor root() const noexcept { return const_cursor(_root.get()); }
 
@@ -298,6 +362,7 @@ private:
     cursor cur = root();
     for (const auto& label : dname) {
       auto new_node = cur.current_node()->insert_child(label).first;
+      unshare(new_node);
       cur.decend_to_child(new_node);
     }
     return cur;
@@ -0,0 +1,168 @@
+#include "beryl/gzip_reader.hpp"
+
+#include <zlib.h>
+
+#include <cassert>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace beryl {
+namespace {
+// A zlib stream inflating gzip data.
+class inflater {
+public:
+  inflater() {
+    // 16 tells zlib to expect a gzip header and trailer
+    static constexpr int gzip_window_bits = 15 + 16;
+    if (::inflateInit2(&_stream, gzip_window_bits) != Z_OK) {
+      throw std::runtime_error("can't initialize gzip decompression");
+    }
+  }
+  ~inflater() { ::inflateEnd(&_stream); }
+  inflater(const inflater&) = delete;
+  inflater& operator=(const inflater&) = delete;
+
+  void set_input(std::string_view in) noexcept {
+    // `avail_in` is 32 bit; the rest is fed on the following calls
+    _rest = in;
+    feed();
+  }
+
+  // Decompresses into `out` from `out.size()` up to its capacity.
+  //
+  // @return false once the whole input is decompressed
+  bool inflate(std::string& out) {
+    std::size_t produced = out.size();
+    out.resize(out.capacity());
+    _stream.next_out = reinterpret_cast<Bytef*>(out.data() + produced);
+    _stream.avail_out = static_cast<uInt>(out.size() - produced);
+    bool more = true;
+    while (_stream.avail_out > 0) {
+      if (_stream.avail_in == 0) {
+        feed();
+      }
+      int rc = ::inflate(&_stream, Z_NO_FLUSH);
+      if (rc == Z_STREAM_END) {
+        feed();
+        if (_stream.avail_in == 0) {
+          more = false;
+          break;
+        }
+        // the next member of a multi-member file
+        ::inflateReset(&_stream);
+      } else if (rc == Z_BUF_ERROR && _stream.avail_in == 0) {
+        throw std::runtime_error("truncated gzip data");
+      } else if (rc != Z_OK) {
+        throw std::runtime_error(std::string("corrupt gzip data: ") +
+                                 (_stream.msg ? _stream.msg : "unknown"));
+      }
+    }
+    out.resize(out.size() - _stream.avail_out);
+    return more;
+  }
+
+private:
+  void feed() noexcept {
+    if (_stream.avail_in > 0 || _rest.empty()) {
+      return;
+    }
+    std::size_t size = std::min<std::size_t>(
+        _rest.size(), std::numeric_limits<uInt>::max());
+    _stream.next_in =
+        reinterpret_cast<Bytef*>(const_cast<char*>(_rest.data()));
+    _stream.avail_in = static_cast<uInt>(size);
+    _rest.remove_prefix(size);
+  }
+
+  z_stream _stream{};
+  std::string_view _rest;
+};
+}  // namespace
+
+gzip_reader::gzip_reader(std::string_view compressed, std::size_t block_size,
+                         std::size_t block_count)
+    : _compressed(compressed), _block_size(block_size), _free(block_count) {
+  assert(block_size > 0 && block_count > 0 && "blocks must be given");
+  _thread = std::thread(&gzip_reader::decompress, this);
+}
+
+gzip_reader::~gzip_reader() {
+  {
+    std::lock_guard lock(_mutex);
+    _stopped = true;
+  }
+  _free_cv.notify_one();
+  _thread.join();
+}
+
+bool gzip_reader::next(std::string& block) {
+  std::unique_lock lock(_mutex);
+  _ready_cv.wait(lock, [this]() { return !_ready.empty() || _done; });
+  if (_ready.empty()) {
+    if (_error) {
+      std::rethrow_exception(_error);
+    }
+    return false;
+  }
+  block.swap(_ready.front());
+  _free.push_back(std::move(_ready.front()));
+  _ready.pop_front();
+  lock.unlock();
+  _free_cv.notify_one();
+  return true;
+}
+
+bool gzip_reader::is_gzip(std::string_view data) noexcept {
+  return data.size() >= 2 && static_cast<unsigned char>(data[0]) == 0x1f &&
+         static_cast<unsigned char>(data[1]) == 0x8b;
+}
+
+bool gzip_reader::take_free(std::string& block) {
+  std::unique_lock lock(_mutex);
+  _free_cv.wait(lock, [this]() { return !_free.empty() || _stopped; });
+  if (_stopped) {
+    return false;
+  }
+  block = std::move(_free.back());
+  _free.pop_back();
+  return true;
+}
+
+void gzip_reader::put_ready(std::string& block) {
+  {
+    std::lock_guard lock(_mutex);
+    _ready.push_back(std::move(block));
+  }
+  _ready_cv.notify_one();
+}
+
+void gzip_reader::decompress() {
+  try {
+    inflater z;
+    z.set_input(_compressed);
+    for (bool more = true; more;) {
+      std::string block;
+      if (!take_free(block)) {
+        return;
+      }
+      block.clear();
+      block.reserve(_block_size);
+      more = z.inflate(block);
+      if (!block.empty()) {
+        put_ready(block);
+      }
+    }
+  } catch (...) {
+    std::lock_guard lock(_mutex);
+    _error = std::current_exception();
+  }
+  {
+    std::lock_guard lock(_mutex);
+    _done = true;
+  }
+  _ready_cv.notify_one();
+}
+}  // namespace beryl
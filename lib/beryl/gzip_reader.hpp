@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace beryl {
+// Decompresses gzip data on a thread of its own, a block ahead of
+// the reader, so that decompression and the processing of the decompressed
+// text overlap. The blocks circulate between the two threads through
+// a fixed set of buffers, i.e. nothing is allocated per block.
+class gzip_reader {
+public:
+  static constexpr std::size_t default_block_size = std::size_t(256) * 1024;
+  static constexpr std::size_t default_block_count = 4;
+
+  // @param compressed - gzip data, possibly of several members, which has
+  //     to outlive the reader
+  explicit gzip_reader(std::string_view compressed,
+                       std::size_t block_size = default_block_size,
+                       std::size_t block_count = default_block_count);
+  ~gzip_reader();
+  gzip_reader(const gzip_reader&) = delete;
+  gzip_reader& operator=(const gzip_reader&) = delete;
+
+  // Swaps the next decompressed block into `block`, whose previous content
+  // is dropped and whose storage is reused for a following block.
+  //
+  // @return false if all the data is decompressed
+  // @throw std::runtime_error if the data is corrupt
+  bool next(std::string& block);
+
+  // @return whether `data` starts with the gzip magic number
+  static bool is_gzip(std::string_view data) noexcept;
+
+private:
+  void decompress();
+  // @return a buffer to decompress to or nothing if the reader is gone
+  bool take_free(std::string& block);
+  void put_ready(std::string& block);
+
+  std::string_view _compressed;
+  std::size_t _block_size;
+
+  std::mutex _mutex;
+  std::condition_variable _ready_cv;
+  std::condition_variable _free_cv;
+  std::deque<std::string> _ready;
+  std::vector<std::string> _free;
+  bool _done = false;
+  bool _stopped = false;
+  std::exception_ptr _error;
+
+  std::thread _thread;
+};
+}  // namespace beryl
@@ -0,0 +1,206 @@
+#include "beryl/io_ring.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <system_error>
+
+namespace beryl {
+namespace {
+[[noreturn]] void throw_system_error(int error, const char* what) {
+  throw std::system_error(error, std::generic_category(), what);
+}
+
+int io_uring_setup(unsigned entries, io_uring_params& params) noexcept {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags) noexcept {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, void* arg,
+                      unsigned nr_args) noexcept {
+  return static_cast<int>(
+      ::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// @return the mapping or `nullptr`
+void* map_ring(int fd, std::size_t size, off_t offset) noexcept {
+  void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, offset);
+  return p == MAP_FAILED ? nullptr : p;
+}
+
+template <typename T>
+T* at(void* base, std::uint32_t offset) noexcept {
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+}  // namespace
+
+io_ring::io_ring(unsigned entries, bool sqpoll) : _sqpoll(sqpoll) {
+  io_uring_params params{};
+  if (sqpoll) {
+    params.flags |= IORING_SETUP_SQPOLL;
+  }
+  _fd = io_uring_setup(entries, params);
+  if (_fd < 0) {
+    throw_system_error(errno, "can't set up an io_uring");
+  }
+
+  _sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  _cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_map) {
+    _sq_map_size = _cq_map_size = std::max(_sq_map_size, _cq_map_size);
+  }
+  _sq_map = map_ring(_fd, _sq_map_size, IORING_OFF_SQ_RING);
+  _cq_map = single_map ? _sq_map
+                       : map_ring(_fd, _cq_map_size, IORING_OFF_CQ_RING);
+  _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  _sqes = static_cast<io_uring_sqe*>(
+      map_ring(_fd, _sqes_size, IORING_OFF_SQES));
+  if (!_sq_map || !_cq_map || !_sqes) {
+    int error = errno;
+    release();
+    throw_system_error(error, "can't map an io_uring");
+  }
+
+  _sq_entries = params.sq_entries;
+  _sq_head = at<unsigned>(_sq_map, params.sq_off.head);
+  _sq_tail = at<unsigned>(_sq_map, params.sq_off.tail);
+  _sq_flags = at<unsigned>(_sq_map, params.sq_off.flags);
+  _sq_mask = *at<unsigned>(_sq_map, params.sq_off.ring_mask);
+  _sqe_tail = *_sq_tail;
+  // the entries are taken in order, so the indirection array is identity
+  auto* array = at<unsigned>(_sq_map, params.sq_off.array);
+  for (unsigned i = 0; i < _sq_entries; ++i) {
+    array[i] = i;
+  }
+
+  _cq_head = at<unsigned>(_cq_map, params.cq_off.head);
+  _cq_tail = at<unsigned>(_cq_map, params.cq_off.tail);
+  _cq_mask = *at<unsigned>(_cq_map, params.cq_off.ring_mask);
+  _cqes = at<io_uring_cqe>(_cq_map, params.cq_off.cqes);
+}
+
+io_ring::~io_ring() { release(); }
+
+void io_ring::release() noexcept {
+  if (_sqes) {
+    ::munmap(_sqes, _sqes_size);
+  }
+  if (_cq_map && _cq_map != _sq_map) {
+    ::munmap(_cq_map, _cq_map_size);
+  }
+  if (_sq_map) {
+    ::munmap(_sq_map, _sq_map_size);
+  }
+  ::close(_fd);
+}
+
+io_uring_sqe* io_ring::get_sqe() noexcept {
+  unsigned head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+  if (_sqe_tail - head >= _sq_entries) {
+    return nullptr;
+  }
+  io_uring_sqe* sqe = &_sqes[_sqe_tail++ & _sq_mask];
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+void io_ring::submit(unsigned wait_count) {
+  __atomic_store_n(_sq_tail, _sqe_tail, __ATOMIC_RELEASE);
+  unsigned flags = wait_count > 0 ? IORING_ENTER_GETEVENTS : 0;
+  if (_sqpoll) {
+    // the kernel thread takes the entries; it has only to be woken up
+    // if it has gone idle
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(_sq_flags, __ATOMIC_RELAXED) &
+        IORING_SQ_NEED_WAKEUP) {
+      flags |= IORING_ENTER_SQ_WAKEUP;
+    }
+  }
+  for (;;) {
+    // the entries the kernel hasn't consumed, which a call interrupted or
+    // refused for a full completion queue leaves in the queue
+    unsigned to_submit =
+        _sqpoll ? 0 : _sqe_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+    if (to_submit == 0 && flags == 0) {
+      return;
+    }
+    int res = io_uring_enter(_fd, to_submit, wait_count, flags);
+    if (res >= 0) {
+      return;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    // the completion queue is full: the caller is to consume it
+    if (errno == EAGAIN || errno == EBUSY) {
+      return;
+    }
+    throw_system_error(errno, "can't submit to an io_uring");
+  }
+}
+
+buffer_ring::buffer_ring(io_ring& ring, std::uint16_t group,
+                         std::uint16_t count, std::size_t buffer_size)
+    : _ring(ring),
+      _group(group),
+      _mask(static_cast<std::uint16_t>(count - 1)),
+      _buffer_size(buffer_size),
+      _buffers(std::size_t(count) * buffer_size),
+      _bufs_size(std::size_t(count) * sizeof(io_uring_buf)) {
+  // the ring has to be page aligned
+  void* p = ::mmap(nullptr, _bufs_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    throw_system_error(errno, "can't allocate a buffer ring");
+  }
+  _bufs = static_cast<io_uring_buf_ring*>(p);
+
+  io_uring_buf_reg reg{};
+  reg.ring_addr = reinterpret_cast<std::uintptr_t>(_bufs);
+  reg.ring_entries = count;
+  reg.bgid = group;
+  if (io_uring_register(_ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    int error = errno;
+    ::munmap(_bufs, _bufs_size);
+    throw_system_error(error, "can't register a buffer ring");
+  }
+  for (std::uint16_t id = 0; id < count; ++id) {
+    recycle(id);
+  }
+  publish();
+}
+
+buffer_ring::~buffer_ring() {
+  io_uring_buf_reg reg{};
+  reg.bgid = _group;
+  io_uring_register(_ring.fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+  ::munmap(_bufs, _bufs_size);
+}
+
+void buffer_ring::recycle(std::uint16_t id) noexcept {
+  // The entries start at the ring itself, the tail overlays a field of
+  // the first one. `io_uring_buf_ring::bufs` is off by the empty struct
+  // of `__DECLARE_FLEX_ARRAY`, which takes a byte in C++.
+  auto* bufs = reinterpret_cast<io_uring_buf*>(_bufs);
+  io_uring_buf& buf = bufs[_tail++ & _mask];
+  buf.addr = reinterpret_cast<std::uintptr_t>(buffer(id));
+  buf.len = static_cast<std::uint32_t>(_buffer_size);
+  buf.bid = id;
+}
+
+void buffer_ring::publish() noexcept {
+  __atomic_store_n(&_bufs->tail, _tail, __ATOMIC_RELEASE);
+}
+}  // namespace beryl
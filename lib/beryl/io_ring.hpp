@@ -0,0 +1,116 @@
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+namespace beryl {
+// An io_uring instance driven with the raw system calls: a submission
+// queue and a completion queue shared with the kernel. It is meant to be
+// used by one thread.
+class io_ring {
+public:
+  // @param entries - the least size of the submission queue
+  // @param sqpoll - whether a kernel thread polls the submission queue,
+  //     which saves the system call submitting the entries
+  // @throw std::system_error if the kernel refuses to set the ring up
+  io_ring(unsigned entries, bool sqpoll);
+  ~io_ring();
+  io_ring(const io_ring&) = delete;
+  io_ring& operator=(const io_ring&) = delete;
+
+  [[nodiscard]] int fd() const noexcept { return _fd; }
+
+  // @return a cleared submission queue entry to fill or `nullptr` if
+  //     the queue is full
+  io_uring_sqe* get_sqe() noexcept;
+
+  // Submits the entries the kernel hasn't taken yet, e.g. those left by
+  // a previous call the kernel took only part of, all with one system call
+  // if any, and waits for `wait_count` completions.
+  //
+  // @throw std::system_error if the system call fails
+  void submit(unsigned wait_count);
+
+  // Calls `f(const io_uring_cqe&)` for each of the completions queued and
+  // consumes them.
+  template <typename F>
+  void consume(F&& f) {
+    unsigned head = *_cq_head;
+    unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      f(_cqes[head & _cq_mask]);
+    }
+    __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+  }
+
+private:
+  void release() noexcept;
+
+  int _fd = -1;
+  bool _sqpoll;
+  void* _sq_map = nullptr;
+  std::size_t _sq_map_size = 0;
+  void* _cq_map = nullptr;
+  std::size_t _cq_map_size = 0;
+  io_uring_sqe* _sqes = nullptr;
+  std::size_t _sqes_size = 0;
+
+  unsigned _sq_entries = 0;
+  unsigned* _sq_head = nullptr;
+  unsigned* _sq_tail = nullptr;
+  unsigned* _sq_flags = nullptr;
+  unsigned _sq_mask = 0;
+  // the tail of the entries filled, ahead of the one seen by the kernel
+  unsigned _sqe_tail = 0;
+
+  unsigned* _cq_head = nullptr;
+  unsigned* _cq_tail = nullptr;
+  unsigned _cq_mask = 0;
+  io_uring_cqe* _cqes = nullptr;
+};
+
+// A ring of buffers provided to the kernel, which picks one for
+// an operation with `IOSQE_BUFFER_SELECT` when the data arrives, rather
+// than when the operation is submitted: a multishot receive needs no
+// buffers of its own per datagram. The completion carries the ID of
+// the buffer taken, which is given back with `recycle`.
+class buffer_ring {
+public:
+  // @param count - the number of buffers, a power of two up to 32768
+  // @throw std::system_error if the ring can't be registered
+  buffer_ring(io_ring& ring, std::uint16_t group, std::uint16_t count,
+              std::size_t buffer_size);
+  ~buffer_ring();
+  buffer_ring(const buffer_ring&) = delete;
+  buffer_ring& operator=(const buffer_ring&) = delete;
+
+  [[nodiscard]] std::uint16_t group() const noexcept { return _group; }
+  [[nodiscard]] std::size_t count() const noexcept {
+    return std::size_t(_mask) + 1;
+  }
+  [[nodiscard]] std::size_t buffer_size() const noexcept {
+    return _buffer_size;
+  }
+  [[nodiscard]] char* buffer(std::uint16_t id) noexcept {
+    return &_buffers[std::size_t(id) * _buffer_size];
+  }
+
+  // Gives the buffer back; the kernel sees it after `publish`.
+  void recycle(std::uint16_t id) noexcept;
+  void publish() noexcept;
+
+private:
+  io_ring& _ring;
+  std::uint16_t _group;
+  std::uint16_t _mask;
+  std::size_t _buffer_size;
+  std::vector<char> _buffers;
+  io_uring_buf_ring* _bufs = nullptr;
+  std::size_t _bufs_size = 0;
+  std::uint16_t _tail = 0;
+};
+}  // namespace beryl
@@ -0,0 +1,62 @@
+#include "beryl/mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include <system_error>
+
+namespace beryl {
+namespace {
+[[noreturn]] void
+throw_system_error(const char* what, const std::string& path) {
+  throw std::system_error(errno, std::generic_category(),
+                          std::string(what) + " `" + path + "`");
+}
+
+class file_descriptor {
+public:
+  explicit file_descriptor(int fd) noexcept : _fd(fd) {}
+  ~file_descriptor() { ::close(_fd); }
+  file_descriptor(const file_descriptor&) = delete;
+  file_descriptor& operator=(const file_descriptor&) = delete;
+  [[nodiscard]] int get() const noexcept { return _fd; }
+
+private:
+  int _fd;
+};
+}  // namespace
+
+mapped_file::mapped_file(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw_system_error("can't open", path);
+  }
+  file_descriptor file(fd);
+  struct stat st {};
+  if (::fstat(file.get(), &st) != 0) {
+    throw_system_error("can't stat", path);
+  }
+  _size = static_cast<std::size_t>(st.st_size);
+  if (_size == 0) {
+    // `mmap` rejects zero length mappings
+    return;
+  }
+  void* data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file.get(), 0);
+  if (data == MAP_FAILED) {
+    throw_system_error("can't map", path);
+  }
+  ::madvise(data, _size, MADV_SEQUENTIAL);
+  _data = static_cast<const char*>(data);
+}
+
+mapped_file::~mapped_file() {
+  if (_data) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    ::munmap(const_cast<char*>(_data), _size);
+  }
+}
+}  // namespace beryl
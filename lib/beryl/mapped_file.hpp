@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+#include <string>
+#include <string_view>
+
+namespace beryl {
+// A read-only memory mapping of a whole file. The pages are brought in
+// by page faults as the content is accessed, the kernel is advised to
+// read ahead sequentially.
+class mapped_file {
+public:
+  // @throw std::system_error if the file can't be opened or mapped
+  explicit mapped_file(const std::string& path);
+  ~mapped_file();
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  [[nodiscard]] std::string_view content() const noexcept {
+    return std::string_view(_data, _size);
+  }
+
+private:
+  const char* _data = nullptr;
+  std::size_t _size = 0;
+};
+}  // namespace beryl
@@ -0,0 +1,107 @@
+#include "beryl/negative_cache.hpp"
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "beryl/cache_shard.hpp"
+#include "beryl/resource_record.hpp"
+
+namespace beryl {
+namespace {
+// NXDOMAIN entries do not depend on a record type. Zero is a reserved
+// record type value, thus it doesn't clash with any NODATA entry.
+constexpr std::uint16_t nxdomain_tag = 0;
+
+std::uint16_t to_tag(record_type type) noexcept {
+  return static_cast<std::uint16_t>(type);
+}
+}  // namespace
+
+negative_cache::negative_cache(std::size_t max_entries,
+                               std::size_t shard_count,
+                               const chrono::seconds& max_ttl,
+                               const chrono::time_point& now)
+    : _max_ttl(max_ttl) {
+  assert(shard_count > 0 && "shard count must be positive");
+  _shards.reserve(shard_count);
+  for (std::size_t i = 0; i < shard_count; ++i) {
+    _shards.push_back(std::make_unique<shard>(max_entries / shard_count, now));
+  }
+}
+
+negative_cache::~negative_cache() = default;
+
+void negative_cache::insert_nxdomain(const domain_name& name,
+                                     const domain_name& zone,
+                                     const soa_record& soa,
+                                     const chrono::time_point& now) {
+  insert(name, nxdomain_tag, negative_answer::nxdomain, zone, soa, now);
+}
+
+void negative_cache::insert_nodata(const domain_name& name, record_type type,
+                                   const domain_name& zone,
+                                   const soa_record& soa,
+                                   const chrono::time_point& now) {
+  insert(name, to_tag(type), negative_answer::nodata, zone, soa, now);
+}
+
+void negative_cache::insert(const domain_name& name, std::uint16_t tag,
+                            negative_answer answer, const domain_name& zone,
+                            const soa_record& soa,
+                            const chrono::time_point& now) {
+  auto ttl = std::min({static_cast<chrono::seconds::rep>(soa.ttl(now)),
+                       static_cast<chrono::seconds::rep>(soa.min_ttl),
+                       _max_ttl.count()});
+  if (ttl <= 0) {
+    return;
+  }
+  auto expiration = now + chrono::seconds(ttl);
+  auto e = std::make_shared<const entry>(
+      entry{answer, zone,
+            std::make_shared<const soa_record>(
+                expiration, soa.nameserver, soa.mailbox, soa.serial,
+                soa.refresh, soa.retry, soa.expire, soa.min_ttl)});
+  auto hash = _impl::cache_key_hash(name, tag);
+  auto& s = *_shards[_impl::cache_shard_index(hash, _shards.size())];
+  s.insert(hash, name, tag, std::move(e), expiration, 1, now);
+}
+
+negative_cache::entry_ptr negative_cache::find(const domain_name& name,
+                                               record_type type,
+                                               const chrono::time_point& now) {
+  auto probe = [this, &now](const auto& n, std::uint16_t tag) {
+    auto hash = _impl::cache_key_hash(n, tag);
+    auto& s = *_shards[_impl::cache_shard_index(hash, _shards.size())];
+    return s.find(hash, n, tag, now).value_or(nullptr);
+  };
+
+  if (auto e = probe(name, to_tag(type))) {
+    return e;
+  }
+  // Walk from the name itself up to the top level domain looking for
+  // the closest cached non-existent encloser.
+  auto label_count =
+      static_cast<std::size_t>(std::distance(name.begin(), name.end()));
+  for (; label_count > 0; --label_count) {
+    if (auto e = probe(domain_name_view(name, label_count), nxdomain_tag)) {
+      return e;
+    }
+  }
+  return nullptr;
+}
+
+void negative_cache::expire(const chrono::time_point& now) {
+  for (auto& s : _shards) {
+    s->expire(now);
+  }
+}
+
+std::size_t negative_cache::size() const {
+  std::size_t result = 0;
+  for (const auto& s : _shards) {
+    result += s->size();
+  }
+  return result;
+}
+}  // namespace beryl
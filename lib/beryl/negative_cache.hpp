@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "beryl/chrono.hpp"
+#include "beryl/domain_name.hpp"
+#include "beryl/record_type.hpp"
+
+namespace beryl {
+class soa_record;
+namespace _impl {
+template <typename Value>
+class cache_shard;
+}
+
+enum class negative_answer : std::uint8_t { nxdomain, nodata };
+
+// A concurrent cache of negative answers (RFC 2308).
+//
+// NODATA answers are cached per (domain name, record type). NXDOMAIN
+// answers are cached per domain name and, following RFC 8020, cover
+// the whole subtree below that name: one entry answers a flood of queries
+// for random subdomains of a non-existent name.
+//
+// The negative TTL is the minimum of the TTL of the SOA record of the zone,
+// the `minimum` field of that record and the configured upper bound.
+// The cache keeps a copy of the SOA record in the expiration mode, so the
+// TTL of the copy is the remaining negative TTL ready to be put into
+// the authority section of a response.
+class negative_cache {
+public:
+  struct entry {
+    negative_answer answer;
+    // the owner of the SOA record, i.e. the apex of the zone
+    domain_name zone;
+    std::shared_ptr<const soa_record> soa;
+  };
+  using entry_ptr = std::shared_ptr<const entry>;
+
+  static constexpr std::chrono::hours default_max_ttl{3};
+
+  // @param max_entries - the upper bound of the number of cached entries;
+  //     the bound is divided evenly among shards.
+  // @param shard_count - the number of shards, must be positive.
+  // @param max_ttl - the upper bound of the negative TTL.
+  // @param now - the time the expiration timers start from.
+  negative_cache(std::size_t max_entries, std::size_t shard_count,
+                 const chrono::seconds& max_ttl = default_max_ttl,
+                 const chrono::time_point& now = chrono::now());
+  ~negative_cache();
+  negative_cache(const negative_cache&) = delete;
+  negative_cache& operator=(const negative_cache&) = delete;
+
+  // Caches the fact that `name` and all the names below it do not exist.
+  void insert_nxdomain(const domain_name& name, const domain_name& zone,
+                       const soa_record& soa,
+                       const chrono::time_point& now = chrono::now());
+  // Caches the fact that `name` exists but has no records of `type`.
+  void insert_nodata(const domain_name& name, record_type type,
+                     const domain_name& zone, const soa_record& soa,
+                     const chrono::time_point& now = chrono::now());
+
+  // @return an unexpired entry covering the query or `nullptr`. A NODATA
+  //     entry for the name and the type takes precedence over an NXDOMAIN
+  //     entry for the name or its closest cached ancestor.
+  entry_ptr find(const domain_name& name, record_type type,
+                 const chrono::time_point& now = chrono::now());
+
+  // Evicts all the entries expired by `now`. Meant to be called
+  // periodically, e.g. once a second.
+  void expire(const chrono::time_point& now = chrono::now());
+
+  [[nodiscard]] std::size_t size() const;
+
+private:
+  using shard = _impl::cache_shard<entry_ptr>;
+
+  void insert(const domain_name& name, std::uint16_t tag,
+              negative_answer answer, const domain_name& zone,
+              const soa_record& soa, const chrono::time_point& now);
+
+  std::vector<std::unique_ptr<shard>> _shards;
+  chrono::seconds _max_ttl;
+};
+}  // namespace beryl
@@ -0,0 +1,581 @@
+#include "beryl/query_responder.hpp"
+
+#include <cstddef>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "beryl/chrono.hpp"
+#include "beryl/record_type.hpp"
+#include "beryl/resource_record.hpp"
+#include "beryl/wire.hpp"
+#include "beryl/zone_image.hpp"
+
+namespace beryl {
+namespace {
+void set_uint16(std::string& out, std::size_t offset, std::uint16_t value) {
+  static constexpr unsigned byte_bits = 8;
+  out[offset] = static_cast<char>(value >> byte_bits);
+  out[offset + 1] = static_cast<char>(value);
+}
+
+std::size_t label_count(const domain_name& name) noexcept {
+  return static_cast<std::size_t>(std::distance(name.begin(), name.end()));
+}
+
+void put_record(std::string& out, const domain_name& owner,
+                const resource_record& rr) {
+  wire::put_name(out, owner);
+  wire::put_uint16(out, static_cast<std::uint16_t>(rr.type()));
+  wire::put_uint16(out, dns::class_in);
+  wire::put_uint32(out, rr.ttl(chrono::zone_time));
+  std::size_t length_offset = out.size();
+  wire::put_uint16(out, 0);
+  wire::put_rdata(out, rr);
+  set_uint16(out, length_offset,
+             static_cast<std::uint16_t>(out.size() - length_offset - 2));
+}
+
+void put_record(std::string& out, const domain_name& owner, record_type type,
+                const zone_image::record& r) {
+  wire::put_name(out, owner);
+  wire::put_uint16(out, static_cast<std::uint16_t>(type));
+  wire::put_uint16(out, dns::class_in);
+  wire::put_uint32(out, r.ttl);
+  wire::put_uint16(out, static_cast<std::uint16_t>(r.rdata.size()));
+  out.append(r.rdata.data(), r.rdata.size());
+}
+
+// Builds a response in place: the header is written last, when
+// the counts are known.
+class response_builder {
+public:
+  response_builder(std::string& out, std::string_view query,
+                   std::uint16_t flags, std::size_t max_size)
+      : _out(out), _flags(flags), _max_size(max_size) {
+    _out.assign(dns::header_size, '\0');
+    _out[0] = query[0];
+    _out[1] = query[1];
+  }
+
+  void set_question(std::string_view question) {
+    _out.append(question.data(), question.size());
+    _question_end = _out.size();
+    _qdcount = 1;
+  }
+  void set_authoritative() noexcept { _flags |= dns::flag_aa; }
+  // The sections aren't copied; they are to follow the response unless
+  // it is truncated, see `sections_kept`.
+  void set_sections(const answer_template& t) {
+    if (t.authoritative) {
+      set_authoritative();
+    }
+    _sections_size = t.sections.size();
+    _ancount = t.ancount;
+    _nscount = t.nscount;
+    _arcount = t.arcount;
+  }
+  [[nodiscard]] bool sections_kept() const noexcept {
+    return _sections_size > 0;
+  }
+  [[nodiscard]] bool has_answers() const noexcept { return _ancount > 0; }
+
+  // @param record - a record, or the type and a record of an image
+  template <typename... Record>
+  void answer(const domain_name& owner, const Record&... record) {
+    put_record(_out, owner, record...);
+    ++_ancount;
+  }
+  template <typename... Record>
+  void authority(const domain_name& owner, const Record&... record) {
+    put_record(_out, owner, record...);
+    ++_nscount;
+  }
+  template <typename... Record>
+  void additional(const domain_name& owner, const Record&... record) {
+    put_record(_out, owner, record...);
+    ++_arcount;
+  }
+
+  // A response exceeding the limit is cut down to the question, with
+  // the TC flag telling the client to retry over TCP.
+  void finish(dns::rcode rc) {
+    if (_out.size() + _sections_size > _max_size) {
+      _out.resize(_question_end);
+      _sections_size = 0;
+      _flags |= dns::flag_tc;
+      _ancount = _nscount = _arcount = 0;
+    }
+    set_uint16(_out, dns::flags_offset,
+               static_cast<std::uint16_t>(_flags |
+                                          static_cast<std::uint16_t>(rc)));
+    set_uint16(_out, dns::qdcount_offset, _qdcount);
+    set_uint16(_out, dns::ancount_offset, _ancount);
+    set_uint16(_out, dns::nscount_offset, _nscount);
+    set_uint16(_out, dns::arcount_offset, _arcount);
+  }
+
+private:
+  std::string& _out;
+  std::uint16_t _flags;
+  std::size_t _max_size;
+  std::size_t _question_end = dns::header_size;
+  std::size_t _sections_size = 0;
+  std::uint16_t _qdcount = 0;
+  std::uint16_t _ancount = 0;
+  std::uint16_t _nscount = 0;
+  std::uint16_t _arcount = 0;
+};
+
+bool type_matches(record_type type, std::uint16_t qtype) noexcept {
+  return qtype == dns::type_any || static_cast<std::uint16_t>(type) == qtype;
+}
+
+// Adds the addresses of the name servers within the zone as glue.
+void add_glue(response_builder& response, const zone::record_tree& records,
+              const std::vector<const resource_record*>& name_servers) {
+  for (const auto* rr : name_servers) {
+    const auto& target = rr->cast<ns_record>()->name;
+    auto cur = records.find(target);
+    for (; cur != records.end() && cur.domain() == target; cur.increment()) {
+      if (auto type = cur.value()->type();
+          type == record_type::a || type == record_type::aaaa) {
+        response.additional(target, *cur.value());
+      }
+    }
+  }
+}
+
+void add_soa(response_builder& response, const zone& z) {
+  const auto& records = z.records();
+  auto cur = records.find(z.origin());
+  for (; cur != records.end() && cur.domain() == z.origin(); cur.increment()) {
+    if (cur.value()->type() == record_type::soa) {
+      response.authority(z.origin(), *cur.value());
+      return;
+    }
+  }
+}
+
+void answer_from_zone(response_builder& response, const zone& z,
+                      const domain_name& qname, std::uint16_t qtype) {
+  const auto& records = z.records();
+  std::size_t origin_depth = label_count(z.origin());
+  std::size_t qname_depth = label_count(qname);
+
+  // The topmost zone cut between the origin and the name, if any, and
+  // whether the name exists, possibly as an empty non-terminal.
+  std::optional<domain_name> cut;
+  std::vector<const resource_record*> name_servers;
+  std::size_t depth = 0;
+  auto cur = records.find(qname, [&](const domain_name& name, auto first,
+                                     auto last) {
+    if (depth++ <= origin_depth || cut) {
+      return;
+    }
+    for (; first != last; ++first) {
+      if ((*first)->type() == record_type::ns) {
+        name_servers.push_back(first->get());
+      }
+    }
+    if (!name_servers.empty()) {
+      cut.emplace(name);
+    }
+  });
+
+  if (cut) {
+    for (const auto* rr : name_servers) {
+      response.authority(*cut, *rr);
+    }
+    add_glue(response, records, name_servers);
+    response.finish(dns::rcode::no_error);
+    return;
+  }
+
+  response.set_authoritative();
+  if (depth <= qname_depth) {
+    add_soa(response, z);
+    response.finish(dns::rcode::name_error);
+    return;
+  }
+
+  const resource_record* cname = nullptr;
+  for (; cur != records.end() && cur.domain() == qname; cur.increment()) {
+    const auto& rr = *cur.value();
+    if (type_matches(rr.type(), qtype)) {
+      response.answer(qname, rr);
+    } else if (rr.type() == record_type::cname) {
+      cname = &rr;
+    }
+  }
+  if (cname && qtype != static_cast<std::uint16_t>(record_type::cname)) {
+    response.answer(qname, *cname);
+  }
+  if (!response.has_answers()) {
+    add_soa(response, z);
+  }
+  response.finish(dns::rcode::no_error);
+}
+// Answers as `answer_from_zone` does, from the records of an image.
+void answer_from_image(response_builder& response, const zone_image& image,
+                       const domain_name& origin, const domain_name& qname,
+                       std::uint16_t qtype) {
+  using rrset_view = zone_image::rrset_view;
+  auto add_soa = [&]() {
+    if (auto soa = image.find(origin, record_type::soa)) {
+      soa->for_each([&](const zone_image::record& r) {
+        response.authority(origin, record_type::soa, r);
+      });
+    }
+  };
+
+  // the topmost zone cut between the origin and the name, if any
+  domain_name cut = origin;
+  std::optional<rrset_view> name_servers;
+  for (auto label = std::next(qname.begin(), static_cast<std::ptrdiff_t>(
+                                                 label_count(origin)));
+       label != qname.end() && !name_servers; ++label) {
+    cut.add_subdomain(*label);
+    name_servers = image.find(cut, record_type::ns);
+  }
+  if (name_servers) {
+    std::vector<domain_name> targets;
+    name_servers->for_each([&](const zone_image::record& r) {
+      response.authority(cut, record_type::ns, r);
+      if (wire::name_length(r.rdata) == r.rdata.size()) {
+        targets.push_back(domain_name::from_wire(r.rdata));
+      }
+    });
+    for (const auto& target : targets) {
+      for (auto type : {record_type::a, record_type::aaaa}) {
+        if (auto glue = image.find(target, type)) {
+          glue->for_each([&](const zone_image::record& r) {
+            response.additional(target, type, r);
+          });
+        }
+      }
+    }
+    response.finish(dns::rcode::no_error);
+    return;
+  }
+
+  response.set_authoritative();
+  std::optional<rrset_view> cname;
+  bool exists = image.for_each_rrset(qname, [&](const rrset_view& rrset) {
+    if (type_matches(rrset.type(), qtype)) {
+      rrset.for_each([&](const zone_image::record& r) {
+        response.answer(qname, rrset.type(), r);
+      });
+    } else if (rrset.type() == record_type::cname) {
+      cname = rrset;
+    }
+  });
+  if (!exists) {
+    add_soa();
+    response.finish(dns::rcode::name_error);
+    return;
+  }
+  if (cname && qtype != static_cast<std::uint16_t>(record_type::cname)) {
+    cname->for_each([&](const zone_image::record& r) {
+      response.answer(qname, record_type::cname, r);
+    });
+  }
+  if (!response.has_answers()) {
+    add_soa();
+  }
+  response.finish(dns::rcode::no_error);
+}
+}  // namespace
+
+answer_templates::answer_templates(const zone& z) {
+  static const std::string id(2, '\0');
+  const auto& records = z.records();
+  std::vector<std::uint16_t> types;
+  std::string question;
+  std::string response;
+  for (auto cur = records.begin(); cur != records.end();) {
+    domain_name name = cur.domain();
+    types.assign(1, dns::type_any);
+    for (; cur != records.end() && cur.domain() == name; cur.increment()) {
+      auto type = static_cast<std::uint16_t>(cur.value()->type());
+      if (std::find(types.begin(), types.end(), type) == types.end()) {
+        types.push_back(type);
+      }
+    }
+    for (auto type : types) {
+      question.clear();
+      wire::put_name(question, name);
+      wire::put_uint16(question, type);
+      std::size_t key_size = question.size();
+      wire::put_uint16(question, dns::class_in);
+      response_builder builder(response, id, dns::flag_qr, dns::max_tcp_size);
+      builder.set_question(question);
+      answer_from_zone(builder, z, name, type);
+
+      answer_template t;
+      auto flags = wire::get_uint16(response.data() + dns::flags_offset);
+      t.authoritative = flags & dns::flag_aa;
+      t.rcode = static_cast<dns::rcode>(flags & dns::rcode_mask);
+      t.ancount = wire::get_uint16(response.data() + dns::ancount_offset);
+      t.nscount = wire::get_uint16(response.data() + dns::nscount_offset);
+      t.arcount = wire::get_uint16(response.data() + dns::arcount_offset);
+      t.sections = response.substr(dns::header_size + question.size());
+      _templates.emplace(question.substr(0, key_size), std::move(t));
+    }
+  }
+}
+
+std::size_t answer_templates::memory_usage() const noexcept {
+  // a string keeps a short content within itself
+  static const std::size_t inline_capacity = std::string().capacity();
+  auto heap_size = [](const std::string& str) {
+    return str.capacity() > inline_capacity ? str.capacity() + 1 : 0;
+  };
+  // a node of the table holds an entry and the pointer to the next node
+  std::size_t usage =
+      _templates.bucket_count() * sizeof(void*) +
+      _templates.size() *
+          (sizeof(decltype(_templates)::value_type) + sizeof(void*));
+  for (const auto& [key, t] : _templates) {
+    usage += heap_size(key) + heap_size(t.sections);
+  }
+  return usage;
+}
+
+namespace _impl {
+const std::string* response_cache::find(const std::string& key) noexcept {
+  if (_entries.empty()) {
+    return nullptr;
+  }
+  auto it = _entries.find(key);
+  if (it == _entries.end()) {
+    return nullptr;
+  }
+  it->second.visited = true;
+  return &it->second.response;
+}
+
+void response_cache::insert(const std::string& key,
+                            const std::string& response) {
+  if (_capacity == 0) {
+    return;
+  }
+  if (_entries.size() >= _capacity) {
+    evict();
+  }
+  auto it = _entries.emplace(key, entry{response}).first;
+  entry& e = it->second;
+  e.key = &it->first;
+  e.older = _head;
+  if (_head) {
+    _head->newer = &e;
+  }
+  _head = &e;
+  if (!_tail) {
+    _tail = &e;
+  }
+}
+
+void response_cache::clear() noexcept {
+  _entries.clear();
+  _head = _tail = _hand = nullptr;
+}
+
+// The hand moves from the oldest entry towards the newest one, clears
+// the `visited` bit of the entries it passes and evicts the first entry
+// without the bit set.
+void response_cache::evict() {
+  entry* victim = _hand ? _hand : _tail;
+  while (victim->visited) {
+    victim->visited = false;
+    victim = victim->newer ? victim->newer : _tail;
+  }
+  _hand = victim->newer;
+  (victim->newer ? victim->newer->older : _head) = victim->older;
+  (victim->older ? victim->older->newer : _tail) = victim->newer;
+  // the key belongs to the entry erased
+  _entries.erase(_entries.find(*victim->key));
+}
+}  // namespace _impl
+
+void prerender(zone& z) {
+  z.set_templates(std::make_shared<const answer_templates>(z));
+}
+
+query_responder::query_responder(const zone_table& zones,
+                                 std::size_t cache_capacity)
+    : _table(zones),
+      _version(zones.version()),
+      _zones(zones.snapshot()),
+      _cache(cache_capacity) {}
+
+void query_responder::refresh() {
+  _version = _table.version();
+  _zones = _table.snapshot();
+  _cache.clear();
+}
+
+const zone* query_responder::find_zone(const domain_name& name) {
+  _scratch = name;
+  for (;;) {
+    if (auto it = _zones.find(_scratch); it != _zones.end()) {
+      return it->second.get();
+    }
+    if (_scratch.begin() == _scratch.end()) {
+      return nullptr;
+    }
+    _scratch.remove_subdomain();
+  }
+}
+
+bool query_responder::respond(std::string_view query, std::string& response,
+                              std::size_t max_size) {
+  if (outdated()) {
+    refresh();
+  }
+  std::string_view sections;
+  if (!render(query, response, sections, max_size)) {
+    return false;
+  }
+  response.append(sections.data(), sections.size());
+  return true;
+}
+
+bool query_responder::respond(std::string_view query,
+                              response_parts& response, std::size_t max_size) {
+  response.sections = {};
+  return render(query, response.head, response.sections, max_size);
+}
+
+bool query_responder::render(std::string_view query, std::string& response,
+                             std::string_view& sections,
+                             std::size_t max_size) {
+  auto message = dns_message_view::parse(query);
+  if (!message || message->is_response()) {
+    return false;
+  }
+
+  static constexpr std::uint16_t echoed_flags =
+      dns::opcode_mask << dns::opcode_shift | dns::flag_rd;
+  auto flags = static_cast<std::uint16_t>(dns::flag_qr |
+                                          (message->flags() & echoed_flags));
+  if (message->opcode() != 0) {
+    response_builder(response, query, flags, max_size)
+        .finish(dns::rcode::not_implemented);
+    return true;
+  }
+  auto question = message->question();
+  if (!question) {
+    response_builder(response, query, flags, max_size)
+        .finish(dns::rcode::format_error);
+    return true;
+  }
+  // the name is lower cased, the length octets are below the letters
+  _key.assign(question->data());
+  for (std::size_t i = 0; i < question->name().data().size(); ++i) {
+    if (_key[i] >= 'A' && _key[i] <= 'Z') {
+      _key[i] = static_cast<char>(_key[i] - 'A' + 'a');
+    }
+  }
+  wire::put_uint16(_key, static_cast<std::uint16_t>(
+                             std::min(max_size, dns::max_tcp_size)));
+  if (answer_from_cache(*question, query, flags, response)) {
+    return true;
+  }
+  if (!answer(*question, query, flags, max_size, response, sections)) {
+    return true;
+  }
+  switch (static_cast<dns::rcode>(
+      wire::get_uint16(response.data() + dns::flags_offset) &
+      dns::rcode_mask)) {
+    case dns::rcode::refused:
+    case dns::rcode::format_error:
+    case dns::rcode::name_error:
+      break;
+    default:
+      _cache.insert(_key, response);
+  }
+  return true;
+}
+
+bool query_responder::answer(const dns_question& question,
+                             std::string_view query, std::uint16_t flags,
+                             std::size_t max_size, std::string& response,
+                             std::string_view& sections) {
+  response_builder builder(response, query, flags, max_size);
+  builder.set_question(question.data());
+  if (!question.supported_class()) {
+    builder.finish(dns::rcode::refused);
+    return true;
+  }
+
+  domain_name qname = question.name().to_domain_name();
+  const zone* z = find_zone(qname);
+  if (!z) {
+    builder.finish(dns::rcode::refused);
+    return true;
+  }
+  if (answer_from_template(*z, question, query, flags, max_size, response,
+                           sections)) {
+    return false;
+  }
+  if (const auto* image = z->image()) {
+    answer_from_image(builder, *image, z->origin(), qname, question.qtype());
+  } else {
+    answer_from_zone(builder, *z, qname, question.qtype());
+  }
+  return true;
+}
+
+bool query_responder::answer_from_template(const zone& z,
+                                           const dns_question& question,
+                                           std::string_view query,
+                                           std::uint16_t flags,
+                                           std::size_t max_size,
+                                           std::string& response,
+                                           std::string_view& sections) {
+  const auto* templates = z.templates();
+  if (!templates) {
+    return false;
+  }
+  // the lower cased name and the type
+  _template_key.assign(_key, 0,
+                       question.data().size() - sizeof(std::uint16_t));
+  const auto* t = templates->find(_template_key);
+  if (!t) {
+    return false;
+  }
+  response_builder builder(response, query, flags, max_size);
+  builder.set_question(question.data());
+  builder.set_sections(*t);
+  builder.finish(t->rcode);
+  if (builder.sections_kept()) {
+    sections = t->sections;
+  }
+  return true;
+}
+
+bool query_responder::answer_from_cache(const dns_question& question,
+                                        std::string_view query,
+                                        std::uint16_t flags,
+                                        std::string& response) {
+  const std::string* cached = _cache.find(_key);
+  if (!cached) {
+    return false;
+  }
+  response = *cached;
+  response[0] = query[0];
+  response[1] = query[1];
+  auto cached_flags = wire::get_uint16(response.data() + dns::flags_offset);
+  set_uint16(response, dns::flags_offset,
+             static_cast<std::uint16_t>((cached_flags & ~dns::flag_rd) |
+                                        (flags & dns::flag_rd)));
+  auto q = question.data();
+  std::copy(q.begin(), q.end(), response.begin() + dns::header_size);
+  return true;
+}
+}  // namespace beryl
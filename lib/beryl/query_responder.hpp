@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "beryl/dns_message.hpp"
+#include "beryl/domain_name.hpp"
+#include "beryl/zone_table.hpp"
+
+namespace beryl {
+// The answer to a question rendered ahead: the sections following
+// the question, as the responder renders them, and the header fields
+// they go with.
+struct answer_template {
+  bool authoritative = false;
+  dns::rcode rcode = dns::rcode::no_error;
+  std::uint16_t ancount = 0;
+  std::uint16_t nscount = 0;
+  std::uint16_t arcount = 0;
+  std::string sections;
+};
+
+// The answers to every name of a zone and every type the name has, as
+// well as ANY, rendered ahead, e.g. at load time. A question about a name
+// or a type which isn't there, i.e. a negative answer, isn't covered.
+class answer_templates {
+public:
+  explicit answer_templates(const zone& z);
+
+  // @param key - the name in the wire format, in lower case, followed by
+  //     the type
+  // @return the answer or `nullptr` if it isn't rendered
+  [[nodiscard]] const answer_template*
+  find(const std::string& key) const noexcept {
+    auto it = _templates.find(key);
+    return it == _templates.end() ? nullptr : &it->second;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return _templates.size(); }
+  // @return the bytes the templates take, including those of the hash
+  //     table, approximately
+  [[nodiscard]] std::size_t memory_usage() const noexcept;
+
+private:
+  std::unordered_map<std::string, answer_template> _templates;
+};
+
+// Renders the answers of the zone ahead, see `answer_templates`, and
+// attaches them to the zone. A responder serves them with a lookup, and
+// a copy unless the response is sent with a gather write, see
+// `response_parts`, so even the first query about a name is answered as
+// fast as a cached one.
+void prerender(zone& z);
+
+// A response to be sent with a gather write, e.g. `sendmsg`, in two
+// parts: the header and the question, rendered for the query, and
+// the sections following them. The sections are empty when the whole
+// response is in `head`, otherwise they are those of an answer rendered
+// ahead, referred to rather than copied.
+struct response_parts {
+  std::string head;
+  std::string_view sections;
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return head.size() + sections.size();
+  }
+};
+
+namespace _impl {
+// The responses of a responder by question. The capacity is enforced with
+// SIEVE, as `cache_shard` does, for a single thread and with no expiration:
+// a hit only sets a bit, an insertion over the capacity evicts one entry,
+// so a flood of questions asked once passes through the cache without
+// wiping the responses asked for often.
+class response_cache {
+public:
+  explicit response_cache(std::size_t capacity) : _capacity(capacity) {}
+  response_cache(const response_cache&) = delete;
+  response_cache& operator=(const response_cache&) = delete;
+
+  // @return the response or `nullptr` if it isn't cached
+  const std::string* find(const std::string& key) noexcept;
+  // @pre the key isn't cached
+  void insert(const std::string& key, const std::string& response);
+  void clear() noexcept;
+
+  [[nodiscard]] std::size_t size() const noexcept { return _entries.size(); }
+
+private:
+  struct entry {
+    std::string response;
+    // SIEVE state
+    bool visited = false;
+    entry* newer = nullptr;
+    entry* older = nullptr;
+    const std::string* key = nullptr;
+  };
+
+  void evict();
+
+  std::size_t _capacity;
+  std::unordered_map<std::string, entry> _entries;
+  entry* _head = nullptr;
+  entry* _tail = nullptr;
+  entry* _hand = nullptr;
+};
+}  // namespace _impl
+
+// Answers DNS queries from the zones of a table, authoritatively:
+// -- the records of the type asked for, or a CNAME record of the name;
+// -- a referral to the name servers of a delegated subdomain;
+// -- the SOA record of the zone for a name or a type it doesn't have;
+// -- REFUSED for a name outside of the zones.
+// A responder is meant to be used by one thread. It keeps a copy of
+// the table, which it refreshes when a zone is published, so answering
+// takes neither locks nor reference counts shared with other threads.
+//
+// The response to a question doesn't change until a zone is published,
+// so the responder caches the responses it renders, keyed by
+// the question in lower case and the size limit. A cached response is
+// patched with the ID, the RD flag and the question of the query, i.e.
+// the case the name is asked in. The cache is dropped on a publication;
+// when it is full, a response is evicted, see `_impl::response_cache`.
+// The answers of a prerendered zone aren't cached, as they are served as
+// fast, nor are REFUSED, FORMERR and NXDOMAIN, which a flood of random
+// names would fill the cache with.
+class query_responder {
+public:
+  static constexpr std::size_t default_cache_capacity = 16384;
+
+  // @param cache_capacity - the most responses cached, zero for none
+  explicit query_responder(const zone_table& zones,
+                           std::size_t cache_capacity = default_cache_capacity);
+
+  // @param query - a DNS message
+  // @param response - gets the response; its storage is reused
+  // @param max_size - the size limit of the response, over which it is
+  //     truncated, e.g. `dns::max_tcp_size` for a query received over TCP
+  // @return false if the message deserves no response, e.g. it is too
+  //     short or it is a response itself
+  bool respond(std::string_view query, std::string& response,
+               std::size_t max_size = dns::max_udp_size);
+  // Answers the query as the other overload does, but the sections of
+  // an answer rendered ahead are referred to. They belong to the zones
+  // the responder keeps, so they stay valid until `refresh`; this
+  // overload doesn't refresh the zones, the caller does once
+  // the responses referring to them are sent, see `outdated`.
+  bool respond(std::string_view query, response_parts& response,
+               std::size_t max_size = dns::max_udp_size);
+
+  // @return whether a zone has been published since the zones were taken
+  [[nodiscard]] bool outdated() const noexcept {
+    return _table.version() != _version;
+  }
+  // Takes the published zones, drops the cache.
+  void refresh();
+
+  [[nodiscard]] std::size_t cached_count() const noexcept {
+    return _cache.size();
+  }
+
+private:
+  // @param sections - gets the sections of an answer rendered ahead,
+  //     which follow the response, or nothing
+  bool render(std::string_view query, std::string& response,
+              std::string_view& sections, std::size_t max_size);
+  const zone* find_zone(const domain_name& name);
+  // @return whether the response is worth caching, i.e. it isn't
+  //     rendered ahead
+  bool answer(const dns_question& question, std::string_view query,
+              std::uint16_t flags, std::size_t max_size,
+              std::string& response, std::string_view& sections);
+  // @return whether the response is found
+  bool answer_from_cache(const dns_question& question, std::string_view query,
+                         std::uint16_t flags, std::string& response);
+  // @return whether the zone has the answer rendered
+  bool answer_from_template(const zone& z, const dns_question& question,
+                            std::string_view query, std::uint16_t flags,
+                            std::size_t max_size, std::string& response,
+                            std::string_view& sections);
+
+  const zone_table& _table;
+  std::uint64_t _version;
+  zone_table::zone_map _zones;
+  domain_name _scratch{"."};
+  _impl::response_cache _cache;
+  // the key of the question being answered; its storage is reused
+  std::string _key;
+  std::string _template_key;
+};
+}  // namespace beryl
@@ -1,61 +1,39 @@
 #include "beryl/read_zone.hpp"
 
+#include <cassert>
+#include <cctype>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <future>
 #include <iostream>
-#include <memory>
+#include <limits>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-#include <boost/tokenizer.hpp>
+#include <boost/system/error_code.hpp>
 
 #include "beryl/domain_name.hpp"
+#include "beryl/gzip_reader.hpp"
+#include "beryl/mapped_file.hpp"
 #include "beryl/record_class.hpp"
 #include "beryl/record_consumer.hpp"
 #include "beryl/record_type.hpp"
 #include "beryl/resource_record.hpp"
+#include "beryl/string.hpp"
 
 namespace beryl {
 namespace {
-std::string normalize_line(std::string&& line) {
-  // remove comments
-  if (std::size_t pos = line.find_first_of(';'); pos != std::string::npos) {
-    line.erase(pos);
-  }
-  // remove trailing whitespaces
-  std::size_t last_not_space = line.find_last_not_of(' ');
-  line.erase(last_not_space == std::string::npos ? 0 : last_not_space + 1);
-
-  return std::move(line);
-}
-
-void verify_record_class(const std::string& rc) {
-  if (to_record_class(rc) == record_class::in) {
-    return;
-  }
-}
-
-void verify_single_soa_record(const domain_name& name, record_type rt,
-                              std::optional<domain_name>& zone_domain) {
-  if (zone_domain) {
-    if (rt == record_type::soa) {
-      throw std::runtime_error("second SOA record in the zone");
-    }
-  } else {
-    if (rt == record_type::soa) {
-      zone_domain = name;
-      return;
-    }
-    throw std::runtime_error(
-        "a zone must start with a SOA record but start with a " +
-        to_string(rt) + " record");
-  }
-}
-
 // Number of data tokens for resource record of different types.
 // Data tokens do not include common part for all resource records, i.e.
 // name, TTL, class (`IN`), type
-std::size_t data_token_count(record_type rt) {
+constexpr std::size_t data_token_count(record_type rt) {
   // clang-format off
   switch (rt) {
     // IPv4 address
@@ -65,164 +43,1101 @@ std::size_t data_token_count(record_type rt) {
     // nameserver name
     case record_type::ns:
     // canonical name
-    case record_type::cname: return 1;  // NOLINT(readability-magic-numbers)
+    case record_type::cname:
+    // domain name the address points to
+    case record_type::ptr: return 1;  // NOLINT(readability-magic-numbers)
     // primary nameserver name, domain admin mailbox, serial, refresh, retry,
     // expire, minimum
     case record_type::soa: return 7;  // NOLINT(readability-magic-numbers)
   }
   // clang-format off
   assert(false && "unexpected record type");
+  return 0;
 }
 
-inline std::size_t max_data_token_count() {
+constexpr std::size_t max_data_token_count() {
   return data_token_count(record_type::soa);
 }
 
-void verify_data_token_count(const std::vector<std::string>& data_tokens) {
-  if (data_tokens.size() > max_data_token_count()) {
-    throw std::runtime_error("too many tokens in the resource record");
+// owner, TTL, class, type and data
+constexpr std::size_t max_entry_token_count() {
+  constexpr std::size_t common_token_count = 4;
+  return common_token_count + max_data_token_count();
+}
+
+// @return the number or nothing if `str` is not a valid unsigned 32 bit
+//     integer.
+std::optional<std::uint32_t> str_to_uint32(std::string_view str) noexcept {
+  std::uint32_t result = 0;
+  const char* last = str.data() + str.size();
+  if (auto [ptr, ec] = std::from_chars(str.data(), last, result);
+      ec != std::errc() || ptr != last) {
+    return std::nullopt;
   }
+  return result;
 }
 
-class invalid_uint32 : public std::runtime_error {
-public:
-  invalid_uint32(const std::string& uint) : std::runtime_error(gen_msg(uint)) {}
+bool is_alpha(char c) noexcept {
+  return std::isalpha(static_cast<unsigned char>(c)) != 0;
+}
 
-private:
-  static std::string gen_msg(const std::string& uint32_str) {
-    std::ostringstream oss;
-    oss << "invalid unsigned 32 bit integer: `" << uint32_str << "`";
-    return oss.str();
+bool is_digit(char c) noexcept {
+  return std::isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+// Parses a TTL or an SOA timer: either a count of seconds or a sequence
+// of counts with units, e.g. `1w2d` or `1h30m`. The units are `s`, `m`,
+// `h`, `d` and `w`, in any case.
+std::optional<std::uint32_t> parse_time(std::string_view str) noexcept {
+  if (std::none_of(str.begin(), str.end(), is_alpha)) {
+    return str_to_uint32(str);
+  }
+  // clang-format off
+  constexpr std::uint64_t minute = 60, hour = 60 * minute, day = 24 * hour,
+                          week = 7 * day;
+  // clang-format on
+  std::uint64_t result = 0;
+  for (std::string_view rest = str; !rest.empty();) {
+    std::uint64_t count = 0;
+    const char* last = rest.data() + rest.size();
+    auto [ptr, ec] = std::from_chars(rest.data(), last, count);
+    if (ec != std::errc()) {
+      return std::nullopt;
+    }
+    rest.remove_prefix(static_cast<std::size_t>(ptr - rest.data()));
+    std::uint64_t unit = 1;
+    if (!rest.empty()) {
+      switch (std::tolower(static_cast<unsigned char>(rest.front()))) {
+        case 's': unit = 1; break;
+        case 'm': unit = minute; break;
+        case 'h': unit = hour; break;
+        case 'd': unit = day; break;
+        case 'w': unit = week; break;
+        default: return std::nullopt;
+      }
+      rest.remove_prefix(1);
+    }
+    if (count > std::numeric_limits<std::uint32_t>::max() / unit) {
+      return std::nullopt;
+    }
+    result += count * unit;
+    if (result > std::numeric_limits<std::uint32_t>::max()) {
+      return std::nullopt;
+    }
+  }
+  return static_cast<std::uint32_t>(result);
+}
+
+// A TTL starts with a digit. Signs are taken as well so that negative
+// TTLs are reported as invalid numbers rather than unknown record types.
+bool looks_like_ttl(std::string_view token) noexcept {
+  return !token.empty() &&
+         (is_digit(token.front()) || token.front() == '-' ||
+          token.front() == '+');
+}
+
+// Any class mnemonic, supported or not, so that an unsupported class is
+// reported as such rather than as an unknown record type.
+bool is_record_class(std::string_view token) noexcept {
+  for (std::string_view c : {"IN", "CH", "HS", "CS", "NONE", "ANY"}) {
+    if (str_iequals_upper(token, c)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool is_blank(char c) noexcept { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Parentheses group the lines of a multi-line entry. They are special only
+// at the boundaries of a token, so that e.g. `alpha(.lima.mike.` is
+// reported as an invalid domain name.
+//
+// @param on_paren - a functor taking the parenthesis.
+template <typename Functor>
+std::string_view strip_parens(std::string_view token, Functor&& on_paren) {
+  auto is_paren = [](char c) { return c == '(' || c == ')'; };
+  while (!token.empty() && is_paren(token.front())) {
+    on_paren(token.front());
+    token.remove_prefix(1);
+  }
+  std::size_t trailing = 0;
+  while (trailing < token.size() &&
+         is_paren(token[token.size() - trailing - 1])) {
+    ++trailing;
   }
+  for (char c : token.substr(token.size() - trailing)) {
+    on_paren(c);
+  }
+  token.remove_suffix(trailing);
+  return token;
+}
+
+// A problem with an entry of a zone file, found by the lexer or the parser.
+struct entry_error {
+  zone_error_code code;
+  // the offending token or the place the problem is found at; `nullptr`
+  // stands for the start of the entry
+  const char* where;
+  std::string message;
+};
+
+std::string quote(const char* what, std::string_view token) {
+  return std::string(what) + ": `" + std::string(token) + "`";
+}
+
+// An entry of a zone file, i.e. a directive or a resource record, which
+// spans one line or, within parentheses, several lines. Tokens point into
+// the text of the zone.
+struct zone_entry {
+  std::array<std::string_view, max_entry_token_count()> tokens;
+  std::size_t size = 0;
+  // the entry starts with a blank, i.e. the owner is omitted
+  bool owner_omitted = false;
+  // the count of characters and the count of line breaks of the entry
+  std::size_t length = 0;
+  std::uint32_t line_count = 0;
+  // the first lexical problem of the entry, if any
+  std::optional<entry_error> error;
 };
 
-std::uint32_t str_to_uint32(const std::string& str) {
-  try {
-    static constexpr int base = 10;
-    auto ll = stoll(str, nullptr, base);
-    auto uint32_max =
-        static_cast<decltype(ll)>(std::numeric_limits<std::uint32_t>::max());
-    if (ll < 0 || ll > uint32_max) {
-      throw invalid_uint32(str);
-    }
-    return static_cast<std::uint32_t>(ll);
-  } catch (const std::invalid_argument&) {
-    throw invalid_uint32(str);
-  } catch (const std::out_of_range&) { throw invalid_uint32(str); }
-}
-
-template <record_type RecordType>
-std::unique_ptr<resource_record>
-make_record(std::uint32_t ttl, const std::vector<std::string>& data_tokens) {
-  if (std::size_t got = data_tokens.size(),
-      expected = data_token_count(RecordType);
-      got != expected) {
-    std::ostringstream msg;
-    msg << "too " << (got < expected ? "few" : "many")
-        << " tokens in the resource record";
-    throw std::runtime_error(msg.str());
-  }
-  auto d = [&data_tokens](std::size_t index) {
-    return domain_name(data_tokens[index]);
+enum class lex_status { entry, need_more, end };
+
+// The lexer is a single pass state machine over the characters of the text.
+// An entry which is cut by the end of the text, unless `eof` is set, is not
+// returned; the caller is supposed to supply more text starting from
+// the same entry and call the lexer again.
+//
+// Unbalanced parentheses and too many tokens are recorded in `entry.error`;
+// the entry still spans up to its end, so that reading can go on with
+// the next one.
+lex_status lex_entry(std::string_view text, bool eof, zone_entry& entry) {
+  entry.size = 0;
+  entry.length = 0;
+  entry.line_count = 0;
+  entry.owner_omitted = !text.empty() && is_blank(text.front());
+  entry.error.reset();
+  auto fail = [&entry, text](zone_error_code code, std::size_t pos,
+                             const char* message) {
+    if (!entry.error) {
+      entry.error = entry_error{code, text.data() + pos, message};
+    }
   };
-  auto ui32 = [&data_tokens](std::size_t index) {
-    return str_to_uint32(data_tokens[index]);
+  int depth = 0;
+  bool unbalanced = false;
+  auto on_paren = [&depth, &unbalanced](char paren) {
+    if (paren == '(') {
+      ++depth;
+    } else if (depth == 0) {
+      unbalanced = true;
+    } else {
+      --depth;
+    }
   };
+  for (std::size_t pos = 0;;) {
+    if (pos == text.size()) {
+      if (!eof) {
+        return lex_status::need_more;
+      }
+      if (depth != 0) {
+        fail(zone_error_code::unbalanced_parentheses, pos,
+             "unbalanced parentheses");
+      }
+      entry.length = pos;
+      return pos == 0 ? lex_status::end : lex_status::entry;
+    }
+    char c = text[pos];
+    if (c == '\n') {
+      ++pos;
+      ++entry.line_count;
+      if (depth == 0) {
+        entry.length = pos;
+        return lex_status::entry;
+      }
+    } else if (is_blank(c)) {
+      ++pos;
+    } else if (c == ';') {
+      pos = std::min(text.find('\n', pos), text.size());
+    } else {
+      std::size_t begin = pos;
+      while (pos < text.size() && !is_blank(text[pos]) && text[pos] != '\n' &&
+             text[pos] != ';') {
+        ++pos;
+      }
+      if (pos == text.size() && !eof) {
+        return lex_status::need_more;
+      }
+      auto token = strip_parens(text.substr(begin, pos - begin), on_paren);
+      if (unbalanced) {
+        fail(zone_error_code::unbalanced_parentheses, begin,
+             "unbalanced parentheses");
+        unbalanced = false;
+      }
+      if (token.empty()) {
+        continue;
+      }
+      if (entry.size == entry.tokens.size()) {
+        fail(zone_error_code::too_many_tokens,
+             static_cast<std::size_t>(token.data() - text.data()),
+             "too many tokens in the resource record");
+        continue;
+      }
+      entry.tokens[entry.size++] = token;
+    }
+  }
+}
 
-  // In the next block, the following checks fail:
-  // -- readability-braces-around-statements;
-  // -- readability-misleading-indentation;
-  // -- readability-magic-numbers.
-  // The first two are triggered by `if constexpr` and `else if constexpr`,
-  // the last one -- by calls to `ui32` with numeric indices.
-  if constexpr (RecordType == record_type::soa) {  // NOLINT
-    // NOLINTNEXTLINE
-    return std::make_unique<soa_record>(ttl, d(0), d(1), ui32(2), ui32(3),
-                                        // NOLINTNEXTLINE
-                                        ui32(4), ui32(5), ui32(6));
-  } else if constexpr (RecordType == record_type::ns) {  // NOLINT
-    return std::make_unique<ns_record>(ttl, d(0));
-  } else if constexpr (RecordType == record_type::cname) {  // NOLINT
-    return std::make_unique<cname_record>(ttl, d(0));
-  } else if constexpr (RecordType == record_type::a) {  // NOLINT
-    return std::make_unique<a_record>(ttl, data_tokens[0]);
-  } else if constexpr (RecordType == record_type::aaaa) {  // NOLINT
-    return std::make_unique<aaaa_record>(ttl, data_tokens[0]);
+// @param text - the text of the zone starting with the entry.
+// @param line_count - the count of lines preceding the entry.
+zone_diagnostic locate(std::string_view text, std::uint32_t line_count,
+                       entry_error&& error) {
+  const char* where = error.where ? error.where : text.data();
+  std::string_view before(text.data(),
+                          static_cast<std::size_t>(where - text.data()));
+  auto line = line_count + 1 +
+              static_cast<std::uint32_t>(
+                  std::count(before.begin(), before.end(), '\n'));
+  auto line_start = before.rfind('\n');
+  auto column = static_cast<std::uint32_t>(
+      line_start == std::string_view::npos ? before.size() + 1
+                                           : before.size() - line_start);
+  return zone_diagnostic{line, column, error.code, std::move(error.message)};
+}
+
+// The state the entries of a zone file are parsed in.
+struct zone_state {
+  // the owner of the SOA record
+  std::optional<domain_name> zone_domain;
+  // the absolute name relative names are completed with, empty if not set
+  std::string origin;
+  // the TTL set by the `$TTL` directive
+  std::optional<std::uint32_t> default_ttl;
+  // the last explicitly stated TTL, which is the default one unless
+  // the `$TTL` directive is used
+  std::optional<std::uint32_t> last_ttl;
+  // the owner of the previous record, empty if none
+  std::string owner;
+};
+
+// @param buffer - a storage for the composed name, if needed.
+// @return the name itself if it is absolute, the name completed with
+//     the origin, or nothing for `@` if there is no origin.
+std::optional<std::string_view> absolute_name(std::string_view name,
+                                              const std::string& origin,
+                                              std::string& buffer) {
+  if (name == "@") {
+    if (origin.empty()) {
+      return std::nullopt;
+    }
+    return std::string_view(origin);
   }
-  assert(false && "unexpected record type");
-  (void)d;     // suppress `variable ‘d’ set but not used` gcc error
-  (void)ui32;  // suppress `variable ‘ui32’ set but not used` gcc error
+  if (str_ends_with(name, '.') || origin.empty()) {
+    return name;
+  }
+  buffer.assign(name).append(1, '.');
+  if (origin != ".") {
+    buffer.append(origin);
+  }
+  return std::string_view(buffer);
 }
 
-std::unique_ptr<resource_record>
-make_record(record_type rt, std::uint32_t ttl,
-            const std::vector<std::string>& data_tokens) {
-  switch (rt) {
-    case record_type::a: return make_record<record_type::a>(ttl, data_tokens);
-    case record_type::ns: return make_record<record_type::ns>(ttl, data_tokens);
-    case record_type::cname:
-      return make_record<record_type::cname>(ttl, data_tokens);
-    case record_type::soa:
-      return make_record<record_type::soa>(ttl, data_tokens);
-    case record_type::aaaa:
-      return make_record<record_type::aaaa>(ttl, data_tokens);
+enum class parse_status { skipped, record, error };
+
+// Turns the entries of a zone file into resource records. Problems are
+// returned rather than thrown, so that a zone with lots of them costs
+// no unwinding.
+class entry_parser {
+public:
+  explicit entry_parser(zone_state state = zone_state())
+      : _state(std::move(state)) {}
+
+  // @param out - gets the record, if the entry is one; it is left
+  //     in an unspecified state if the entry is invalid.
+  // @return `skipped` for a directive or a blank line; `error` if
+  //     the entry is invalid, the problem is then kept in `error()`.
+  parse_status parse(const zone_entry& entry, parsed_record& out) {
+    if (entry.size == 0) {
+      return parse_status::skipped;
+    }
+    if (!entry.owner_omitted && str_starts_with(entry.tokens[0], '$')) {
+      return parse_directive(entry) ? parse_status::skipped
+                                    : parse_status::error;
+    }
+    return parse_record(entry, out) ? parse_status::record
+                                    : parse_status::error;
   }
-  assert(false && "unexpected record type");
+
+  [[nodiscard]] const zone_state& state() const noexcept { return _state; }
+  [[nodiscard]] entry_error& error() noexcept { return _error; }
+
+private:
+  // @return false, so that `return fail(...)` reports a failure
+  bool fail(zone_error_code code, const char* where, std::string message) {
+    _error = entry_error{code, where, std::move(message)};
+    return false;
+  }
+
+  bool parse_record(const zone_entry& entry, parsed_record& out) {
+    const auto& last = entry.tokens[entry.size - 1];
+    const char* end = last.data() + last.size();
+    std::size_t i = 0;
+    if (entry.owner_omitted) {
+      if (_state.owner.empty()) {
+        return fail(zone_error_code::no_owner, nullptr,
+                    "the record has no owner name");
+      }
+    } else {
+      std::string_view owner;
+      if (!absolute(entry.tokens[i++], owner)) {
+        return false;
+      }
+      _state.owner.assign(owner);
+    }
+    if (!is_valid_domain_name(_state.owner)) {
+      return fail(zone_error_code::invalid_domain_name,
+                  entry.owner_omitted ? nullptr : entry.tokens[0].data(),
+                  quote("invalid domain name", _state.owner));
+    }
+
+    std::optional<std::uint32_t> ttl;
+    bool has_class = false;
+    std::string_view token;
+    for (;;) {
+      if (i == entry.size) {
+        return fail(zone_error_code::too_few_tokens, end,
+                    "too few tokens in the resource record");
+      }
+      token = entry.tokens[i++];
+      if (!ttl && looks_like_ttl(token)) {
+        std::uint32_t value = 0;
+        if (!to_time(token, value)) {
+          return false;
+        }
+        ttl = value;
+      } else if (!has_class && is_record_class(token)) {
+        if (!parse_record_class(token)) {
+          return fail(zone_error_code::unsupported_class, token.data(),
+                      quote("unsupported resource record class", token));
+        }
+        has_class = true;
+      } else {
+        break;
+      }
+    }
+    auto rt = parse_record_type(token);
+    if (!rt) {
+      return fail(zone_error_code::unsupported_type, token.data(),
+                  quote("unsupported resource record type", token));
+    }
+    if (!verify_soa_order(*rt, token.data())) {
+      return false;
+    }
+    if (*rt == record_type::soa && _state.origin.empty()) {
+      _state.origin = _state.owner;
+    }
+    auto record_ttl = resolve_ttl(ttl);
+    if (!record_ttl) {
+      return fail(zone_error_code::no_ttl, token.data(),
+                  "the record has no TTL and there is no `$TTL`");
+    }
+    if (!make_record(*rt, *record_ttl, entry.tokens.data() + i, entry.size - i,
+                     end, out.record)) {
+      return false;
+    }
+    out.owner = domain_name(_state.owner);
+    return true;
+  }
+
+  bool parse_directive(const zone_entry& entry) {
+    std::string_view directive = entry.tokens[0];
+    bool is_origin = str_iequals_upper(directive, "$ORIGIN");
+    if (!is_origin && !str_iequals_upper(directive, "$TTL")) {
+      return fail(zone_error_code::unsupported_directive, directive.data(),
+                  quote("unsupported directive", directive));
+    }
+    if (entry.size != 2) {
+      bool few = entry.size < 2;
+      return fail(
+          few ? zone_error_code::too_few_tokens
+              : zone_error_code::too_many_tokens,
+          few ? directive.data() + directive.size() : entry.tokens[2].data(),
+          std::string("too ") + (few ? "few" : "many") +
+              " tokens in the directive");
+    }
+    if (is_origin) {
+      if (entry.tokens[1] != "@") {
+        std::string_view origin;
+        if (!absolute(entry.tokens[1], origin)) {
+          return false;
+        }
+        if (!is_valid_domain_name(origin)) {
+          return fail(zone_error_code::invalid_domain_name,
+                      entry.tokens[1].data(),
+                      quote("invalid domain name", origin));
+        }
+        _state.origin.assign(origin);
+      }
+      return true;
+    }
+    std::uint32_t ttl = 0;
+    if (!to_time(entry.tokens[1], ttl)) {
+      return false;
+    }
+    _state.default_ttl = ttl;
+    return true;
+  }
+
+  bool absolute(std::string_view name, std::string_view& out) {
+    auto result = absolute_name(name, _state.origin, _name_buffer);
+    if (!result) {
+      return fail(zone_error_code::no_origin, name.data(),
+                  "no origin to substitute `@` with");
+    }
+    out = *result;
+    return true;
+  }
+
+  bool to_name(std::string_view token, std::optional<domain_name>& out) {
+    std::string_view name;
+    if (!absolute(token, name)) {
+      return false;
+    }
+    if (!is_valid_domain_name(name)) {
+      return fail(zone_error_code::invalid_domain_name, token.data(),
+                  quote("invalid domain name", name));
+    }
+    out.emplace(name);
+    return true;
+  }
+
+  bool to_uint32(std::string_view token, std::uint32_t& out) {
+    auto value = str_to_uint32(token);
+    if (!value) {
+      return fail(zone_error_code::invalid_integer, token.data(),
+                  quote("invalid unsigned 32 bit integer", token));
+    }
+    out = *value;
+    return true;
+  }
+
+  bool to_time(std::string_view token, std::uint32_t& out) {
+    if (std::none_of(token.begin(), token.end(), is_alpha)) {
+      return to_uint32(token, out);
+    }
+    auto value = parse_time(token);
+    if (!value) {
+      return fail(zone_error_code::invalid_time, token.data(),
+                  quote("invalid time value", token));
+    }
+    out = *value;
+    return true;
+  }
+
+  bool verify_soa_order(record_type rt, const char* where) {
+    if (_state.zone_domain) {
+      if (rt == record_type::soa) {
+        return fail(zone_error_code::misplaced_soa, where,
+                    "second SOA record in the zone");
+      }
+      return true;
+    }
+    if (rt == record_type::soa) {
+      _state.zone_domain.emplace(_state.owner);
+      return true;
+    }
+    return fail(zone_error_code::misplaced_soa, where,
+                "a zone must start with a SOA record but start with a " +
+                    std::string(to_string(rt)) + " record");
+  }
+
+  std::optional<std::uint32_t> resolve_ttl(std::optional<std::uint32_t> ttl) {
+    if (ttl) {
+      if (!_state.default_ttl) {
+        _state.last_ttl = ttl;
+      }
+      return ttl;
+    }
+    if (_state.default_ttl) {
+      return _state.default_ttl;
+    }
+    return _state.last_ttl;
+  }
+
+  // @param end - the end of the last token of the entry.
+  template <record_type RecordType>
+  bool make_record(std::uint32_t ttl, const std::string_view* data_tokens,
+                   std::size_t size, const char* end,
+                   parsed_record::record_variant& out) {
+    if (std::size_t expected = data_token_count(RecordType);
+        size != expected) {
+      bool few = size < expected;
+      return fail(few ? zone_error_code::too_few_tokens
+                      : zone_error_code::too_many_tokens,
+                  few ? end : data_tokens[expected].data(),
+                  std::string("too ") + (few ? "few" : "many") +
+                      " tokens in the resource record");
+    }
+    // `if constexpr` and `else if constexpr` trigger
+    // readability-braces-around-statements and
+    // readability-misleading-indentation checks.
+    if constexpr (RecordType == record_type::soa) {  // NOLINT
+      std::optional<domain_name> nameserver;
+      std::optional<domain_name> mailbox;
+      // serial, refresh, retry, expire and minimum
+      std::array<std::uint32_t, 5> values{};  // NOLINT
+      if (!to_name(data_tokens[0], nameserver) ||
+          !to_name(data_tokens[1], mailbox) ||
+          !to_uint32(data_tokens[2], values[0])) {
+        return false;
+      }
+      for (std::size_t i = 1; i < values.size(); ++i) {
+        if (!to_time(data_tokens[i + 2], values[i])) {
+          return false;
+        }
+      }
+      out.emplace<soa_record>(ttl, std::move(*nameserver), std::move(*mailbox),
+                              values[0], values[1], values[2], values[3],
+                              values[4]);  // NOLINT
+    } else if constexpr (RecordType == record_type::a) {  // NOLINT
+      boost::system::error_code ec;
+      auto address = boost::asio::ip::make_address_v4(data_tokens[0], ec);
+      if (ec) {
+        return fail(zone_error_code::invalid_address, data_tokens[0].data(),
+                    quote("invalid IPv4 address", data_tokens[0]));
+      }
+      out.emplace<a_record>(ttl, address.to_bytes());
+    } else if constexpr (RecordType == record_type::aaaa) {  // NOLINT
+      boost::system::error_code ec;
+      auto address = boost::asio::ip::make_address_v6(data_tokens[0], ec);
+      if (ec) {
+        return fail(zone_error_code::invalid_address, data_tokens[0].data(),
+                    quote("invalid IPv6 address", data_tokens[0]));
+      }
+      out.emplace<aaaa_record>(ttl, address.to_bytes());
+    } else {
+      using record_t = std::conditional_t<
+          RecordType == record_type::ns, ns_record,
+          std::conditional_t<RecordType == record_type::cname, cname_record,
+                             ptr_record>>;
+      std::optional<domain_name> name;
+      if (!to_name(data_tokens[0], name)) {
+        return false;
+      }
+      out.emplace<record_t>(ttl, std::move(*name));
+    }
+    return true;
+  }
+
+  bool make_record(record_type rt, std::uint32_t ttl,
+                   const std::string_view* data_tokens, std::size_t size,
+                   const char* end, parsed_record::record_variant& out) {
+    switch (rt) {
+      case record_type::a:
+        return make_record<record_type::a>(ttl, data_tokens, size, end, out);
+      case record_type::ns:
+        return make_record<record_type::ns>(ttl, data_tokens, size, end, out);
+      case record_type::cname:
+        return make_record<record_type::cname>(ttl, data_tokens, size, end,
+                                               out);
+      case record_type::soa:
+        return make_record<record_type::soa>(ttl, data_tokens, size, end,
+                                             out);
+      case record_type::ptr:
+        return make_record<record_type::ptr>(ttl, data_tokens, size, end,
+                                             out);
+      case record_type::aaaa:
+        return make_record<record_type::aaaa>(ttl, data_tokens, size, end,
+                                              out);
+    }
+    assert(false && "unexpected record type");
+    return false;
+  }
+
+  zone_state _state;
+  std::string _name_buffer;
+  entry_error _error{};
+};
+
+// Keeps the first problem and stops reading; the throwing overloads of
+// `read_zone` throw it.
+class first_error_sink final : public zone_error_sink {
+public:
+  bool report(const zone_diagnostic& diagnostic) final {
+    error = diagnostic;
+    return false;
+  }
+
+  std::optional<zone_diagnostic> error;
+};
+
+std::runtime_error to_exception(const zone_diagnostic& diagnostic) {
+  if (diagnostic.line == 0) {
+    return std::runtime_error(diagnostic.message);
+  }
+  std::ostringstream msg;
+  msg << "line " << diagnostic.line << ": " << diagnostic.message;
+  return std::runtime_error(msg.str());
 }
-}  // namespace
 
-void read_zone(std::istream& is, record_consumer& consumer) {
-  std::vector<std::string> data_tokens;
-  data_tokens.reserve(max_data_token_count());
+// The whole text of a zone in memory, e.g. a memory-mapped file.
+class memory_source {
+public:
+  explicit memory_source(std::string_view text) noexcept : _text(text) {}
 
-  boost::char_separator<char> sep{" ", "", boost::drop_empty_tokens};
-  using tokenizer = boost::tokenizer<boost::char_separator<char>>;
+  [[nodiscard]] std::string_view text() const noexcept { return _text; }
+  [[nodiscard]] bool eof() const noexcept { return true; }
+  void refill() noexcept {}
+  void consume(std::size_t count) noexcept { _text.remove_prefix(count); }
 
-  consumer.consume_zone_begin();
-  std::uint32_t line_number = 0;
-  std::optional<domain_name> zone_domain;
-  try {
-    for (std::string line; std::getline(is, line);) {
-      ++line_number;
-      line = normalize_line(std::move(line));
-      if (line.empty()) {
-        continue;
+private:
+  std::string_view _text;
+};
+
+// The text of a zone read from a stream block by block. The unconsumed
+// tail of a block, i.e. an incomplete entry, is moved to the front of
+// the buffer on refill; the buffer grows only if an entry exceeds it.
+class stream_source {
+public:
+  explicit stream_source(std::istream& is) : _is(is), _buffer(block_size) {}
+
+  [[nodiscard]] std::string_view text() const noexcept {
+    return std::string_view(_buffer.data() + _begin, _end - _begin);
+  }
+  [[nodiscard]] bool eof() const noexcept { return _eof; }
+  void refill() {
+    std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+    _end -= _begin;
+    _begin = 0;
+    if (_end == _buffer.size()) {
+      _buffer.resize(_buffer.size() * 2);
+    }
+    _is.read(_buffer.data() + _end,
+             static_cast<std::streamsize>(_buffer.size() - _end));
+    auto count = static_cast<std::size_t>(_is.gcount());
+    _end += count;
+    _eof = count == 0;
+  }
+  void consume(std::size_t count) noexcept { _begin += count; }
+
+private:
+  static constexpr std::size_t block_size = std::size_t(64) * 1024;
+
+  std::istream& _is;
+  std::vector<char> _buffer;
+  std::size_t _begin = 0;
+  std::size_t _end = 0;
+  bool _eof = false;
+};
+
+// The text of a gzipped zone, decompressed by another thread while
+// the preceding blocks are parsed. The blocks are parsed where they are
+// decompressed to, without a copy. Only an entry split between two blocks
+// is joined in a buffer of its own: the unconsumed tail of a block followed
+// by as much of the next block as the entry needs; once the entry is
+// consumed, the text goes on in the block.
+class gzip_source {
+public:
+  explicit gzip_source(std::string_view compressed) : _reader(compressed) {}
+
+  [[nodiscard]] std::string_view text() const noexcept {
+    return std::string_view(_joined ? _joint : _block).substr(_begin);
+  }
+  [[nodiscard]] bool eof() const noexcept { return _eof; }
+  void refill() {
+    if (_joined && _joint.size() - _split < _block.size()) {
+      // the entry goes on in the block
+      std::size_t taken = _joint.size() - _split;
+      _joint.append(_block, taken, std::max(taken, join_size));
+      return;
+    }
+    if (_joined) {
+      _joint.erase(0, _begin);
+    } else {
+      _joint.assign(_block, _begin);
+    }
+    _begin = 0;
+    if (!_reader.next(_block)) {
+      _block.clear();
+      _eof = true;
+    }
+    _joined = !_joint.empty();
+    _split = _joint.size();
+    if (_joined) {
+      _joint.append(_block, 0, join_size);
+    }
+  }
+  void consume(std::size_t count) noexcept {
+    _begin += count;
+    if (_joined && _begin >= _split) {
+      _joined = false;
+      _begin -= _split;
+    }
+  }
+
+private:
+  // how much of the next block is joined to a split entry at first
+  static constexpr std::size_t join_size = 4096;
+
+  gzip_reader _reader;
+  std::string _block;
+  // the tail of the previous block and the head of `_block`
+  std::string _joint;
+  // the length of the tail in `_joint`
+  std::size_t _split = 0;
+  bool _joined = false;
+  std::size_t _begin = 0;
+  bool _eof = false;
+};
+
+// Records parsed by `entry_parser`, collected in a buffer which is reused
+// for the following batches once the consumer is done with a batch.
+class record_batch {
+public:
+  static constexpr std::size_t default_capacity = 4096;
+
+  // @param consumer - gets the records whenever the batch is full;
+  //     if `nullptr`, the batch grows instead.
+  explicit record_batch(record_consumer* consumer,
+                        std::size_t capacity = default_capacity)
+      : _consumer(consumer), _records(capacity) {}
+
+  // @return the storage for the next record, which is added to the batch
+  //     by `commit`.
+  parsed_record& next() {
+    if (_size == _records.size()) {
+      if (_consumer) {
+        flush();
+      } else {
+        _records.resize(_records.size() * 2 + 1);
       }
-      if (str_starts_with(line, ' ')) {
-        throw std::runtime_error("the line starts with a space");
+    }
+    return _records[_size];
+  }
+  void commit() noexcept { ++_size; }
+
+  void flush() {
+    if (_size > 0) {
+      _consumer->consume_batch(_records.data(), _size);
+      _size = 0;
+    }
+  }
+
+  [[nodiscard]] parsed_record* data() noexcept { return _records.data(); }
+  [[nodiscard]] std::size_t size() const noexcept { return _size; }
+
+private:
+  record_consumer* _consumer;
+  std::vector<parsed_record> _records;
+  std::size_t _size = 0;
+};
+
+// Parses the entries of the source until `done()`, the end of the text
+// or until `errors` tells to stop.
+//
+// @param line_count - the count of lines consumed so far; problems refer
+//     to the lines by it.
+// @return false if stopped by `errors`
+template <typename Source, typename Done>
+bool parse_entries(Source& source, entry_parser& parser,
+                   std::uint32_t& line_count, record_batch& batch,
+                   zone_error_sink& errors, Done&& done) {
+  zone_entry entry;
+  while (!done()) {
+    lex_status status = lex_status::need_more;
+    while ((status = lex_entry(source.text(), source.eof(), entry)) ==
+           lex_status::need_more) {
+      source.refill();
+    }
+    if (status == lex_status::end) {
+      return true;
+    }
+    std::optional<entry_error> error = std::move(entry.error);
+    if (!error) {
+      switch (parser.parse(entry, batch.next())) {
+        case parse_status::record: batch.commit(); break;
+        case parse_status::error: error = std::move(parser.error()); break;
+        case parse_status::skipped: break;
       }
+    }
+    if (error &&
+        !errors.report(locate(source.text(), line_count, *std::move(error)))) {
+      return false;
+    }
+    source.consume(entry.length);
+    line_count += entry.line_count;
+  }
+  return true;
+}
+
+// @return false if stopped by `errors`
+template <typename Source>
+bool read_zone_source(Source& source, record_consumer& consumer,
+                      zone_error_sink& errors,
+                      zone_state state = zone_state()) {
+  consumer.consume_zone_begin();
+  entry_parser parser(std::move(state));
+  std::uint32_t line_count = 0;
+  record_batch batch(&consumer);
+  bool completed = parse_entries(source, parser, line_count, batch, errors,
+                                 []() { return false; });
+  // the records preceding a stop are consumed, as if one by one
+  batch.flush();
+  if (!completed) {
+    return false;
+  }
+  if (!parser.state().zone_domain &&
+      !errors.report(zone_diagnostic{0, 0, zone_error_code::no_records,
+                                     "the zone has no resource records"})) {
+    return false;
+  }
+  consumer.consume_zone_end();
+  return true;
+}
+
+// Reads a zone file, decompressing it on the fly if it is gzipped.
+//
+// @return false if stopped by `errors`
+bool read_zone_file(const std::string& path, record_consumer& consumer,
+                    zone_error_sink& errors, zone_state state = zone_state()) {
+  mapped_file file(path);
+  if (gzip_reader::is_gzip(file.content())) {
+    gzip_source source(file.content());
+    return read_zone_source(source, consumer, errors, std::move(state));
+  }
+  memory_source source(file.content());
+  return read_zone_source(source, consumer, errors, std::move(state));
+}
 
-      tokenizer tokens{line, sep};
-      tokenizer::iterator token = tokens.begin();
-      // clang-format off
-      auto next_token = [&token, end = tokens.end()]() {
-        return token != end
-          ? *token++
-          : throw std::runtime_error("too few tokens in the resource record");
-      };
-      // clang-format on
-      domain_name name(next_token());
-      auto ttl = str_to_uint32(next_token());
-      verify_record_class(next_token());
-      record_type rt = to_record_type(next_token());
-      verify_single_soa_record(name, rt, zone_domain);
+// Counts the problems passed to the sink of the user.
+class counting_error_sink final : public zone_error_sink {
+public:
+  explicit counting_error_sink(zone_error_sink& next) noexcept
+      : _next(next) {}
+
+  bool report(const zone_diagnostic& diagnostic) final {
+    ++_count;
+    return _next.report(diagnostic);
+  }
+
+  [[nodiscard]] std::size_t count() const noexcept { return _count; }
+
+private:
+  zone_error_sink& _next;
+  std::size_t _count = 0;
+};
+
+// A safe point to split a zone file at: the start of an entry which
+// doesn't depend on the entries preceding it but through `state`.
+struct chunk_start {
+  std::size_t offset;
+  std::uint32_t line_count;
+  zone_state state;
+};
 
-      data_tokens.clear();
-      for (; token != tokens.end(); ++token) {
-        data_tokens.push_back(*token);
-        verify_data_token_count(data_tokens);
+// Tokenizes a line the way the lexer does, tracking the depth of
+// parentheses. Unlike the lexer, doesn't look for errors: they are left
+// to the parser of the chunk.
+//
+// @return the count of tokens, at most `max_count` are stored.
+std::size_t split_line(std::string_view line, std::string_view* tokens,
+                       std::size_t max_count, int& depth) {
+  line = line.substr(0, line.find(';'));
+  auto on_paren = [&depth](char paren) {
+    depth = paren == '(' ? depth + 1 : std::max(depth - 1, 0);
+  };
+  std::size_t count = 0;
+  for (std::size_t pos = 0; pos < line.size();) {
+    if (is_blank(line[pos])) {
+      ++pos;
+      continue;
+    }
+    std::size_t begin = pos;
+    while (pos < line.size() && !is_blank(line[pos])) {
+      ++pos;
+    }
+    auto token = strip_parens(line.substr(begin, pos - begin), on_paren);
+    if (!token.empty() && count < max_count) {
+      tokens[count++] = token;
+    }
+  }
+  return count;
+}
+
+// Finds up to `count` starts of chunks of about the same size. A chunk
+// starts with a line at the depth of zero having an explicit owner and
+// either an explicit TTL or a TTL set by `$TTL`. The scan only looks at
+// parentheses and directives, so it is way cheaper than parsing.
+std::vector<chunk_start> find_chunk_starts(std::string_view text,
+                                           const zone_state& initial,
+                                           std::size_t count) {
+  std::vector<chunk_start> starts{{0, 0, initial}};
+  zone_state state = initial;
+  std::string name_buffer;
+  std::array<std::string_view, 3> tokens;
+  int depth = 0;
+  std::uint32_t line_count = 0;
+  for (std::size_t pos = 0; pos < text.size() && starts.size() < count;
+       ++line_count) {
+    std::size_t eol = std::min(text.find('\n', pos), text.size());
+    std::string_view line = text.substr(pos, eol - pos);
+    bool at_entry_start = depth == 0 && !line.empty();
+    if (at_entry_start && line.front() == '$') {
+      // invalid directives are reported by the parser of the chunk
+      auto n = split_line(line, tokens.data(), tokens.size(), depth);
+      if (n == 2 && str_iequals_upper(tokens[0], "$ORIGIN") &&
+          tokens[1] != "@") {
+        if (auto origin =
+                absolute_name(tokens[1], state.origin, name_buffer)) {
+          state.origin.assign(*origin);
+        }
+      } else if (n == 2 && str_iequals_upper(tokens[0], "$TTL")) {
+        if (auto ttl = parse_time(tokens[1])) {
+          state.default_ttl = ttl;
+        }
+      }
+    } else if (at_entry_start && !is_blank(line.front()) &&
+               line.front() != ';' &&
+               pos >= text.size() / count * starts.size()) {
+      auto n = split_line(line, tokens.data(), tokens.size(), depth);
+      bool explicit_ttl =
+          (n > 1 && looks_like_ttl(tokens[1])) ||
+          (n > 2 && is_record_class(tokens[1]) && looks_like_ttl(tokens[2]));
+      if (state.default_ttl || explicit_ttl) {
+        starts.push_back({pos, line_count, state});
       }
+    } else if (line.find_first_of("()") != std::string_view::npos) {
+      split_line(line, tokens.data(), 0, depth);
+    }
+    pos = eol + 1;
+  }
+  return starts;
+}
+
+// The records of a chunk of a zone parsed by a worker thread.
+struct parsed_chunk {
+  record_batch records{nullptr};
+  // the first problem, if any
+  std::optional<zone_diagnostic> error;
+};
 
-      consumer.consume(std::move(name), make_record(rt, ttl, data_tokens));
+parsed_chunk parse_chunk(std::string_view text, std::uint32_t line_count,
+                         const zone_state& state) {
+  parsed_chunk result;
+  memory_source source(text);
+  entry_parser parser(state);
+  first_error_sink errors;
+  parse_entries(source, parser, line_count, result.records, errors,
+                []() { return false; });
+  result.error = std::move(errors.error);
+  return result;
+}
+}  // namespace
+
+void read_zone(std::istream& is, record_consumer& consumer) {
+  stream_source source(is);
+  first_error_sink errors;
+  if (!read_zone_source(source, consumer, errors)) {
+    throw to_exception(*errors.error);
+  }
+}
+
+void read_zone(const std::string& path, record_consumer& consumer) {
+  first_error_sink errors;
+  if (!read_zone_file(path, consumer, errors)) {
+    throw to_exception(*errors.error);
+  }
+}
+
+void read_zone(const std::string& path, std::string_view origin,
+               record_consumer& consumer) {
+  assert(is_valid_domain_name(origin) && "origin must be a valid name");
+  first_error_sink errors;
+  zone_state state;
+  state.origin.assign(origin);
+  if (!read_zone_file(path, consumer, errors, std::move(state))) {
+    throw to_exception(*errors.error);
+  }
+}
+
+std::size_t read_zone(std::istream& is, record_consumer& consumer,
+                      zone_error_sink& errors) {
+  stream_source source(is);
+  counting_error_sink counter(errors);
+  read_zone_source(source, consumer, counter);
+  return counter.count();
+}
+
+std::size_t read_zone(const std::string& path, record_consumer& consumer,
+                      zone_error_sink& errors) {
+  counting_error_sink counter(errors);
+  read_zone_file(path, consumer, counter);
+  return counter.count();
+}
+
+void read_zone(const std::string& path, record_consumer& consumer,
+               std::size_t thread_count) {
+  assert(thread_count > 0 && "thread count must be positive");
+  mapped_file file(path);
+  if (gzip_reader::is_gzip(file.content())) {
+    // A compressed zone can't be split; it is parsed by one thread while
+    // another one decompresses it.
+    gzip_source source(file.content());
+    first_error_sink errors;
+    if (!read_zone_source(source, consumer, errors)) {
+      throw to_exception(*errors.error);
+    }
+    return;
+  }
+  memory_source source(file.content());
+
+  // The SOA record, which has to be the first one, is parsed before
+  // the split, so that every chunk knows the zone.
+  consumer.consume_zone_begin();
+  entry_parser parser;
+  std::uint32_t line_count = 0;
+  {
+    record_batch batch(&consumer, 1);
+    first_error_sink errors;
+    bool completed = parse_entries(
+        source, parser, line_count, batch, errors,
+        [&parser]() { return parser.state().zone_domain.has_value(); });
+    batch.flush();
+    if (!completed) {
+      throw to_exception(*errors.error);
     }
-  } catch (const std::runtime_error& e) {
-    std::ostringstream msg;
-    msg << "line " << line_number << ": " << e.what();
-    throw std::runtime_error(msg.str());
   }
-  if (!zone_domain) {
+  if (!parser.state().zone_domain) {
     throw std::runtime_error("the zone has no resource records");
   }
+
+  std::string_view text = source.text();
+  auto starts = find_chunk_starts(text, parser.state(), thread_count);
+  std::vector<std::future<parsed_chunk>> futures;
+  for (std::size_t i = 0; i < starts.size(); ++i) {
+    std::size_t end =
+        i + 1 < starts.size() ? starts[i + 1].offset : text.size();
+    futures.push_back(std::async(
+        std::launch::async, parse_chunk,
+        text.substr(starts[i].offset, end - starts[i].offset),
+        line_count + starts[i].line_count, std::cref(starts[i].state)));
+  }
+  // The chunks are consumed in the order of the file, each in one batch
+  // as soon as it is parsed, while the following ones are still being
+  // parsed.
+  std::optional<zone_diagnostic> error;
+  for (auto& f : futures) {
+    parsed_chunk chunk = f.get();
+    if (error) {
+      continue;
+    }
+    if (chunk.records.size() > 0) {
+      consumer.consume_batch(chunk.records.data(), chunk.records.size());
+    }
+    error = std::move(chunk.error);
+  }
+  if (error) {
+    throw to_exception(*error);
+  }
   consumer.consume_zone_end();
 }
 }  // namespace beryl
@@ -1,9 +1,124 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include <istream>
 #include <memory>
+#include <string>
+#include <string_view>
 
 namespace beryl {
 class record_consumer;
+
+// The kinds of problems `read_zone` finds in a zone.
+enum class zone_error_code : std::uint8_t {
+  unbalanced_parentheses,
+  too_few_tokens,
+  too_many_tokens,
+  unsupported_directive,
+  no_owner,
+  no_origin,
+  no_ttl,
+  invalid_domain_name,
+  invalid_integer,
+  invalid_time,
+  invalid_address,
+  unsupported_class,
+  unsupported_type,
+  misplaced_soa,
+  no_records
+};
+
+// A problem found in a zone.
+struct zone_diagnostic {
+  // the line and the column, both counted from one, of the offending
+  // token or of the place the problem is found at; zero for problems of
+  // the zone as a whole
+  std::uint32_t line;
+  std::uint32_t column;
+  zone_error_code code;
+  // the text of the exception the throwing overloads throw, but for
+  // the line number
+  std::string message;
+};
+
+class zone_error_sink {
+public:
+  virtual ~zone_error_sink() = default;
+  // @return whether to go on reading the zone
+  virtual bool report(const zone_diagnostic& diagnostic) = 0;
+};
+
+// Reads a zone in the master file format of RFC 1035 in one streaming pass:
+// -- `$ORIGIN` and `$TTL` directives; until `$ORIGIN`, the origin is
+//    the owner of the SOA record;
+// -- `@` and names relative to the origin;
+// -- omitted owners, TTLs and classes; TTL and class in either order;
+// -- entries spanning several lines within parentheses;
+// -- TTLs and SOA timers with units, e.g. `1h30m` or `1w`.
+// The stream is read in blocks, which the tokens point into. Records are
+// parsed into a reusable buffer and passed to `consume_batch` of
+// the consumer a few thousand at a time; the records preceding an error
+// are consumed before the error is thrown.
+//
+// @throw std::runtime_error if the zone is invalid; the message starts with
+//     the number of the line of the offending entry.
 void read_zone(std::istream& is, record_consumer& consumer);
+
+// Reads the zone from a memory-mapped file. Tokens are parsed in place,
+// i.e. no memory is allocated per line or per token of the zone.
+//
+// A gzipped file, told by its magic number, is decompressed on the fly:
+// another thread decompresses the file block by block while the preceding
+// blocks are parsed, so neither a temporary file nor the whole
+// decompressed zone in memory is needed. The same goes for the other
+// overloads taking a path.
+//
+// @throw std::system_error if the file can't be opened or mapped
+// @throw std::runtime_error if the zone is invalid or the compressed data
+//     is corrupt
+void read_zone(const std::string& path, record_consumer& consumer);
+
+// Reads the zone from a memory-mapped file the way a zone listed in
+// `named.conf` is read: `@` and relative names are completed with
+// `origin` until `$ORIGIN` says otherwise.
+//
+// @param origin - the fully qualified name of the zone, e.g. `movie.edu.`
+// @throw std::system_error if the file can't be opened or mapped
+void read_zone(const std::string& path, std::string_view origin,
+               record_consumer& consumer);
+
+// Reads the zone reporting its problems to `errors` rather than throwing
+// them. An entry with a problem is skipped and reading goes on with
+// the next entry, unless `errors` tells to stop. No exception is thrown
+// per problem, so validating a zone with lots of errors costs about as
+// much as reading a valid one. `consume_zone_end` of the consumer is
+// called unless reading is stopped.
+//
+// @return the count of the problems found
+std::size_t read_zone(std::istream& is, record_consumer& consumer,
+                      zone_error_sink& errors);
+
+// @throw std::system_error if the file can't be opened or mapped
+// @throw std::runtime_error if the compressed data is corrupt
+std::size_t read_zone(const std::string& path, record_consumer& consumer,
+                      zone_error_sink& errors);
+
+// Reads the zone from a memory-mapped file with several threads. Meant for
+// large zones, e.g. to cut the restart time of a server.
+//
+// The file is split into up to `thread_count` chunks which are parsed
+// concurrently. A chunk starts with an entry at the top level, i.e. not
+// within parentheses, with an explicit owner and either an explicit TTL or
+// one set by `$TTL`; a quick scan over the file finds such entries and
+// the origin and `$TTL` in effect at them. The consumer is still called
+// from the calling thread only and gets the records in the order of
+// the file, a chunk per batch; error messages refer to the same lines as
+// the ones of the single threaded overload. A gzipped file can't be split
+// and is parsed by one thread, as by the single threaded overload.
+//
+// @throw std::system_error if the file can't be opened or mapped
+void read_zone(const std::string& path, record_consumer& consumer,
+               std::size_t thread_count);
 }  // namespace beryl
@@ -0,0 +1,102 @@
+#include "beryl/record_cache.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#include "beryl/cache_shard.hpp"
+#include "beryl/resource_record.hpp"
+
+namespace beryl {
+namespace {
+// An approximate count of bytes taken by a record held by `std::shared_ptr`,
+// heap memory of domain names exceeding the small string buffer is
+// not accounted.
+std::size_t record_footprint(const resource_record& rr) noexcept {
+  static constexpr std::size_t shared_ptr_overhead =
+      sizeof(record_cache::record_ptr) + 2 * sizeof(long);
+  switch (rr.type()) {
+    case record_type::a: return shared_ptr_overhead + sizeof(a_record);
+    case record_type::ns: return shared_ptr_overhead + sizeof(ns_record);
+    case record_type::cname: return shared_ptr_overhead + sizeof(cname_record);
+    case record_type::soa: return shared_ptr_overhead + sizeof(soa_record);
+    case record_type::ptr: return shared_ptr_overhead + sizeof(ptr_record);
+    case record_type::aaaa: return shared_ptr_overhead + sizeof(aaaa_record);
+  }
+  assert(false && "unexpected record type");
+  return shared_ptr_overhead;
+}
+
+std::uint16_t to_tag(record_type type) noexcept {
+  return static_cast<std::uint16_t>(type);
+}
+}  // namespace
+
+record_cache::record_cache(std::size_t memory_limit, std::size_t shard_count,
+                           const chrono::time_point& now) {
+  assert(shard_count > 0 && "shard count must be positive");
+  _shards.reserve(shard_count);
+  for (std::size_t i = 0; i < shard_count; ++i) {
+    _shards.push_back(std::make_unique<shard>(memory_limit / shard_count, now));
+  }
+}
+
+record_cache::record_cache(std::size_t memory_limit)
+    : record_cache(memory_limit,
+                   std::max(1U, std::thread::hardware_concurrency())) {}
+
+record_cache::~record_cache() = default;
+
+record_cache::rrset_ptr record_cache::find(const domain_name& name,
+                                           record_type type,
+                                           const chrono::time_point& now) {
+  auto hash = _impl::cache_key_hash(name, to_tag(type));
+  auto& s = *_shards[_impl::cache_shard_index(hash, _shards.size())];
+  return s.find(hash, name, to_tag(type), now).value_or(nullptr);
+}
+
+void record_cache::insert(const domain_name& name, record_type type,
+                          rrset_ptr records, const chrono::time_point& now) {
+  if (!records || records->empty()) {
+    return;
+  }
+  auto ttl = std::numeric_limits<std::uint32_t>::max();
+  std::size_t charge = shard::entry_overhead + sizeof(rrset);
+  for (const auto& rr : *records) {
+    ttl = std::min(ttl, rr->ttl(now));
+    charge += record_footprint(*rr);
+  }
+  if (ttl == 0) {
+    return;
+  }
+  auto hash = _impl::cache_key_hash(name, to_tag(type));
+  auto& s = *_shards[_impl::cache_shard_index(hash, _shards.size())];
+  s.insert(hash, name, to_tag(type), std::move(records),
+           now + chrono::seconds(ttl), charge, now);
+}
+
+void record_cache::expire(const chrono::time_point& now) {
+  for (auto& s : _shards) {
+    s->expire(now);
+  }
+}
+
+std::size_t record_cache::size() const {
+  std::size_t result = 0;
+  for (const auto& s : _shards) {
+    result += s->size();
+  }
+  return result;
+}
+
+std::size_t record_cache::memory_usage() const {
+  std::size_t result = 0;
+  for (const auto& s : _shards) {
+    result += s->usage();
+  }
+  return result;
+}
+}  // namespace beryl
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "beryl/chrono.hpp"
+#include "beryl/domain_name.hpp"
+#include "beryl/record_type.hpp"
+
+namespace beryl {
+class resource_record;
+namespace _impl {
+template <typename Value>
+class cache_shard;
+}
+
+// A concurrent cache of resource record sets keyed by (domain name, type).
+//
+// The cache is split into shards, each guarded by its own mutex, so that
+// threads working on different keys rarely contend. Within a shard,
+// expired record sets are evicted by a timing wheel and the memory limit
+// is enforced with SIEVE eviction (please see `_impl::cache_shard`).
+//
+// Records are supposed to be created in the expiration mode, i.e. with
+// an expiration time point rather than a TTL, so that their TTLs decrease
+// while they sit in the cache. A record set expires together with its
+// earliest expiring record.
+class record_cache {
+public:
+  using record_ptr = std::shared_ptr<const resource_record>;
+  using rrset = std::vector<record_ptr>;
+  using rrset_ptr = std::shared_ptr<const rrset>;
+
+  // @param memory_limit - the upper bound of memory, in bytes, consumed
+  //     by the cached entries; the limit is divided evenly among shards.
+  // @param shard_count - the number of shards, must be positive;
+  //     defaults to the number of hardware threads.
+  // @param now - the time the expiration timers start from.
+  record_cache(std::size_t memory_limit, std::size_t shard_count,
+               const chrono::time_point& now = chrono::now());
+  explicit record_cache(std::size_t memory_limit);
+  ~record_cache();
+  record_cache(const record_cache&) = delete;
+  record_cache& operator=(const record_cache&) = delete;
+
+  // @return the cached record set or `nullptr` if there is no unexpired
+  //     record set for the key.
+  rrset_ptr find(const domain_name& name, record_type type,
+                 const chrono::time_point& now = chrono::now());
+
+  // Replaces the record set for the key, if any. An empty record set,
+  // a set which is already expired or a set which doesn't fit into a shard
+  // is not cached.
+  void insert(const domain_name& name, record_type type, rrset records,
+              const chrono::time_point& now = chrono::now()) {
+    insert(name, type, std::make_shared<const rrset>(std::move(records)),
+           now);
+  }
+  void insert(const domain_name& name, record_type type, rrset_ptr records,
+              const chrono::time_point& now = chrono::now());
+
+  // Looks the key up and, on a miss, obtains the record set with `fetch`,
+  // e.g. by querying an upstream server, and caches it.
+  //
+  // @param fetch - a functor taking `(const domain_name&, record_type)`
+  //     and returning `rrset`.
+  template <typename Fetch>
+  rrset_ptr find_or_fetch(const domain_name& name, record_type type,
+                          Fetch&& fetch,
+                          const chrono::time_point& now = chrono::now()) {
+    if (auto cached = find(name, type, now)) {
+      return cached;
+    }
+    auto fetched = std::make_shared<const rrset>(
+        std::forward<Fetch>(fetch)(name, type));
+    if (fetched->empty()) {
+      return nullptr;
+    }
+    insert(name, type, fetched, now);
+    return fetched;
+  }
+
+  // Evicts all the record sets expired by `now`. Meant to be called
+  // periodically, e.g. once a second.
+  void expire(const chrono::time_point& now = chrono::now());
+
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] std::size_t memory_usage() const;
+
+private:
+  using shard = _impl::cache_shard<rrset_ptr>;
+
+  std::vector<std::unique_ptr<shard>> _shards;
+};
+}  // namespace beryl
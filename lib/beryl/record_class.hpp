@@ -1,15 +1,20 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 
+#include <optional>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+
+#include "beryl/string.hpp"
 
 namespace beryl {
 enum class record_class : std::uint8_t { in = 1 };
 
-inline std::string to_string(record_class c) {
+constexpr std::string_view to_string(record_class c) noexcept {
   if (c != record_class::in) {
     assert(false && "unexpected resource record class");
   }
@@ -21,13 +26,22 @@ inline std::ostream& operator<<(std::ostream& os, record_class rc) {
   return os;
 }
 
-inline record_class to_record_class(const std::string& str) {
-  if (str != to_string(record_class::in)) {
-    // clang-format off
-    throw std::runtime_error(
-        "unsupported resource record class: `" + str + "`");
-    // clang-format on
+// Mnemonics are case insensitive (RFC 1035, section 5.1).
+//
+// @return the class or nothing if the class is unknown or unsupported
+constexpr std::optional<record_class>
+parse_record_class(std::string_view str) noexcept {
+  if (!str_iequals_upper(str, "IN")) {
+    return std::nullopt;
   }
   return record_class::in;
 }
+
+inline record_class to_record_class(std::string_view str) {
+  if (auto rc = parse_record_class(str)) {
+    return *rc;
+  }
+  throw std::runtime_error("unsupported resource record class: `" +
+                           std::string(str) + "`");
+}
 }  // namespace beryl
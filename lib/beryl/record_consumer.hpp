@@ -1,16 +1,72 @@
 #pragma once
 
-#include <memory>
+#include <cstddef>
+
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/resource_record.hpp"
 
 namespace beryl {
-class domain_name;
-class resource_record;
+// A record read from a zone, held by value. A batch of such records takes
+// one buffer, which the reader reuses for the next batch, instead of
+// an allocation per record.
+struct parsed_record {
+  using record_variant =
+      std::variant<std::monostate, a_record, aaaa_record, ns_record,
+                   cname_record, ptr_record, soa_record>;
+
+  // @pre `record` holds a record
+  [[nodiscard]] const resource_record& get() const noexcept {
+    return *std::visit(
+        [](const auto& r) -> const resource_record* {
+          if constexpr (std::is_same_v<std::decay_t<decltype(r)>,
+                                       std::monostate>) {
+            return nullptr;
+          } else {
+            return &r;
+          }
+        },
+        record);
+  }
+
+  // Moves the record to the heap.
+  //
+  // @pre `record` holds a record
+  [[nodiscard]] resource_record_ptr release() {
+    return std::visit(
+        [](auto& r) -> resource_record_ptr {
+          using record_t = std::decay_t<decltype(r)>;
+          if constexpr (std::is_same_v<record_t, std::monostate>) {
+            return nullptr;
+          } else {
+            return make_resource_record<record_t>(std::move(r));
+          }
+        },
+        record);
+  }
+
+  domain_name owner{"."};
+  record_variant record;
+};
+
 class record_consumer {
 public:
   virtual ~record_consumer() = default;
   virtual void consume_zone_begin() = 0;
   virtual void consume_zone_end() = 0;
-  virtual void
-  consume(domain_name&& name, std::unique_ptr<resource_record> rr) = 0;
+  virtual void consume(domain_name&& name, resource_record_ptr rr) = 0;
+
+  // Consumes records in the order of the zone. The consumer may reorder
+  // the records or move from them; the storage belongs to the caller and
+  // is reused once the call returns. By default, passes every record
+  // to `consume`.
+  virtual void consume_batch(parsed_record* records, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+      consume(std::move(records[i].owner), records[i].release());
+    }
+  }
 };
 }  // namespace beryl
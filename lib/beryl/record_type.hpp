@@ -1,11 +1,17 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 
+#include <array>
+#include <optional>
 #include <ostream>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
+
+#include "beryl/string.hpp"
 
 namespace beryl {
 enum class record_type : std::uint8_t {
@@ -13,18 +19,79 @@ enum class record_type : std::uint8_t {
   ns = 2,
   cname = 5,
   soa = 6,
+  ptr = 12,
   aaaa = 28
 };
 
-inline std::string to_string(record_type t) {
+namespace _impl {
+// The mnemonics of the supported record types. A new type is added here
+// and to the switch of `to_string`; the lookup table is derived from this
+// one at compile time.
+inline constexpr std::array<std::pair<record_type, std::string_view>, 6>
+    record_type_names{{{record_type::a, "A"},
+                       {record_type::ns, "NS"},
+                       {record_type::cname, "CNAME"},
+                       {record_type::soa, "SOA"},
+                       {record_type::ptr, "PTR"},
+                       {record_type::aaaa, "AAAA"}}};
+
+// A perfect hash of the mnemonics, which tells them apart by the length
+// and by the first and the last characters, whatever their case.
+// The factors are picked so that the mnemonics of the types likely to be
+// supported next, e.g. MX, TXT, SRV, CAA, DS, DNSKEY, RRSIG, NSEC, NSEC3,
+// NSEC3PARAM, HTTPS, SVCB, TLSA, NAPTR, SSHFP, HINFO, CDS, CDNSKEY and
+// DNAME, don't collide either.
+inline constexpr std::size_t record_type_table_size = 64;
+
+constexpr std::size_t record_type_hash(std::string_view str) noexcept {
+  if (str.empty()) {
+    return 0;
+  }
+  constexpr std::size_t first_factor = 9;
+  constexpr std::size_t last_factor = 24;
+  auto first = static_cast<unsigned char>(ascii_to_upper(str.front()));
+  auto last = static_cast<unsigned char>(ascii_to_upper(str.back()));
+  return (str.size() + first * first_factor + last * last_factor) %
+         record_type_table_size;
+}
+
+// Indices in `record_type_names` plus one by hash, zero for none.
+constexpr std::array<std::uint8_t, record_type_table_size>
+make_record_type_table() noexcept {
+  std::array<std::uint8_t, record_type_table_size> table{};
+  for (std::size_t i = 0; i < record_type_names.size(); ++i) {
+    table[record_type_hash(record_type_names[i].second)] =
+        static_cast<std::uint8_t>(i + 1);
+  }
+  return table;
+}
+
+inline constexpr auto record_type_table = make_record_type_table();
+
+constexpr bool record_type_hash_is_perfect() noexcept {
+  for (std::size_t i = 0; i < record_type_names.size(); ++i) {
+    if (record_type_table[record_type_hash(record_type_names[i].second)] !=
+        i + 1) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(record_type_hash_is_perfect(),
+              "record type mnemonics collide, adjust `record_type_hash`");
+}  // namespace _impl
+
+constexpr std::string_view to_string(record_type t) noexcept {
   switch (t) {
     case record_type::a: return "A";
     case record_type::ns: return "NS";
     case record_type::cname: return "CNAME";
     case record_type::soa: return "SOA";
+    case record_type::ptr: return "PTR";
     case record_type::aaaa: return "AAAA";
   }
   assert(false && "unexpected resource record type");
+  return {};
 }
 
 inline std::ostream& operator<<(std::ostream& os, record_type rt) {
@@ -32,16 +99,27 @@ inline std::ostream& operator<<(std::ostream& os, record_type rt) {
   return os;
 }
 
-inline record_type to_record_type(const std::string& str) {
-  static const std::unordered_map<std::string, record_type> m = {
-      {to_string(record_type::a), record_type::a},
-      {to_string(record_type::ns), record_type::ns},
-      {to_string(record_type::cname), record_type::cname},
-      {to_string(record_type::soa), record_type::soa},
-      {to_string(record_type::aaaa), record_type::aaaa}};
-  if (auto it = m.find(str); it != m.end()) {
-    return it->second;
+// Mnemonics are case insensitive (RFC 1035, section 5.1).
+//
+// @return the type or nothing if the type is unknown or unsupported
+constexpr std::optional<record_type>
+parse_record_type(std::string_view str) noexcept {
+  auto index = _impl::record_type_table[_impl::record_type_hash(str)];
+  if (index == 0) {
+    return std::nullopt;
+  }
+  const auto& entry = _impl::record_type_names[index - 1];
+  if (!str_iequals_upper(str, entry.second)) {
+    return std::nullopt;
+  }
+  return entry.first;
+}
+
+inline record_type to_record_type(std::string_view str) {
+  if (auto rt = parse_record_type(str)) {
+    return *rt;
   }
-  throw std::runtime_error("unsupported resource record type: `" + str + "`");
+  throw std::runtime_error("unsupported resource record type: `" +
+                           std::string(str) + "`");
 }
 }  // namespace beryl
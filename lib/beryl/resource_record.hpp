@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <ostream>
 #include <type_traits>
+#include <utility>
 
 #include <boost/asio/ip/address_v4.hpp>
 #include <boost/asio/ip/address_v6.hpp>
@@ -17,19 +21,33 @@
 #include "beryl/string.hpp"
 
 namespace beryl {
+// The base of all resource records.
+//
+// Records are meant to be stored by the hundred million, so the class has
+// no virtual functions: the record type is kept in the header and
+// the type-specific behaviour is dispatched on it by `apply`. The header
+// takes 8 bytes: the TTL or the expiration time, the type and a flag
+// telling which of the two the first word holds.
+//
+// Having no virtual destructor, a record can't be deleted via a pointer
+// to `resource_record`; use `resource_record_ptr` or `std::shared_ptr`
+// created with `std::make_shared` of a concrete record type.
 class resource_record {
 public:
-  virtual ~resource_record() = default;
-
-  [[nodiscard]] virtual record_type type() const noexcept = 0;
-  void accept(record_visitor& v) const {
-    v.visit_record_begin();
-    v.visit(ttl());
-    v.visit(record_class::in);
-    v.visit(type());
-    accept_specific(v);
-    v.visit_record_end();
-  }
+  [[nodiscard]] record_type type() const noexcept { return _type; }
+
+  // @param now - the time point against which the TTL of the record is
+  //     computed if the record stores its expiration time. Pass the same
+  //     value, e.g. one `chrono::now()` reading, for all records of
+  //     a response.
+  void accept(record_visitor& v,
+              const chrono::time_point& now = chrono::now()) const;
+
+  // Calls `f` with the record cast to its concrete type.
+  template <typename Functor>
+  decltype(auto) apply(Functor&& f);
+  template <typename Functor>
+  decltype(auto) apply(Functor&& f) const;
 
   // Ideally, these two method shouldn't exist but there is no any other
   // practical means of storing resource records of different types in one
@@ -45,37 +63,54 @@ public:
 
   [[nodiscard]] std::uint32_t
   ttl(const chrono::time_point& now = chrono::now()) const noexcept {
-    if ((_t & discriminator) != 0) {
-      chrono::time_point expiration(chrono::seconds(_t & ~discriminator));
+    if (_expiring) {
+      chrono::time_point expiration{chrono::seconds(_t)};
       return now < expiration
                  ? static_cast<std::uint32_t>((expiration - now).count())
                  : 0;
     }
-    return static_cast<std::uint32_t>(_t);
+    return _t;
   }
 
 protected:
-  explicit resource_record(std::uint32_t ttl) noexcept : _t(ttl) {}
-  explicit resource_record(const chrono::time_point& expiration) noexcept {
+  resource_record(record_type type, std::uint32_t ttl) noexcept
+      : _t(ttl), _type(type), _expiring(false) {}
+  resource_record(record_type type,
+                  const chrono::time_point& expiration) noexcept
+      : _type(type), _expiring(true) {
     auto seconds = expiration.time_since_epoch().count();
     assert(seconds >= 0 && "expiration time can't be less than epoch");
-    _t = discriminator +
-         std::min(static_cast<std::uint64_t>(seconds), discriminator - 1);
+    _t = static_cast<std::uint32_t>(
+        std::min(static_cast<std::uint64_t>(seconds),
+                 static_cast<std::uint64_t>(
+                     std::numeric_limits<std::uint32_t>::max())));
   }
-  virtual void accept_specific(record_visitor& v) const = 0;
+  resource_record(const resource_record&) = default;
+  resource_record& operator=(const resource_record&) = default;
+  ~resource_record() = default;
 
 private:
-  // If the most significant bit is set, then the remaining 63 bits
-  // represent resource record expiration time as a count of seconds
-  // from the epoch.
-  // Otherwise, the 32 least significant bits represent resource record TTL.
-  std::uint64_t _t;
-  // clang-format off
-  static constexpr std::uint64_t discriminator =
-      static_cast<std::uint64_t>(1) << 63;
-  // clang-format on
+  // If `_expiring` is set, then `_t` is the expiration time of the record
+  // as a count of seconds from the epoch, which lasts until 2106.
+  // Otherwise, `_t` is the TTL of the record.
+  std::uint32_t _t;
+  record_type _type;
+  bool _expiring;
+};
+static_assert(sizeof(resource_record) == 8);
+
+struct resource_record_deleter {
+  void operator()(resource_record* rr) const noexcept;
 };
 
+using resource_record_ptr =
+    std::unique_ptr<resource_record, resource_record_deleter>;
+
+template <typename Record, typename... Args>
+resource_record_ptr make_resource_record(Args&&... args) {
+  return resource_record_ptr(new Record(std::forward<Args>(args)...));
+}
+
 namespace _impl {
 struct a_record_traits {
   using addr_type = boost::asio::ip::address_v4;
@@ -118,18 +153,17 @@ class addr_record : public resource_record {
 public:
   template <typename T0, typename T1>
   addr_record(T0&& t, T1&& addr)
-      : resource_record(std::forward<T0>(t)),
+      : resource_record(RecordTraits::type, std::forward<T0>(t)),
         address_bytes(
             RecordTraits::make_addr(std::forward<T1>(addr)).to_bytes()) {}
-  [[nodiscard]] record_type type() const noexcept final {
-    return RecordTraits::type;
-  }
-  void accept_specific(record_visitor& v) const final { v.visit(address()); }
   typename RecordTraits::addr_type address() const noexcept {
     return typename RecordTraits::addr_type(address_bytes);
   }
 
 private:
+  friend class beryl::resource_record;
+  void accept_specific(record_visitor& v) const { v.visit(address()); }
+
   // The class stores bytes of the address rather then address itself because
   // `boost::asio::ip::address_v6` keeps scope id besides bytes,
   // thus waisting additional 8 bytes per record.
@@ -141,12 +175,14 @@ class domain_record : public resource_record {
 public:
   template <typename T0, typename T1>
   domain_record(T0&& t, T1&& domain_name)
-      : resource_record(std::forward<T0>(t)),
+      : resource_record(Type, std::forward<T0>(t)),
         name(std::forward<T1>(domain_name)) {}
-  [[nodiscard]] record_type type() const noexcept final { return Type; }
-  void accept_specific(record_visitor& v) const final { v.visit(name); }
 
   domain_name name;  // NOLINT(misc-non-private-member-variables-in-classes)
+
+private:
+  friend class beryl::resource_record;
+  void accept_specific(record_visitor& v) const { v.visit(name); }
 };
 }  // namespace _impl
 
@@ -155,6 +191,7 @@ using     a_record = _impl::addr_record<_impl::a_record_traits>;
 using  aaaa_record = _impl::addr_record<_impl::aaaa_record_traits>;
 using    ns_record = _impl::domain_record<record_type::ns>;
 using cname_record = _impl::domain_record<record_type::cname>;
+using   ptr_record = _impl::domain_record<record_type::ptr>;
 // clang-format on
 
 class soa_record : public resource_record {
@@ -163,7 +200,7 @@ public:
   soa_record(T0&& t, T1&& nameserver, T2&& mailbox, std::uint32_t serial,
              std::uint32_t refresh, std::uint32_t retry, std::uint32_t expire,
              std::uint32_t min_ttl)
-      : resource_record(std::forward<T0>(t)),
+      : resource_record(record_type::soa, std::forward<T0>(t)),
         nameserver(std::forward<T1>(nameserver)),
         mailbox(std::forward<T2>(mailbox)),
         serial(serial),
@@ -172,19 +209,6 @@ public:
         expire(expire),
         min_ttl(min_ttl) {}
 
-  [[nodiscard]] record_type type() const noexcept final {
-    return record_type::soa;
-  }
-  void accept_specific(record_visitor& v) const final {
-    v.visit(nameserver);
-    v.visit(mailbox);
-    v.visit(serial);
-    v.visit(refresh);
-    v.visit(retry);
-    v.visit(expire);
-    v.visit(min_ttl);
-  }
-
   // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
   domain_name nameserver;
   // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
@@ -199,5 +223,67 @@ public:
   std::uint32_t expire;
   // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
   std::uint32_t min_ttl;
+
+private:
+  friend class resource_record;
+  void accept_specific(record_visitor& v) const {
+    v.visit(nameserver);
+    v.visit(mailbox);
+    v.visit(serial);
+    v.visit(refresh);
+    v.visit(retry);
+    v.visit(expire);
+    v.visit(min_ttl);
+  }
 };
+
+// The sizes below assume an LP64 platform; a change to any of them
+// multiplies by the number of records in memory.
+static_assert(sizeof(a_record) == 12);
+static_assert(sizeof(aaaa_record) == 24);
+static_assert(sizeof(ns_record) == 32);
+static_assert(sizeof(cname_record) == 32);
+static_assert(sizeof(ptr_record) == 32);
+static_assert(sizeof(soa_record) == 80);
+
+template <typename Functor>
+decltype(auto) resource_record::apply(Functor&& f) {
+  switch (_type) {
+    case record_type::a: return std::forward<Functor>(f)(*cast<a_record>());
+    case record_type::ns: return std::forward<Functor>(f)(*cast<ns_record>());
+    case record_type::cname:
+      return std::forward<Functor>(f)(*cast<cname_record>());
+    case record_type::soa:
+      return std::forward<Functor>(f)(*cast<soa_record>());
+    case record_type::ptr:
+      return std::forward<Functor>(f)(*cast<ptr_record>());
+    case record_type::aaaa:
+      return std::forward<Functor>(f)(*cast<aaaa_record>());
+  }
+  assert(false && "unexpected record type");
+  return std::forward<Functor>(f)(*cast<a_record>());
+}
+
+template <typename Functor>
+decltype(auto) resource_record::apply(Functor&& f) const {
+  return const_cast<resource_record*>(this)->apply(
+      [&f](auto& rr) -> decltype(auto) {
+        return std::forward<Functor>(f)(std::as_const(rr));
+      });
+}
+
+inline void resource_record::accept(record_visitor& v,
+                                    const chrono::time_point& now) const {
+  v.visit_record_begin();
+  v.visit(ttl(now));
+  v.visit(record_class::in);
+  v.visit(type());
+  apply([&v](const auto& rr) { rr.accept_specific(v); });
+  v.visit_record_end();
+}
+
+inline void resource_record_deleter::operator()(
+    resource_record* rr) const noexcept {
+  rr->apply([](auto& r) { delete &r; });
+}
 }  // namespace beryl
@@ -0,0 +1,251 @@
+#include "beryl/reverse_index.hpp"
+
+#include <cassert>
+
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+#include "beryl/resource_record.hpp"
+
+namespace beryl {
+namespace {
+constexpr std::string_view in_addr_arpa = "in-addr.arpa.";
+constexpr std::string_view ip6_arpa = "ip6.arpa.";
+constexpr std::size_t bits_per_octet = 8;
+constexpr std::size_t bits_per_nibble = 4;
+constexpr unsigned nibble_mask = 0xf;
+
+template <typename Trie>
+reverse_index::lookup_result
+to_lookup_result(std::pair<const typename Trie::entry*,
+                           const typename Trie::entry*> found) noexcept {
+  reverse_index::lookup_result result;
+  if (found.first && !found.first->hosts.empty()) {
+    result.hosts = &found.first->hosts;
+  }
+  if (found.second) {
+    result.delegation = &*found.second->delegation;
+  }
+  return result;
+}
+
+template <typename Trie, typename Address>
+void delegate_prefix(Trie& trie, const Address& prefix,
+                     std::size_t prefix_length, const domain_name& zone) {
+  if (prefix_length > Trie::bit_count) {
+    throw std::invalid_argument("prefix length `" +
+                                std::to_string(prefix_length) +
+                                "` exceeds the address length");
+  }
+  trie.insert(prefix.to_bytes(), prefix_length).delegation = zone;
+}
+
+std::optional<unsigned> parse_octet(const label_view& l) noexcept {
+  static constexpr std::size_t max_digits = 3;
+  static constexpr unsigned base = 10;
+  static constexpr unsigned max_octet = 255;
+  bool leading_zero = l.size() > 1 && l.data()[0] == '0';
+  if (l.size() == 0 || l.size() > max_digits || leading_zero) {
+    return std::nullopt;
+  }
+  unsigned value = 0;
+  for (std::size_t i = 0; i < l.size(); ++i) {
+    char c = l.data()[i];
+    if (c < '0' || c > '9') {
+      return std::nullopt;
+    }
+    value = value * base + static_cast<unsigned>(c - '0');
+  }
+  return value <= max_octet ? std::optional<unsigned>(value) : std::nullopt;
+}
+
+std::optional<unsigned> parse_nibble(const label_view& l) noexcept {
+  static constexpr unsigned decimal_digits = 10;
+  if (l.size() != 1) {
+    return std::nullopt;
+  }
+  char c = l.data()[0];
+  if (c >= '0' && c <= '9') {
+    return static_cast<unsigned>(c - '0');
+  }
+  // domain names are stored lower-cased
+  if (c >= 'a' && c <= 'f') {
+    return static_cast<unsigned>(c - 'a') + decimal_digits;
+  }
+  return std::nullopt;
+}
+
+// Parses labels of a reverse name following the `in-addr.arpa.` or
+// `ip6.arpa.` suffix into address bytes, most significant first.
+//
+// @return the prefix length in bits or `std::nullopt` if the labels
+//     do not form an address prefix
+template <typename Bytes, typename Parse>
+std::optional<std::size_t>
+parse_reverse_labels(domain_name::const_iterator first,
+                     domain_name::const_iterator last, Bytes& bytes,
+                     std::size_t bits_per_label, Parse parse) noexcept {
+  std::size_t bit_count = 0;
+  for (; first != last; ++first) {
+    if (bit_count == bytes.size() * bits_per_octet) {
+      return std::nullopt;
+    }
+    auto value = parse(*first);
+    if (!value) {
+      return std::nullopt;
+    }
+    auto& byte = bytes[bit_count / bits_per_octet];
+    auto shift = bits_per_octet - bits_per_label - bit_count % bits_per_octet;
+    byte = static_cast<unsigned char>(byte | (*value << shift));
+    bit_count += bits_per_label;
+  }
+  return bit_count;
+}
+
+// @return the iterator to the first label of `name` following `suffix` or
+//     `std::nullopt` if `name` is not under `suffix`
+std::optional<domain_name::const_iterator>
+strip_suffix(const domain_name& name, const domain_name& suffix) noexcept {
+  auto rest = name.begin();
+  for (auto l = suffix.begin(); l != suffix.end(); ++l, ++rest) {
+    if (rest == name.end() || !(*rest == *l)) {
+      return std::nullopt;
+    }
+  }
+  return rest;
+}
+}  // namespace
+
+void reverse_index::insert(const address_v4& address, const domain_name& host) {
+  _v4.insert(address.to_bytes(), decltype(_v4)::bit_count)
+      .hosts.push_back(host);
+}
+
+void reverse_index::insert(const address_v6& address, const domain_name& host) {
+  _v6.insert(address.to_bytes(), decltype(_v6)::bit_count)
+      .hosts.push_back(host);
+}
+
+void reverse_index::delegate(const address_v4& prefix,
+                             std::size_t prefix_length,
+                             const domain_name& zone) {
+  delegate_prefix(_v4, prefix, prefix_length, zone);
+}
+
+void reverse_index::delegate(const address_v6& prefix,
+                             std::size_t prefix_length,
+                             const domain_name& zone) {
+  delegate_prefix(_v6, prefix, prefix_length, zone);
+}
+
+reverse_index::lookup_result
+reverse_index::find(const address_v4& address) const noexcept {
+  return to_lookup_result<decltype(_v4)>(
+      _v4.find(address.to_bytes(), decltype(_v4)::bit_count));
+}
+
+reverse_index::lookup_result
+reverse_index::find(const address_v6& address) const noexcept {
+  return to_lookup_result<decltype(_v6)>(
+      _v6.find(address.to_bytes(), decltype(_v6)::bit_count));
+}
+
+reverse_index::lookup_result
+reverse_index::find(const domain_name& reverse_name) const {
+  static const domain_name v4_suffix(in_addr_arpa);
+  static const domain_name v6_suffix(ip6_arpa);
+
+  if (auto rest = strip_suffix(reverse_name, v4_suffix)) {
+    decltype(_v4)::bytes_type bytes{};
+    if (auto length = parse_reverse_labels(*rest, reverse_name.end(), bytes,
+                                           bits_per_octet, parse_octet)) {
+      return to_lookup_result<decltype(_v4)>(_v4.find(bytes, *length));
+    }
+  } else if (auto rest = strip_suffix(reverse_name, v6_suffix)) {
+    decltype(_v6)::bytes_type bytes{};
+    if (auto length = parse_reverse_labels(*rest, reverse_name.end(), bytes,
+                                           bits_per_nibble, parse_nibble)) {
+      return to_lookup_result<decltype(_v6)>(_v6.find(bytes, *length));
+    }
+  }
+  return lookup_result();
+}
+
+void reverse_index::make_ptr_records(record_consumer& consumer,
+                                     std::uint32_t ttl) const {
+  auto emit = [&consumer, ttl](const auto& owner, const auto& entry) {
+    for (const auto& host : entry.hosts) {
+      consumer.consume(domain_name(owner),
+                       make_resource_record<ptr_record>(ttl, host));
+    }
+  };
+  _v4.for_each_host([&emit](const auto& bytes, const auto& entry) {
+    emit(to_reverse_name(address_v4(bytes)), entry);
+  });
+  _v6.for_each_host([&emit](const auto& bytes, const auto& entry) {
+    emit(to_reverse_name(address_v6(bytes)), entry);
+  });
+}
+
+domain_name to_reverse_name(const reverse_index::address_v4& address) {
+  auto bytes = address.to_bytes();
+  std::string name;
+  for (auto it = bytes.rbegin(); it != bytes.rend(); ++it) {
+    name.append(std::to_string(*it)).append(1, '.');
+  }
+  return domain_name(name.append(in_addr_arpa));
+}
+
+domain_name to_reverse_name(const reverse_index::address_v6& address) {
+  static constexpr std::string_view hex_digits = "0123456789abcdef";
+  auto bytes = address.to_bytes();
+  std::string name;
+  for (auto it = bytes.rbegin(); it != bytes.rend(); ++it) {
+    name.append(1, hex_digits[*it & nibble_mask])
+        .append(1, '.')
+        .append(1, hex_digits[*it >> bits_per_nibble])
+        .append(1, '.');
+  }
+  return domain_name(name.append(ip6_arpa));
+}
+
+void reverse_index_consumer::consume_zone_begin() {
+  if (_next) {
+    _next->consume_zone_begin();
+  }
+}
+
+void reverse_index_consumer::consume_zone_end() {
+  if (_next) {
+    _next->consume_zone_end();
+  }
+}
+
+void reverse_index_consumer::consume(domain_name&& name,
+                                     resource_record_ptr rr) {
+  if (rr->type() == record_type::a) {
+    _index.insert(rr->cast<a_record>()->address(), name);
+  } else if (rr->type() == record_type::aaaa) {
+    _index.insert(rr->cast<aaaa_record>()->address(), name);
+  }
+  if (_next) {
+    _next->consume(std::move(name), std::move(rr));
+  }
+}
+
+void reverse_index_consumer::consume_batch(parsed_record* records,
+                                           std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto& r = records[i];
+    if (const auto* a = std::get_if<a_record>(&r.record)) {
+      _index.insert(a->address(), r.owner);
+    } else if (const auto* aaaa = std::get_if<aaaa_record>(&r.record)) {
+      _index.insert(aaaa->address(), r.owner);
+    }
+  }
+  if (_next) {
+    _next->consume_batch(records, size);
+  }
+}
+}  // namespace beryl
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/address_v6.hpp>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/record_consumer.hpp"
+
+namespace beryl {
+namespace _impl {
+// A path compressed binary trie, i.e. a Patricia trie, over the bits of
+// fixed length addresses. A node stands for a prefix and has children only
+// where the prefixes below it branch or have entries, so an address of
+// a sparse zone is found in a few steps rather than in one per bit, and
+// the trie keeps at most two nodes per entry. Nodes live in one vector and
+// refer to each other by index, so a lookup is a walk over a contiguous
+// array rather than a chase of heap pointers.
+template <std::size_t Bits>
+class prefix_trie {
+public:
+  static constexpr std::size_t bit_count = Bits;
+  static constexpr std::size_t byte_count = Bits / 8;
+  using bytes_type = std::array<unsigned char, byte_count>;
+
+  struct entry {
+    // owners of A/AAAA records with the address
+    std::vector<domain_name> hosts;
+    // the zone the prefix is delegated to
+    std::optional<domain_name> delegation;
+  };
+
+  prefix_trie() : _nodes(1) {}
+
+  entry& insert(const bytes_type& bytes, std::size_t prefix_length);
+
+  // Finds the entry for the address or prefix and the entry for the longest
+  // delegated prefix covering it. Either pointer can be `nullptr`.
+  std::pair<const entry*, const entry*>
+  find(const bytes_type& bytes, std::size_t prefix_length) const noexcept;
+
+  // Calls `f(bytes, entry)` for every full length address having hosts.
+  template <typename Functor>
+  void for_each_host(Functor f) const {
+    for_each_host(0, f);
+  }
+
+private:
+  static constexpr std::uint32_t npos = 0;
+
+  struct node {
+    // The prefix of the node is the first `length` bits of `bytes`,
+    // the rest are of no meaning.
+    bytes_type bytes{};
+    std::uint8_t length = 0;
+    // The root is never a child, so zero means "no child".
+    std::array<std::uint32_t, 2> children{npos, npos};
+    std::uint32_t entry_index = npos;
+  };
+
+  static unsigned bit(const bytes_type& bytes, std::size_t i) noexcept {
+    static constexpr unsigned msb_shift = 7;
+    return (bytes[i / 8] >> (msb_shift - i % 8)) & 1U;
+  }
+
+  // @return the number of leading bits `lhs` and `rhs` share, at most
+  //     `limit`
+  static std::size_t common_length(const bytes_type& lhs,
+                                   const bytes_type& rhs,
+                                   std::size_t limit) noexcept {
+    std::size_t i = 0;
+    while (i < limit && lhs[i / 8] == rhs[i / 8]) {
+      i += 8;
+    }
+    while (i < limit && bit(lhs, i) == bit(rhs, i)) {
+      ++i;
+    }
+    return i < limit ? i : limit;
+  }
+
+  std::uint32_t add_node(const bytes_type& bytes, std::size_t length) {
+    _nodes.emplace_back();
+    _nodes.back().bytes = bytes;
+    _nodes.back().length = static_cast<std::uint8_t>(length);
+    return static_cast<std::uint32_t>(_nodes.size() - 1);
+  }
+
+  entry& entry_of(std::uint32_t n) {
+    if (_nodes[n].entry_index == npos) {
+      _entries.emplace_back();
+      _nodes[n].entry_index = static_cast<std::uint32_t>(_entries.size());
+    }
+    return _entries[_nodes[n].entry_index - 1];
+  }
+
+  template <typename Functor>
+  void for_each_host(std::uint32_t n, Functor& f) const {
+    const node& cur = _nodes[n];
+    if (cur.length == bit_count) {
+      if (const auto& e = cur.entry_index;
+          e != npos && !_entries[e - 1].hosts.empty()) {
+        f(cur.bytes, _entries[e - 1]);
+      }
+      return;
+    }
+    for (auto child : cur.children) {
+      if (child != npos) {
+        for_each_host(child, f);
+      }
+    }
+  }
+
+  std::vector<node> _nodes;
+  // `node::entry_index` is an index in this vector plus one
+  std::vector<entry> _entries;
+};
+
+template <std::size_t Bits>
+typename prefix_trie<Bits>::entry&
+prefix_trie<Bits>::insert(const bytes_type& bytes, std::size_t prefix_length) {
+  // `n` is a node whose prefix is a prefix of the inserted one
+  std::uint32_t n = 0;
+  while (_nodes[n].length != prefix_length) {
+    auto b = bit(bytes, _nodes[n].length);
+    std::uint32_t child = _nodes[n].children[b];
+    if (child == npos) {
+      child = add_node(bytes, prefix_length);
+      _nodes[n].children[b] = child;
+      return entry_of(child);
+    }
+    std::size_t common = common_length(
+        bytes, _nodes[child].bytes,
+        std::min<std::size_t>(prefix_length, _nodes[child].length));
+    if (common < _nodes[child].length) {
+      // the edge to the child is split where the prefixes part
+      std::uint32_t middle = add_node(bytes, common);
+      _nodes[middle].children[bit(_nodes[child].bytes, common)] = child;
+      _nodes[n].children[b] = middle;
+      child = middle;
+    }
+    n = child;
+  }
+  return entry_of(n);
+}
+
+template <std::size_t Bits>
+std::pair<const typename prefix_trie<Bits>::entry*,
+          const typename prefix_trie<Bits>::entry*>
+prefix_trie<Bits>::find(const bytes_type& bytes,
+                        std::size_t prefix_length) const noexcept {
+  // Every node whose prefix covers the address is on the way down, so is
+  // the longest delegated one.
+  const entry* delegation = nullptr;
+  std::uint32_t n = 0;
+  for (;;) {
+    const node& cur = _nodes[n];
+    const entry* e =
+        cur.entry_index == npos ? nullptr : &_entries[cur.entry_index - 1];
+    if (e && e->delegation) {
+      delegation = e;
+    }
+    if (cur.length == prefix_length) {
+      return {e, delegation};
+    }
+    n = cur.children[bit(bytes, cur.length)];
+    if (n == npos || _nodes[n].length > prefix_length ||
+        common_length(bytes, _nodes[n].bytes, _nodes[n].length) <
+            _nodes[n].length) {
+      return {nullptr, delegation};
+    }
+  }
+}
+}  // namespace _impl
+
+// An index of the A and AAAA records of loaded zones by address.
+//
+// Reverse zones mostly mirror forward zones. Instead of keeping
+// the `in-addr.arpa.` and `ip6.arpa.` trees, the index answers PTR queries
+// directly from a path compressed prefix trie over the addresses. It can also
+// generate PTR records for the indexed addresses and delegate prefixes,
+// of any length, to other zones; the longest delegated prefix wins.
+class reverse_index {
+public:
+  using address_v4 = boost::asio::ip::address_v4;
+  using address_v6 = boost::asio::ip::address_v6;
+
+  struct lookup_result {
+    // owners of A/AAAA records with the address, if any
+    const std::vector<domain_name>* hosts = nullptr;
+    // the zone the longest delegated prefix covering the address is
+    // delegated to, if any
+    const domain_name* delegation = nullptr;
+  };
+
+  void insert(const address_v4& address, const domain_name& host);
+  void insert(const address_v6& address, const domain_name& host);
+
+  // @throw std::invalid_argument if `prefix_length` exceeds address length
+  void delegate(const address_v4& prefix, std::size_t prefix_length,
+                const domain_name& zone);
+  void delegate(const address_v6& prefix, std::size_t prefix_length,
+                const domain_name& zone);
+
+  [[nodiscard]] lookup_result find(const address_v4& address) const noexcept;
+  [[nodiscard]] lookup_result find(const address_v6& address) const noexcept;
+  // @param reverse_name - a name within `in-addr.arpa.` or `ip6.arpa.`;
+  //     a name of a prefix, e.g. `249.192.in-addr.arpa.`, yields only
+  //     the delegation.
+  [[nodiscard]] lookup_result find(const domain_name& reverse_name) const;
+
+  // Feeds a PTR record with the given TTL for every indexed address to
+  // the consumer. The consumer's `consume_zone_begin` and
+  // `consume_zone_end` are not called.
+  void make_ptr_records(record_consumer& consumer, std::uint32_t ttl) const;
+
+private:
+  _impl::prefix_trie<32> _v4;
+  _impl::prefix_trie<128> _v6;
+};
+
+// @return `d.c.b.a.in-addr.arpa.` for `a.b.c.d`
+domain_name to_reverse_name(const reverse_index::address_v4& address);
+// @return the nibble name within `ip6.arpa.`
+domain_name to_reverse_name(const reverse_index::address_v6& address);
+
+// Indexes the addresses of A and AAAA records read by `read_zone` and
+// passes all the records, if required, further to `next`.
+class reverse_index_consumer final : public record_consumer {
+public:
+  explicit reverse_index_consumer(reverse_index& index,
+                                  record_consumer* next = nullptr) noexcept
+      : _index(index), _next(next) {}
+
+  void consume_zone_begin() final;
+  void consume_zone_end() final;
+  void consume(domain_name&& name, resource_record_ptr rr) final;
+  void consume_batch(parsed_record* records, std::size_t size) final;
+
+private:
+  reverse_index& _index;
+  record_consumer* _next;
+};
+}  // namespace beryl
@@ -0,0 +1,183 @@
+#include "beryl/server_thread.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+
+#include <cerrno>
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+
+namespace beryl::_impl {
+std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  if (cpus.empty()) {
+    cpus.push_back(0);
+  }
+  return cpus;
+}
+
+std::vector<numa_node> numa_nodes() {
+  static constexpr std::string_view node_prefix = "node";
+  std::vector<int> allowed = allowed_cpus();
+  std::vector<numa_node> nodes;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator
+           it("/sys/devices/system/node", ec),
+       end;
+       !ec && it != end; it.increment(ec)) {
+    std::string name = it->path().filename().string();
+    int id = 0;
+    if (name.compare(0, node_prefix.size(), node_prefix) != 0 ||
+        std::from_chars(name.data() + node_prefix.size(),
+                        name.data() + name.size(), id)
+                .ptr != name.data() + name.size()) {
+      continue;
+    }
+    std::ifstream is(it->path() / "cpulist");
+    std::string list;
+    std::getline(is, list);
+    numa_node node{id, {}};
+    for (int cpu : parse_cpu_list(list)) {
+      if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+        node.cpus.push_back(cpu);
+      }
+    }
+    if (!node.cpus.empty()) {
+      nodes.push_back(std::move(node));
+    }
+  }
+  if (nodes.empty()) {
+    nodes.push_back(numa_node{0, std::move(allowed)});
+  }
+  std::sort(nodes.begin(), nodes.end(),
+            [](const numa_node& lhs, const numa_node& rhs) {
+              return lhs.id < rhs.id;
+            });
+  return nodes;
+}
+
+std::vector<int> parse_cpu_list(std::string_view list) {
+  std::vector<int> cpus;
+  while (!list.empty() && (list.back() == '\n' || list.back() == ' ')) {
+    list.remove_suffix(1);
+  }
+  const char* pos = list.data();
+  const char* end = list.data() + list.size();
+  while (pos != end) {
+    int first = 0;
+    auto result = std::from_chars(pos, end, first);
+    if (result.ec != std::errc()) {
+      return {};
+    }
+    int last = first;
+    pos = result.ptr;
+    if (pos != end && *pos == '-') {
+      result = std::from_chars(pos + 1, end, last);
+      if (result.ec != std::errc() || last < first) {
+        return {};
+      }
+      pos = result.ptr;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+    if (pos != end && *pos++ != ',') {
+      return {};
+    }
+  }
+  return cpus;
+}
+
+std::vector<worker_placement>
+place_workers(const std::vector<numa_node>& nodes, std::size_t count) {
+  std::size_t cpu_count = 0;
+  for (const auto& node : nodes) {
+    cpu_count += node.cpus.size();
+  }
+  // The threads of a node: its CPUs, or its share of the count by
+  // the CPUs, the largest remainders of the shares rounded up.
+  std::vector<std::size_t> quotas(nodes.size());
+  if (count == 0) {
+    for (std::size_t n = 0; n < nodes.size(); ++n) {
+      quotas[n] = nodes[n].cpus.size();
+    }
+    count = cpu_count;
+  } else {
+    std::vector<std::size_t> order(nodes.size());
+    std::size_t placed = 0;
+    for (std::size_t n = 0; n < nodes.size(); ++n) {
+      quotas[n] = count * nodes[n].cpus.size() / cpu_count;
+      placed += quotas[n];
+      order[n] = n;
+    }
+    auto remainder = [&](std::size_t n) {
+      return count * nodes[n].cpus.size() % cpu_count;
+    };
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t lhs, std::size_t rhs) {
+                       return remainder(lhs) > remainder(rhs);
+                     });
+    for (std::size_t i = 0; placed < count; ++i, ++placed) {
+      ++quotas[order[i]];
+    }
+  }
+
+  // the nodes take turns while they have threads to take
+  std::vector<worker_placement> placements;
+  placements.reserve(count);
+  std::vector<std::size_t> taken(nodes.size());
+  while (placements.size() < count) {
+    for (std::size_t n = 0; n < nodes.size(); ++n) {
+      if (taken[n] < quotas[n]) {
+        const auto& cpus = nodes[n].cpus;
+        placements.push_back(
+            worker_placement{cpus[taken[n]++ % cpus.size()], n});
+      }
+    }
+  }
+  return placements;
+}
+
+void pin_to_cpu(int cpu) noexcept {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+}
+
+void pin_to_cpus(const std::vector<int>& cpus) noexcept {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+}
+
+void set_reuse_port(int fd) {
+  int on = 1;
+  if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+    throw boost::system::system_error(
+        boost::system::error_code(errno, boost::system::system_category()),
+        "can't set SO_REUSEPORT");
+  }
+}
+}  // namespace beryl::_impl
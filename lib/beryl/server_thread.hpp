@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+
+#include <string_view>
+#include <vector>
+
+// The pieces shared by the servers running a thread per core.
+namespace beryl::_impl {
+// @return the CPUs the process may run on
+std::vector<int> allowed_cpus();
+
+// A NUMA node with the CPUs of it the process may run on.
+struct numa_node {
+  int id = 0;
+  std::vector<int> cpus;
+};
+
+// @return the NUMA nodes with CPUs the process may run on, as
+//     /sys/devices/system/node describes them, or a single node of all
+//     the CPUs if it doesn't, e.g. on a kernel without NUMA support
+std::vector<numa_node> numa_nodes();
+
+// @param list - a CPU list of /sys, e.g. "0-3,8-11"
+// @return the CPUs or nothing if the list is malformed
+std::vector<int> parse_cpu_list(std::string_view list);
+
+// The CPU a server thread is pinned to and the index of its node.
+struct worker_placement {
+  int cpu;
+  std::size_t node;
+};
+
+// Spreads the threads over the nodes by their CPUs: one per CPU, or
+// a given count split in proportion to the CPUs of the nodes. The nodes
+// take turns, and a thread gets a CPU of its own until the CPUs of
+// the node run out.
+//
+// @param count - the number of the threads, zero for one per CPU
+// @pre `nodes` isn't empty, nor are their CPUs
+std::vector<worker_placement>
+place_workers(const std::vector<numa_node>& nodes, std::size_t count);
+
+// Pins the calling thread; a failure leaves the thread to the scheduler.
+void pin_to_cpu(int cpu) noexcept;
+// Lets the calling thread run on the CPUs only, e.g. on those of a node.
+void pin_to_cpus(const std::vector<int>& cpus) noexcept;
+
+// Lets several sockets bind to the same address, the kernel spreads
+// the datagrams or the connections over them by the hash of the client
+// address.
+//
+// @throw boost::system::system_error if the option can't be set
+void set_reuse_port(int fd);
+}  // namespace beryl::_impl
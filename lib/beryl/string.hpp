@@ -61,4 +61,24 @@ inline bool str_ends_with(const boost::container::string& str,
                           const boost::container::string& suffix) {
   return str_ends_with(std::string_view(str), std::string_view(suffix));
 }
+
+constexpr char ascii_to_upper(char c) noexcept {
+  return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// Compares ASCII strings ignoring case, e.g. mnemonics of a zone file.
+//
+// @param upper - a string in upper case
+constexpr bool str_iequals_upper(std::string_view str,
+                                 std::string_view upper) noexcept {
+  if (str.size() != upper.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < str.size(); ++i) {
+    if (ascii_to_upper(str[i]) != upper[i]) {
+      return false;
+    }
+  }
+  return true;
+}
 }  // namespace beryl
@@ -0,0 +1,334 @@
+#include "beryl/tcp_server.hpp"
+
+#include <cstring>
+
+#include <string_view>
+#include <utility>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "beryl/query_responder.hpp"
+#include "beryl/server_thread.hpp"
+#include "beryl/wire.hpp"
+
+namespace beryl {
+namespace {
+namespace asio = boost::asio;
+using tcp = asio::ip::tcp;
+using steady_clock = std::chrono::steady_clock;
+
+// the size of the length prefixing a message
+constexpr std::size_t length_size = 2;
+// the input buffer a connection starts with, which takes a lot of
+// ordinary queries; it grows for a larger one
+constexpr std::size_t initial_input_size = 4096;
+// the pause before accepting again after a failure, e.g. for the lack of
+// file descriptors, which a retry at once would hit again
+constexpr std::chrono::milliseconds accept_retry_delay{100};
+}  // namespace
+
+// An event loop with a listening socket and a responder of its own,
+// shared by the connections it accepts.
+class tcp_server::worker {
+public:
+  worker(const zone_table& zones, const tcp::endpoint& endpoint,
+         const tcp_server_options& options)
+      // a single threaded loop needs no locking
+      : _io(1),
+        _acceptor(_io),
+        _accept_timer(_io),
+        _responder(zones),
+        _options(options) {
+    _acceptor.open(endpoint.protocol());
+    _impl::set_reuse_port(_acceptor.native_handle());
+    _acceptor.bind(endpoint);
+    _acceptor.listen();
+  }
+
+  [[nodiscard]] std::uint16_t port() const {
+    return _acceptor.local_endpoint().port();
+  }
+
+  void run() {
+    accept();
+    _io.run();
+  }
+  void stop() { _io.stop(); }
+
+  query_responder& responder() noexcept { return _responder; }
+  // the storage of a response being built
+  std::string& response() noexcept { return _response; }
+  [[nodiscard]] const tcp_server_options& options() const noexcept {
+    return _options;
+  }
+
+  void connection_closed() {
+    --_connection_count;
+    if (_accept_paused) {
+      _accept_paused = false;
+      accept();
+    }
+  }
+
+private:
+  void accept();
+
+  asio::io_context _io;
+  tcp::acceptor _acceptor;
+  asio::steady_timer _accept_timer;
+  query_responder _responder;
+  std::string _response;
+  tcp_server_options _options;
+  std::size_t _connection_count = 0;
+  bool _accept_paused = false;
+};
+
+// A connection reads and writes at the same time: the queries which
+// arrive while the responses to the previous ones are being written are
+// answered to a second buffer, which is written when the first one is.
+// The two buffers take turns, so their storage is reused. A client which
+// doesn't read its responses stops being answered once their size reaches
+// the cap, and stops being read; its queries wait in the input buffer and
+// in the socket then, until a write completes.
+class tcp_server::connection
+    : public std::enable_shared_from_this<connection> {
+public:
+  connection(worker& w, tcp::socket socket)
+      : _worker(w),
+        _socket(std::move(socket)),
+        _idle_timer(_socket.get_executor()),
+        _input(initial_input_size) {
+    boost::system::error_code ec;
+    _socket.set_option(tcp::no_delay(true), ec);
+  }
+
+  void start() {
+    _last_read = steady_clock::now();
+    wait_idle();
+    read();
+  }
+
+private:
+  [[nodiscard]] bool output_full() const noexcept {
+    return _output.size() + _writing.size() >=
+           _worker.options().max_pending_output;
+  }
+
+  void read() {
+    if (_reading || _read_closed || _closed || output_full()) {
+      return;
+    }
+    _reading = true;
+    _socket.async_read_some(
+        asio::buffer(_input.data() + _input_size, _input.size() - _input_size),
+        [self = shared_from_this()](const boost::system::error_code& ec,
+                                    std::size_t size) {
+          self->complete_read(ec, size);
+        });
+  }
+
+  void complete_read(const boost::system::error_code& ec, std::size_t size) {
+    _reading = false;
+    if (_closed) {
+      return;
+    }
+    if (ec) {
+      // the responses written, the connection is done
+      _read_closed = true;
+      if (_writing.empty() && _output.empty()) {
+        close();
+      }
+      return;
+    }
+    _last_read = steady_clock::now();
+    _input_size += size;
+    answer();
+    write();
+    read();
+  }
+
+  // Answers the whole queries in the input until the responses waiting
+  // reach the cap, keeps the rest of the input.
+  void answer() {
+    std::size_t offset = 0;
+    while (_input_size - offset >= length_size && !output_full()) {
+      std::size_t size = wire::get_uint16(&_input[offset]);
+      if (_input_size - offset - length_size < size) {
+        break;
+      }
+      std::string_view query(&_input[offset + length_size], size);
+      if (auto& response = _worker.response();
+          _worker.responder().respond(query, response, dns::max_tcp_size)) {
+        wire::put_uint16(_output,
+                         static_cast<std::uint16_t>(response.size()));
+        _output += response;
+      }
+      offset += length_size + size;
+    }
+    _input_size -= offset;
+    std::memmove(_input.data(), _input.data() + offset, _input_size);
+
+    if (_input_size >= length_size) {
+      std::size_t size = length_size + wire::get_uint16(_input.data());
+      if (size > _input.size()) {
+        _input.resize(size);
+      }
+    } else if (_input.size() > initial_input_size) {
+      _input.resize(initial_input_size);
+      _input.shrink_to_fit();
+    }
+  }
+
+  void write() {
+    if (!_writing.empty() || _output.empty() || _closed) {
+      return;
+    }
+    _writing.swap(_output);
+    asio::async_write(_socket, asio::buffer(_writing),
+                      [self = shared_from_this()](
+                          const boost::system::error_code& ec, std::size_t) {
+                        self->complete_write(ec);
+                      });
+  }
+
+  void complete_write(const boost::system::error_code& ec) {
+    _writing.clear();
+    if (_closed) {
+      return;
+    }
+    if (ec) {
+      close();
+      return;
+    }
+    // the queries left in the input when the cap was reached
+    answer();
+    write();
+    if (_read_closed) {
+      if (_writing.empty()) {
+        close();
+      }
+      return;
+    }
+    read();
+  }
+
+  // The timer goes off at the idle timeout after a read; unless another
+  // read has come meanwhile, the connection is closed, otherwise
+  // the timer is set off the new read. A read doesn't reset the timer
+  // then, which would take a system call.
+  void wait_idle() {
+    _idle_timer.expires_at(_last_read + _worker.options().idle_timeout);
+    _idle_timer.async_wait(
+        [self = shared_from_this()](const boost::system::error_code& ec) {
+          if (ec || self->_closed) {
+            return;
+          }
+          if (steady_clock::now() - self->_last_read >=
+              self->_worker.options().idle_timeout) {
+            self->close();
+          } else {
+            self->wait_idle();
+          }
+        });
+  }
+
+  void close() {
+    if (_closed) {
+      return;
+    }
+    _closed = true;
+    boost::system::error_code ec;
+    _socket.close(ec);
+    _idle_timer.cancel();
+    _worker.connection_closed();
+  }
+
+  worker& _worker;
+  tcp::socket _socket;
+  asio::steady_timer _idle_timer;
+  steady_clock::time_point _last_read;
+  std::vector<char> _input;
+  std::size_t _input_size = 0;
+  // the responses waiting for the write in progress
+  std::string _output;
+  // the responses being written
+  std::string _writing;
+  bool _reading = false;
+  bool _read_closed = false;
+  bool _closed = false;
+};
+
+void tcp_server::worker::accept() {
+  _acceptor.async_accept(
+      [this](const boost::system::error_code& ec, tcp::socket socket) {
+        if (ec == asio::error::operation_aborted) {
+          return;
+        }
+        if (ec) {
+          _accept_timer.expires_after(accept_retry_delay);
+          _accept_timer.async_wait([this](const boost::system::error_code& e) {
+            if (!e) {
+              accept();
+            }
+          });
+          return;
+        }
+        ++_connection_count;
+        std::make_shared<connection>(*this, std::move(socket))->start();
+        if (_connection_count < _options.max_connections) {
+          accept();
+        } else {
+          _accept_paused = true;
+        }
+      });
+}
+
+tcp_server::tcp_server(const zone_table& zones,
+                       const tcp_server_options& options,
+                       const zone_replicas* replicas)
+    : _pin_threads(options.pin_threads) {
+  auto placements = _impl::place_workers(
+      replicas ? replicas->nodes() : _impl::numa_nodes(),
+      options.thread_count);
+  tcp::endpoint endpoint(asio::ip::make_address(options.address),
+                         options.port);
+  for (const auto& placement : placements) {
+    _cpus.push_back(placement.cpu);
+    _workers.push_back(std::make_unique<worker>(
+        replicas ? replicas->replica(placement.node) : zones, endpoint,
+        options));
+    // the sockets following the first one take the port picked for it
+    endpoint.port(_workers.back()->port());
+  }
+  _port = endpoint.port();
+}
+
+tcp_server::~tcp_server() { stop(); }
+
+void tcp_server::start() {
+  for (std::size_t i = 0; i < _workers.size(); ++i) {
+    _threads.emplace_back([this, i]() {
+      if (_pin_threads) {
+        _impl::pin_to_cpu(_cpus[i]);
+      }
+      _workers[i]->run();
+    });
+  }
+}
+
+void tcp_server::stop() {
+  for (auto& w : _workers) {
+    w->stop();
+  }
+  for (auto& t : _threads) {
+    t.join();
+  }
+  _threads.clear();
+}
+}  // namespace beryl
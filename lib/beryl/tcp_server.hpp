@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "beryl/zone_replicas.hpp"
+#include "beryl/zone_table.hpp"
+
+namespace beryl {
+struct tcp_server_options {
+  std::string address = "127.0.0.1";
+  std::uint16_t port = 53;
+  // zero for a thread per CPU the process may run on
+  std::size_t thread_count = 0;
+  // whether to pin every thread to a CPU of its own; the threads are
+  // spread over the NUMA nodes evenly
+  bool pin_threads = true;
+  // a connection which sends no query for so long is closed
+  std::chrono::milliseconds idle_timeout{10000};
+  // the most bytes of responses a connection may have waiting to be sent,
+  // give or take a response; beyond it, no more queries are answered or
+  // read from the connection until they are
+  std::size_t max_pending_output = std::size_t(256) * 1024;
+  // the most connections a thread keeps open; beyond it, the thread
+  // accepts no more until one of them is closed
+  std::size_t max_connections = 1024;
+};
+
+// Serves DNS queries over TCP, as RFC 7766 describes, with a thread per
+// core. Every thread runs an event loop of its own with a listening socket
+// of its own; the sockets are bound to the same address with
+// `SO_REUSEPORT`, so the kernel spreads the connections over them. With
+// the zones replicated per NUMA node, a thread reads the copy of the node
+// it is placed on.
+//
+// A thread keeps many persistent connections. A client may pipeline
+// queries: all the queries a read brings are answered at once and their
+// responses go out with one write, while the next queries are read.
+class tcp_server {
+public:
+  // Binds the sockets.
+  //
+  // @throw boost::system::system_error if a socket can't be bound
+  //
+  // @param replicas - the copies of the zones per NUMA node, which
+  //     the threads read instead of `zones`, or `nullptr`
+  tcp_server(const zone_table& zones, const tcp_server_options& options,
+             const zone_replicas* replicas = nullptr);
+  ~tcp_server();
+  tcp_server(const tcp_server&) = delete;
+  tcp_server& operator=(const tcp_server&) = delete;
+
+  // Starts the threads serving the connections.
+  void start();
+  // Stops the threads, the connections are dropped; may be called from any
+  // thread.
+  void stop();
+
+  [[nodiscard]] std::size_t thread_count() const noexcept {
+    return _workers.size();
+  }
+  // @return the port the sockets are bound to, e.g. the one picked by
+  //     the kernel for port zero
+  [[nodiscard]] std::uint16_t port() const noexcept { return _port; }
+
+private:
+  class worker;
+  class connection;
+
+  std::vector<std::unique_ptr<worker>> _workers;
+  std::vector<std::thread> _threads;
+  // the CPU of every thread
+  std::vector<int> _cpus;
+  bool _pin_threads;
+  std::uint16_t _port = 0;
+};
+}  // namespace beryl
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "beryl/chrono.hpp"
+
+namespace beryl {
+
+// Hierarchical timing wheel with one second resolution.
+//
+// Level `L` consists of `slot_count` slots each of which spans
+// `slot_count^L` seconds. An item is put into the highest level at which
+// its expiration time differs from the current time, thus scheduling is
+// O(1). Whenever the current time crosses a slot boundary at level `L`,
+// items of that slot are cascaded down to lower levels. An item expires
+// once it reaches level 0 and the current time reaches its expiration time.
+// Items expiring beyond the range of the wheel are parked at the highest
+// level and rescheduled every time their slot is cascaded.
+//
+// Cancellation is not supported: the owner of the wheel is supposed to
+// check whether an expired item is still relevant.
+template <typename T>
+class timing_wheel {
+public:
+  using value_type = T;
+
+  explicit timing_wheel(const chrono::time_point& now = chrono::now())
+      : _current(now.time_since_epoch().count()), _size(0) {}
+
+  [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+  [[nodiscard]] std::size_t size() const noexcept { return _size; }
+
+  // Items which are already expired at the moment of scheduling fire during
+  // the next call to `advance`.
+  void schedule(const chrono::time_point& expiration, value_type value) {
+    place(std::max(expiration.time_since_epoch().count(), _current + 1),
+          std::move(value));
+    ++_size;
+  }
+
+  // Moves the current time of the wheel to `now` and calls `on_expire` for
+  // every item whose expiration time is not later than `now`.
+  template <typename Functor>
+  void advance(const chrono::time_point& now, Functor on_expire) {
+    const std::int64_t target = now.time_since_epoch().count();
+    while (_current < target) {
+      if (empty()) {
+        _current = target;
+        return;
+      }
+      ++_current;
+      cascade();
+      auto& slot = _levels[0][index(_current, 0)];
+      if (slot.empty()) {
+        continue;
+      }
+      bucket expired;
+      expired.swap(slot);
+      _size -= expired.size();
+      for (auto& item : expired) {
+        on_expire(std::move(item.second));
+      }
+    }
+  }
+
+private:
+  using bucket = std::vector<std::pair<std::int64_t, value_type>>;
+
+  static constexpr std::size_t level_bits = 6;
+  static constexpr std::size_t level_count = 4;
+  static constexpr std::size_t slot_count = std::size_t(1) << level_bits;
+  static constexpr std::int64_t slot_mask =
+      static_cast<std::int64_t>(slot_count) - 1;
+
+  static std::size_t index(std::int64_t t, std::size_t level) noexcept {
+    return static_cast<std::size_t>((t >> (level_bits * level)) & slot_mask);
+  }
+
+  // @pre `due` is not earlier than the current time
+  void place(std::int64_t due, value_type&& value) {
+    std::size_t level = 0;
+    for (auto diff = static_cast<std::uint64_t>(due ^ _current);
+         diff >= slot_count && level + 1 < level_count; diff >>= level_bits) {
+      ++level;
+    }
+    _levels[level][index(due, level)].emplace_back(due, std::move(value));
+  }
+
+  void cascade() {
+    for (std::size_t level = level_count - 1; level > 0; --level) {
+      const auto span = static_cast<std::int64_t>(level_bits * level);
+      if ((_current & ((std::int64_t(1) << span) - 1)) != 0) {
+        continue;
+      }
+      auto& slot = _levels[level][index(_current, level)];
+      if (slot.empty()) {
+        continue;
+      }
+      bucket items;
+      items.swap(slot);
+      for (auto& item : items) {
+        place(item.first, std::move(item.second));
+      }
+    }
+  }
+
+  std::array<std::array<bucket, slot_count>, level_count> _levels;
+  // Count of seconds from the epoch. All the items expiring at or before
+  // that time have already fired.
+  std::int64_t _current;
+  std::size_t _size;
+};
+}  // namespace beryl
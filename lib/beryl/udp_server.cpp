@@ -0,0 +1,508 @@
+#include "beryl/udp_server.hpp"
+
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "beryl/io_ring.hpp"
+#include "beryl/query_responder.hpp"
+#include "beryl/server_thread.hpp"
+
+namespace beryl {
+namespace {
+namespace asio = boost::asio;
+using udp = asio::ip::udp;
+
+// Preallocated buffers of a batch of datagrams for `recvmmsg` and
+// `sendmmsg`. A query is received into a slot and its response is sent
+// from the slot to the address the query came from, gathered from its
+// parts, see `response_parts`.
+class datagram_batch {
+public:
+  // The largest query taken, as large as an EDNS buffer is in practice;
+  // a larger one is dropped.
+  static constexpr std::size_t max_query_size = 4096;
+
+  explicit datagram_batch(std::size_t size)
+      : _queries(size * max_query_size),
+        _responses(size),
+        _addresses(size),
+        _query_iovecs(size),
+        _response_iovecs(2 * size),
+        _received(size),
+        _to_send(size) {
+    for (std::size_t i = 0; i < size; ++i) {
+      _query_iovecs[i] = {&_queries[i * max_query_size], max_query_size};
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return _received.size(); }
+
+  // @return the count of the datagrams received, zero if none is waiting
+  std::size_t receive(int fd) noexcept {
+    for (std::size_t i = 0; i < size(); ++i) {
+      auto& hdr = _received[i].msg_hdr;
+      hdr = {};
+      hdr.msg_name = &_addresses[i];
+      hdr.msg_namelen = sizeof(_addresses[i]);
+      hdr.msg_iov = &_query_iovecs[i];
+      hdr.msg_iovlen = 1;
+    }
+    int count;
+    do {
+      count = ::recvmmsg(fd, _received.data(),
+                         static_cast<unsigned>(size()), MSG_DONTWAIT,
+                         nullptr);
+    } while (count < 0 && errno == EINTR);
+    return count < 0 ? 0 : static_cast<std::size_t>(count);
+  }
+
+  // @return the query in the slot or nothing if it was cut
+  [[nodiscard]] std::optional<std::string_view>
+  query(std::size_t i) const noexcept {
+    if (_received[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      return std::nullopt;
+    }
+    return std::string_view(&_queries[i * max_query_size],
+                            _received[i].msg_len);
+  }
+  // the storage of the response to the query in the slot
+  response_parts& response(std::size_t i) noexcept { return _responses[i]; }
+
+  // Queues the response in the slot to be sent.
+  void reply(std::size_t i) noexcept {
+    auto& response = _responses[i];
+    iovec* iov = &_response_iovecs[2 * i];
+    iov[0] = {response.head.data(), response.head.size()};
+    iov[1] = {const_cast<char*>(response.sections.data()),
+              response.sections.size()};
+    auto& hdr = _to_send[_send_count++].msg_hdr;
+    hdr = {};
+    hdr.msg_name = &_addresses[i];
+    hdr.msg_namelen = _received[i].msg_hdr.msg_namelen;
+    hdr.msg_iov = iov;
+    hdr.msg_iovlen = response.sections.empty() ? 1 : 2;
+  }
+
+  // Sends the queued responses. A response which can't be sent, e.g. as
+  // the socket buffer is full, is dropped as a lost datagram would be.
+  void flush(int fd) noexcept {
+    for (std::size_t sent = 0; sent < _send_count;) {
+      int count = ::sendmmsg(fd, &_to_send[sent],
+                             static_cast<unsigned>(_send_count - sent), 0);
+      if (count < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        // drop the response which fails
+        count = 1;
+      }
+      sent += static_cast<std::size_t>(count);
+    }
+    _send_count = 0;
+  }
+
+private:
+  std::vector<char> _queries;
+  std::vector<response_parts> _responses;
+  std::vector<sockaddr_storage> _addresses;
+  std::vector<iovec> _query_iovecs;
+  std::vector<iovec> _response_iovecs;
+  std::vector<mmsghdr> _received;
+  std::vector<mmsghdr> _to_send;
+  std::size_t _send_count = 0;
+};
+
+}  // namespace
+
+// A thread serving queries: a socket bound with `SO_REUSEPORT` and
+// a responder of its own.
+class udp_server::worker {
+public:
+  virtual ~worker() = default;
+  worker(const worker&) = delete;
+  worker& operator=(const worker&) = delete;
+
+  [[nodiscard]] std::uint16_t port() const {
+    return _socket.local_endpoint().port();
+  }
+
+  // Serves the queries until `stop` is called.
+  virtual void run() = 0;
+  // May be called from any thread.
+  virtual void stop() = 0;
+
+protected:
+  worker(const zone_table& zones, const udp::endpoint& endpoint)
+      // a single threaded loop needs no locking
+      : _io(1), _socket(_io), _responder(zones) {
+    _socket.open(endpoint.protocol());
+    _impl::set_reuse_port(_socket.native_handle());
+    _socket.bind(endpoint);
+  }
+
+  asio::io_context _io;
+  udp::socket _socket;
+  query_responder _responder;
+};
+
+// An event loop waiting for the socket to get readable.
+//
+// When the socket gets readable, the worker takes all the waiting
+// datagrams in batches: a batch is received with one `recvmmsg`, answered
+// as a whole and sent with one `sendmmsg`. The batch is as large as
+// the backlog, up to the batch size, so a single query at a low load is
+// answered at once while a heavy load is served with a couple of system
+// calls per batch rather than per datagram. The responses of a batch
+// refer to the zones of the responder until they are sent, so the zones
+// are refreshed between the batches.
+class udp_server::asio_worker final : public udp_server::worker {
+public:
+  asio_worker(const zone_table& zones, const udp::endpoint& endpoint,
+              std::size_t batch_size)
+      : worker(zones, endpoint), _batch(batch_size) {
+    _socket.non_blocking(true);
+  }
+
+  void run() final {
+    wait();
+    _io.run();
+  }
+  void stop() final { _io.stop(); }
+
+private:
+  void wait() {
+    _socket.async_wait(udp::socket::wait_read,
+                       [this](const boost::system::error_code& ec) {
+                         if (ec == asio::error::operation_aborted) {
+                           return;
+                         }
+                         serve();
+                         wait();
+                       });
+  }
+
+  void serve() {
+    // Under a flood, the loop is given back the control once in a while,
+    // e.g. to be stopped.
+    static constexpr std::size_t max_batches = 16;
+    int fd = _socket.native_handle();
+    for (std::size_t batch = 0; batch < max_batches; ++batch) {
+      if (_responder.outdated()) {
+        _responder.refresh();
+      }
+      std::size_t count = _batch.receive(fd);
+      for (std::size_t i = 0; i < count; ++i) {
+        if (auto query = _batch.query(i);
+            query && _responder.respond(*query, _batch.response(i))) {
+          _batch.reply(i);
+        }
+      }
+      _batch.flush(fd);
+      if (count < _batch.size()) {
+        return;
+      }
+    }
+  }
+
+  datagram_batch _batch;
+};
+
+// An io_uring loop.
+//
+// A single multishot `recvmsg` takes the datagrams as they arrive, each
+// into a buffer of a provided buffer ring, and posts a completion per
+// datagram. A response is sent with `sendmsg` from a slot of its own,
+// which is busy until the send completes; while all the slots are busy,
+// the datagrams wait in their buffers, and once the buffers run out, in
+// the socket. A response referring to the zones of the responder, see
+// `response_parts`, keeps them until its send completes: once a zone is
+// published, the responses are copied until those sends complete, then
+// the zones are refreshed. All the sends of the completions
+// consumed at once are submitted with the system call which waits for
+// the next completions; with SQPOLL, a kernel thread takes them, so
+// the loop enters the kernel only to wait.
+class udp_server::uring_worker final : public udp_server::worker {
+public:
+  uring_worker(const zone_table& zones, const udp::endpoint& endpoint,
+               std::size_t batch_size, bool sqpoll)
+      : worker(zones, endpoint),
+        _slots(std::min(batch_size, max_slots)),
+        // a receive, a read of the wake-up event and a cancellation
+        // besides the sends
+        _ring(static_cast<unsigned>(_slots.size() + 3), sqpoll),
+        _buffers(_ring, 0, buffer_count(_slots.size()), buffer_size),
+        _wakeup(::eventfd(0, EFD_CLOEXEC)) {
+    if (_wakeup < 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "can't create an eventfd");
+    }
+    for (std::size_t i = _slots.size(); i > 0; --i) {
+      _free.push_back(i - 1);
+    }
+    _receive_message.msg_namelen = sizeof(sockaddr_storage);
+  }
+  ~uring_worker() final { ::close(_wakeup); }
+
+  void run() final {
+    receive();
+    wait_for_wakeup();
+    // once stopped, the operations in flight are let to complete, as they
+    // refer to the buffers of the worker
+    while (!_stopping || _receiving || _free.size() < _slots.size()) {
+      _ring.submit(1);
+      _ring.consume([this](const io_uring_cqe& cqe) { complete(cqe); });
+      _buffers.publish();
+      // The receive ends when it runs out of buffers, or on an error; it
+      // is resubmitted once a buffer is given back, i.e. not all of them
+      // wait for a send slot, rather than failed again at once.
+      if (!_receiving && !_stopping && _backlog.size() < _buffers.count()) {
+        receive();
+      }
+    }
+  }
+
+  void stop() final {
+    std::uint64_t one = 1;
+    [[maybe_unused]] auto written = ::write(_wakeup, &one, sizeof(one));
+  }
+
+private:
+  static constexpr std::size_t max_slots = 16384;
+  static constexpr std::size_t buffer_size =
+      sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_storage) +
+      datagram_batch::max_query_size;
+  static constexpr std::uint64_t receive_tag = ~std::uint64_t(0);
+  static constexpr std::uint64_t wakeup_tag = receive_tag - 1;
+  static constexpr std::uint64_t cancel_tag = receive_tag - 2;
+
+  struct send_slot {
+    msghdr message{};
+    std::array<iovec, 2> iov{};
+    sockaddr_storage address{};
+    response_parts response;
+    // whether the response refers to the zones of the responder
+    bool refers_to_zones = false;
+  };
+
+  // @return the least power of two which isn't less than twice the count
+  static std::uint16_t buffer_count(std::size_t slot_count) noexcept {
+    std::size_t count = 8;
+    while (count < 2 * slot_count) {
+      count *= 2;
+    }
+    return static_cast<std::uint16_t>(count);
+  }
+
+  io_uring_sqe* next_sqe() {
+    io_uring_sqe* sqe = _ring.get_sqe();
+    while (!sqe) {
+      _ring.submit(0);
+      sqe = _ring.get_sqe();
+    }
+    return sqe;
+  }
+
+  void receive() {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = _socket.native_handle();
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&_receive_message);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = _buffers.group();
+    sqe->user_data = receive_tag;
+    _receiving = true;
+  }
+
+  void wait_for_wakeup() {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = _wakeup;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&_wakeup_count);
+    sqe->len = sizeof(_wakeup_count);
+    sqe->user_data = wakeup_tag;
+  }
+
+  void complete(const io_uring_cqe& cqe) {
+    if (cqe.user_data == receive_tag) {
+      complete_receive(cqe);
+    } else if (cqe.user_data == wakeup_tag) {
+      _stopping = true;
+      io_uring_sqe* sqe = next_sqe();
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = receive_tag;
+      sqe->user_data = cancel_tag;
+    } else if (cqe.user_data != cancel_tag) {
+      auto index = static_cast<std::size_t>(cqe.user_data);
+      if (_slots[index].refers_to_zones) {
+        _slots[index].refers_to_zones = false;
+        --_referring_count;
+      }
+      _free.push_back(index);
+      if (!_backlog.empty()) {
+        auto [id, size] = _backlog.front();
+        _backlog.pop_front();
+        answer(id, size);
+      }
+    }
+  }
+
+  void complete_receive(const io_uring_cqe& cqe) {
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+      auto id = static_cast<std::uint16_t>(cqe.flags >>
+                                           IORING_CQE_BUFFER_SHIFT);
+      auto size = static_cast<std::size_t>(cqe.res);
+      if (cqe.res < 0) {
+        _buffers.recycle(id);
+      } else if (_free.empty()) {
+        _backlog.emplace_back(id, size);
+      } else {
+        answer(id, size);
+      }
+    }
+    // the receive is resubmitted by the loop, see `run`
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      _receiving = false;
+    }
+  }
+
+  // Answers the datagram in a receive buffer, which holds the header of
+  // the message, the address, then the datagram, and gives the buffer
+  // back.
+  //
+  // @pre a send slot is free
+  void answer(std::uint16_t id, std::size_t size) {
+    const char* buffer = _buffers.buffer(id);
+    io_uring_recvmsg_out out;
+    std::memcpy(&out, buffer, sizeof(out));
+    std::size_t offset = sizeof(out) + _receive_message.msg_namelen;
+    std::size_t index = _free.back();
+    send_slot& slot = _slots[index];
+    if (_referring_count == 0 && _responder.outdated()) {
+      _responder.refresh();
+    }
+    bool answered =
+        !(out.flags & MSG_TRUNC) && offset + out.payloadlen <= size &&
+        _responder.respond(std::string_view(buffer + offset, out.payloadlen),
+                           slot.response);
+    if (!answered) {
+      _buffers.recycle(id);
+      return;
+    }
+    _free.pop_back();
+    auto& response = slot.response;
+    if (!response.sections.empty()) {
+      if (_responder.outdated()) {
+        response.head.append(response.sections.data(),
+                             response.sections.size());
+        response.sections = {};
+      } else {
+        slot.refers_to_zones = true;
+        ++_referring_count;
+      }
+    }
+    std::memcpy(&slot.address, buffer + sizeof(out),
+                std::min<std::size_t>(out.namelen, sizeof(slot.address)));
+    slot.iov[0] = {response.head.data(), response.head.size()};
+    slot.iov[1] = {const_cast<char*>(response.sections.data()),
+                   response.sections.size()};
+    slot.message = {};
+    slot.message.msg_name = &slot.address;
+    slot.message.msg_namelen = out.namelen;
+    slot.message.msg_iov = slot.iov.data();
+    slot.message.msg_iovlen = response.sections.empty() ? 1 : 2;
+    _buffers.recycle(id);
+
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = _socket.native_handle();
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&slot.message);
+    sqe->len = 1;
+    sqe->user_data = index;
+  }
+
+  std::vector<send_slot> _slots;
+  std::vector<std::size_t> _free;
+  // the count of the slots whose responses refer to the zones
+  std::size_t _referring_count = 0;
+  // the IDs and sizes of the buffers waiting for a send slot
+  std::deque<std::pair<std::uint16_t, std::size_t>> _backlog;
+  io_ring _ring;
+  buffer_ring _buffers;
+  msghdr _receive_message{};
+  int _wakeup;
+  std::uint64_t _wakeup_count = 0;
+  bool _receiving = false;
+  bool _stopping = false;
+};
+
+udp_server::udp_server(const zone_table& zones,
+                       const udp_server_options& options,
+                       const zone_replicas* replicas)
+    : _pin_threads(options.pin_threads) {
+  auto placements = _impl::place_workers(
+      replicas ? replicas->nodes() : _impl::numa_nodes(),
+      options.thread_count);
+  udp::endpoint endpoint(asio::ip::make_address(options.address),
+                         options.port);
+  std::size_t batch_size = std::max<std::size_t>(1, options.batch_size);
+  for (const auto& placement : placements) {
+    _cpus.push_back(placement.cpu);
+    const zone_table& table =
+        replicas ? replicas->replica(placement.node) : zones;
+    if (options.engine == io_engine::io_uring) {
+      _workers.push_back(std::make_unique<uring_worker>(
+          table, endpoint, batch_size, options.sqpoll));
+    } else {
+      _workers.push_back(
+          std::make_unique<asio_worker>(table, endpoint, batch_size));
+    }
+    // the sockets following the first one take the port picked for it
+    endpoint.port(_workers.back()->port());
+  }
+  _port = endpoint.port();
+}
+
+udp_server::~udp_server() { stop(); }
+
+void udp_server::start() {
+  for (std::size_t i = 0; i < _workers.size(); ++i) {
+    _threads.emplace_back([this, i]() {
+      if (_pin_threads) {
+        _impl::pin_to_cpu(_cpus[i]);
+      }
+      _workers[i]->run();
+    });
+  }
+}
+
+void udp_server::stop() {
+  for (auto& w : _workers) {
+    w->stop();
+  }
+  for (auto& t : _threads) {
+    t.join();
+  }
+  _threads.clear();
+}
+}  // namespace beryl
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "beryl/zone_replicas.hpp"
+#include "beryl/zone_table.hpp"
+
+namespace beryl {
+// The way a server thread waits for and exchanges the datagrams.
+enum class io_engine {
+  // an event loop waiting for the socket to get readable, which takes
+  // the datagrams with `recvmmsg` and answers them with `sendmmsg`
+  asio,
+  // an io_uring with a multishot receive into provided buffers
+  io_uring
+};
+
+struct udp_server_options {
+  std::string address = "127.0.0.1";
+  std::uint16_t port = 53;
+  // zero for a thread per CPU the process may run on
+  std::size_t thread_count = 0;
+  // whether to pin every thread to a CPU of its own; the threads are
+  // spread over the NUMA nodes evenly
+  bool pin_threads = true;
+  // the most datagrams received or sent with one system call; with
+  // io_uring, the most responses in flight
+  std::size_t batch_size = 64;
+  io_engine engine = io_engine::asio;
+  // with io_uring, whether a kernel thread polls the submission queue
+  bool sqpoll = false;
+};
+
+// Serves DNS queries over UDP with a thread per core. Every thread runs
+// an event loop of its own on a socket of its own; the sockets are bound
+// to the same address with `SO_REUSEPORT`, so the kernel spreads
+// the queries over them by the hash of the client address. The threads
+// share nothing but the zone table, which each of them copies, see
+// `query_responder`; with the zones replicated per NUMA node, a thread
+// reads the copy of the node it is placed on.
+class udp_server {
+public:
+  // Binds the sockets.
+  //
+  // @throw boost::system::system_error if a socket can't be bound
+  // @throw std::system_error if io_uring is asked for but can't be set up
+  //
+  // @param replicas - the copies of the zones per NUMA node, which
+  //     the threads read instead of `zones`, or `nullptr`
+  udp_server(const zone_table& zones, const udp_server_options& options,
+             const zone_replicas* replicas = nullptr);
+  ~udp_server();
+  udp_server(const udp_server&) = delete;
+  udp_server& operator=(const udp_server&) = delete;
+
+  // Starts the threads serving the queries.
+  void start();
+  // Stops the threads; may be called from any thread.
+  void stop();
+
+  [[nodiscard]] std::size_t thread_count() const noexcept {
+    return _workers.size();
+  }
+  // @return the port the sockets are bound to, e.g. the one picked by
+  //     the kernel for port zero
+  [[nodiscard]] std::uint16_t port() const noexcept { return _port; }
+
+private:
+  class worker;
+  class asio_worker;
+  class uring_worker;
+
+  std::vector<std::unique_ptr<worker>> _workers;
+  std::vector<std::thread> _threads;
+  // the CPU of every thread
+  std::vector<int> _cpus;
+  bool _pin_threads;
+  std::uint16_t _port = 0;
+};
+}  // namespace beryl
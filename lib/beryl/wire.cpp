@@ -0,0 +1,138 @@
+#include "beryl/wire.hpp"
+
+#include <array>
+#include <stdexcept>
+#include <type_traits>
+
+namespace beryl::wire {
+namespace {
+constexpr std::size_t max_name_length = 255;
+constexpr std::size_t max_label_count = max_name_length / 2;
+
+std::runtime_error malformed(record_type type) {
+  return std::runtime_error("malformed " + std::string(to_string(type)) +
+                            " record data");
+}
+}  // namespace
+
+void put_name(std::string& out, const domain_name& name) {
+  // The labels of `domain_name` go from the top level one.
+  std::array<std::string_view, max_label_count> labels{};
+  std::size_t count = 0;
+  for (const auto& label : name) {
+    labels[count++] = std::string_view(label.data(), label.size());
+  }
+  while (count > 0) {
+    const auto& label = labels[--count];
+    out.push_back(static_cast<char>(label.size()));
+    out.append(label.data(), label.size());
+  }
+  out.push_back('\0');
+}
+
+std::size_t name_length(std::string_view data) noexcept {
+  static constexpr std::size_t max_label_length = 63;
+  for (std::size_t pos = 0; pos < data.size() && pos < max_name_length;) {
+    auto length = static_cast<unsigned char>(data[pos]);
+    if (length == 0) {
+      return pos + 1;
+    }
+    if (length > max_label_length) {
+      return 0;
+    }
+    pos += length + 1;
+  }
+  return 0;
+}
+
+domain_name get_name(std::string_view data) {
+  std::size_t length = name_length(data);
+  if (length == 0) {
+    throw std::runtime_error("malformed domain name");
+  }
+  if (length == 1) {
+    return domain_name(".");
+  }
+  std::string text;
+  text.reserve(length);
+  for (std::size_t pos = 0; data[pos] != '\0';) {
+    auto label_length = static_cast<unsigned char>(data[pos]);
+    text.append(data.substr(pos + 1, label_length)).push_back('.');
+    pos += label_length + 1U;
+  }
+  return domain_name(text);
+}
+
+void put_rdata(std::string& out, const resource_record& rr) {
+  rr.apply([&out](const auto& r) {
+    using record = std::decay_t<decltype(r)>;
+    if constexpr (std::is_same_v<record, a_record> ||
+                  std::is_same_v<record, aaaa_record>) {
+      auto bytes = r.address().to_bytes();
+      out.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    } else if constexpr (std::is_same_v<record, soa_record>) {
+      put_name(out, r.nameserver);
+      put_name(out, r.mailbox);
+      put_uint32(out, r.serial);
+      put_uint32(out, r.refresh);
+      put_uint32(out, r.retry);
+      put_uint32(out, r.expire);
+      put_uint32(out, r.min_ttl);
+    } else {
+      put_name(out, r.name);
+    }
+  });
+}
+
+resource_record_ptr
+make_record(record_type type, std::uint32_t ttl, std::string_view rdata) {
+  auto whole_name = [type, rdata]() {
+    if (name_length(rdata) != rdata.size()) {
+      throw malformed(type);
+    }
+    return get_name(rdata);
+  };
+  switch (type) {
+    case record_type::a: {
+      boost::asio::ip::address_v4::bytes_type bytes{};
+      if (rdata.size() != bytes.size()) {
+        throw malformed(type);
+      }
+      rdata.copy(reinterpret_cast<char*>(bytes.data()), bytes.size());
+      return make_resource_record<a_record>(ttl, bytes);
+    }
+    case record_type::aaaa: {
+      boost::asio::ip::address_v6::bytes_type bytes{};
+      if (rdata.size() != bytes.size()) {
+        throw malformed(type);
+      }
+      rdata.copy(reinterpret_cast<char*>(bytes.data()), bytes.size());
+      return make_resource_record<aaaa_record>(ttl, bytes);
+    }
+    case record_type::ns:
+      return make_resource_record<ns_record>(ttl, whole_name());
+    case record_type::cname:
+      return make_resource_record<cname_record>(ttl, whole_name());
+    case record_type::ptr:
+      return make_resource_record<ptr_record>(ttl, whole_name());
+    case record_type::soa: {
+      // serial, refresh, retry, expire, minimum
+      std::array<std::uint32_t, 5> timers{};
+      std::size_t mname = name_length(rdata);
+      std::size_t rname = mname ? name_length(rdata.substr(mname)) : 0;
+      if (rname == 0 || mname + rname + timers.size() * sizeof(std::uint32_t) !=
+                            rdata.size()) {
+        throw malformed(type);
+      }
+      for (std::size_t i = 0; i < timers.size(); ++i) {
+        timers[i] = get_uint32(rdata.data() + mname + rname +
+                               i * sizeof(std::uint32_t));
+      }
+      return make_resource_record<soa_record>(
+          ttl, get_name(rdata), get_name(rdata.substr(mname)), timers[0],
+          timers[1], timers[2], timers[3], timers[4]);
+    }
+  }
+  throw malformed(type);
+}
+}  // namespace beryl::wire
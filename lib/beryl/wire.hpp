@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/record_type.hpp"
+#include "beryl/resource_record.hpp"
+
+// Helpers for the wire format of RFC 1035, i.e. the format of names and
+// record data in DNS messages. All integers are in network byte order.
+namespace beryl::wire {
+inline void put_uint16(std::string& out, std::uint16_t value) {
+  static constexpr unsigned byte_bits = 8;
+  out.push_back(static_cast<char>(value >> byte_bits));
+  out.push_back(static_cast<char>(value));
+}
+
+inline void put_uint32(std::string& out, std::uint32_t value) {
+  static constexpr unsigned half_bits = 16;
+  put_uint16(out, static_cast<std::uint16_t>(value >> half_bits));
+  put_uint16(out, static_cast<std::uint16_t>(value));
+}
+
+// @pre `data` points to at least 2 bytes
+inline std::uint16_t get_uint16(const char* data) noexcept {
+  static constexpr unsigned byte_bits = 8;
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+  return static_cast<std::uint16_t>(bytes[0] << byte_bits | bytes[1]);
+}
+
+// @pre `data` points to at least 4 bytes
+inline std::uint32_t get_uint32(const char* data) noexcept {
+  static constexpr unsigned half_bits = 16;
+  return static_cast<std::uint32_t>(get_uint16(data)) << half_bits |
+         get_uint16(data + 2);
+}
+
+// Appends the name in the uncompressed wire format, i.e. labels from
+// the leftmost one, each preceded by its length, and the root label.
+void put_name(std::string& out, const domain_name& name);
+
+// @return the length of the uncompressed name at the beginning of `data`,
+//     or zero if `data` doesn't start with a valid name.
+std::size_t name_length(std::string_view data) noexcept;
+
+// @param data - starts with an uncompressed name.
+// @throw std::runtime_error if it doesn't or the name is invalid
+domain_name get_name(std::string_view data);
+
+// Appends the record data, without the length, in the wire format.
+void put_rdata(std::string& out, const resource_record& rr);
+
+// @param rdata - the record data in the wire format, with uncompressed
+//     names.
+// @throw std::runtime_error if the data is malformed
+resource_record_ptr
+make_record(record_type type, std::uint32_t ttl, std::string_view rdata);
+}  // namespace beryl::wire
@@ -0,0 +1,186 @@
+#include "beryl/write_zone.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+#include "beryl/record_visitor.hpp"
+
+namespace beryl {
+namespace {
+// The longest master file line of a record, i.e. an SOA record with two
+// names of the maximum length, plus some slack. The buffer is flushed
+// when less than this is left, so formatting needs no bound checks.
+constexpr std::size_t max_line_length = 1024;
+
+[[noreturn]] void throw_system_error(const char* what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+class file_descriptor {
+public:
+  explicit file_descriptor(int fd) noexcept : _fd(fd) {}
+  ~file_descriptor() {
+    if (_fd >= 0) {
+      ::close(_fd);
+    }
+  }
+  file_descriptor(const file_descriptor&) = delete;
+  file_descriptor& operator=(const file_descriptor&) = delete;
+  [[nodiscard]] int get() const noexcept { return _fd; }
+
+  // @throw std::system_error if closing fails, e.g. a delayed write error
+  void close() {
+    int fd = _fd;
+    _fd = -1;
+    if (::close(fd) != 0) {
+      throw_system_error("can't close the zone file");
+    }
+  }
+
+private:
+  int _fd;
+};
+}  // namespace
+
+// Formats the fields of a record after its owner. Addresses and integers
+// are passed by value, so the visitor is as cheap as a switch on the type.
+class zone_writer::formatter final : public record_visitor {
+public:
+  explicit formatter(char* out) noexcept : _out(out) {}
+
+  [[nodiscard]] char* end() const noexcept { return _out; }
+
+  void put(std::string_view str) noexcept {
+    std::memcpy(_out, str.data(), str.size());
+    _out += str.size();
+  }
+  void put_name(const domain_name& name) noexcept {
+    // The labels are stored from the top level one but written from
+    // the leftmost one.
+    static constexpr std::size_t max_label_count = 128;
+    std::array<std::string_view, max_label_count> labels;
+    std::size_t count = 0;
+    for (const auto& label : name) {
+      labels[count++] = std::string_view(label.data(), label.size());
+    }
+    if (count == 0) {
+      *_out++ = '.';
+    }
+    while (count > 0) {
+      put(labels[--count]);
+      *_out++ = '.';
+    }
+  }
+
+  void visit_record_begin() final {}
+  void visit_record_end() final { *_out++ = '\n'; }
+  void visit(record_class rc) final { field(to_string(rc)); }
+  void visit(record_type rt) final { field(to_string(rt)); }
+  void visit(std::uint32_t i) final {
+    *_out++ = ' ';
+    _out = std::to_chars(_out, _out + max_uint32_length, i).ptr;
+  }
+  void visit(const domain_name& name) final {
+    *_out++ = ' ';
+    put_name(name);
+  }
+  void visit(boost::asio::ip::address_v4 addr) final {
+    put_address(AF_INET, addr.to_bytes().data());
+  }
+  void visit(const boost::asio::ip::address_v6& addr) final {
+    put_address(AF_INET6, addr.to_bytes().data());
+  }
+
+private:
+  static constexpr std::size_t max_uint32_length = 10;
+
+  void field(std::string_view str) noexcept {
+    *_out++ = ' ';
+    put(str);
+  }
+  void put_address(int family, const unsigned char* bytes) noexcept {
+    *_out++ = ' ';
+    // `INET6_ADDRSTRLEN` includes the terminating null
+    [[maybe_unused]] const char* text =
+        ::inet_ntop(family, bytes, _out, INET6_ADDRSTRLEN);
+    assert(text && "an address always fits");
+    _out += std::strlen(_out);
+  }
+
+  char* _out;
+};
+
+zone_writer::zone_writer(int fd, std::size_t buffer_size)
+    : _fd(fd), _buffer(std::max(buffer_size, 2 * max_line_length)) {}
+
+void zone_writer::write(const domain_name& owner, const resource_record& rr) {
+  if (_buffer.size() - _size < max_line_length) {
+    flush();
+  }
+  formatter f(_buffer.data() + _size);
+  f.put_name(owner);
+  rr.accept(f);
+  _size = static_cast<std::size_t>(f.end() - _buffer.data());
+  assert(_size <= _buffer.size() && "the line exceeds `max_line_length`");
+}
+
+void zone_writer::flush() {
+  const char* data = _buffer.data();
+  std::size_t left = _size;
+  while (left > 0) {
+    auto written = ::write(_fd, data, left);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_system_error("can't write the zone");
+    }
+    data += written;
+    left -= static_cast<std::size_t>(written);
+  }
+  _size = 0;
+}
+
+void write_zone(const zone& z, int fd) {
+  zone_writer writer(fd);
+  const auto& records = z.records();
+  // A zone file starts with the SOA record.
+  for (auto cur = records.find(z.origin());
+       cur != records.end() && cur.domain() == z.origin(); cur.increment()) {
+    if (cur.value()->type() == record_type::soa) {
+      writer.write(cur.domain(), *cur.value());
+    }
+  }
+  for (auto cur = records.begin(); cur != records.end(); cur.increment()) {
+    if (cur.value()->type() != record_type::soa) {
+      writer.write(cur.domain(), *cur.value());
+    }
+  }
+  writer.flush();
+}
+
+void write_zone(const zone& z, const std::string& path) {
+  static constexpr mode_t file_mode = 0644;
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  file_mode);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "can't create `" + path + "`");
+  }
+  file_descriptor file(fd);
+  write_zone(z, file.get());
+  file.close();
+}
+}  // namespace beryl
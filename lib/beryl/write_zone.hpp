@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+
+#include <string>
+#include <vector>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/resource_record.hpp"
+#include "beryl/zone_table.hpp"
+
+namespace beryl {
+// Writes records as master file text, one record per line with
+// the absolute owner name and explicit TTL and class, e.g.
+// `www.movie.edu. 3600 IN A 192.249.249.2`.
+//
+// The text is formatted straight into a large buffer which is written
+// to the file descriptor whenever it is nearly full. Nothing is allocated
+// per record: names are copied label by label, integers are formatted
+// with `std::to_chars` and addresses with `inet_ntop`.
+class zone_writer {
+public:
+  static constexpr std::size_t default_buffer_size = std::size_t(1) << 20;
+
+  // @param fd - an open file descriptor, which stays owned by the caller
+  explicit zone_writer(int fd,
+                       std::size_t buffer_size = default_buffer_size);
+
+  // @throw std::system_error if writing to the file fails
+  void write(const domain_name& owner, const resource_record& rr);
+
+  // Writes out the buffered text. Call it when done, as the destructor
+  // drops the text not written yet.
+  //
+  // @throw std::system_error if writing to the file fails
+  void flush();
+
+private:
+  class formatter;
+
+  int _fd;
+  std::vector<char> _buffer;
+  std::size_t _size = 0;
+};
+
+// Writes the SOA record of the zone and then the other records in
+// the canonical order of names.
+//
+// @throw std::system_error if writing to the file fails
+void write_zone(const zone& z, int fd);
+
+// @throw std::system_error if the file can't be created or written
+void write_zone(const zone& z, const std::string& path);
+}  // namespace beryl
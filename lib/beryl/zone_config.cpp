@@ -0,0 +1,280 @@
+#include "beryl/zone_config.hpp"
+
+#include <cctype>
+#include <cstddef>
+
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/record_class.hpp"
+#include "beryl/string.hpp"
+
+namespace beryl {
+namespace {
+std::runtime_error config_error(std::size_t line, const std::string& what) {
+  return std::runtime_error("line " + std::to_string(line) + ": " + what);
+}
+
+enum class token_kind { word, string, open_brace, close_brace, semicolon, end };
+
+struct token {
+  token_kind kind;
+  std::string text;
+  std::size_t line;
+};
+
+// Splits the configuration into words, quoted strings, braces and
+// semicolons, dropping blanks and comments.
+class lexer {
+public:
+  explicit lexer(std::istream& is)
+      : _text(std::istreambuf_iterator<char>(is),
+              std::istreambuf_iterator<char>()) {}
+
+  token next() {
+    skip_blanks_and_comments();
+    if (_pos == _text.size()) {
+      return token{token_kind::end, {}, _line};
+    }
+    char c = _text[_pos];
+    switch (c) {
+      case '{': ++_pos; return token{token_kind::open_brace, "{", _line};
+      case '}': ++_pos; return token{token_kind::close_brace, "}", _line};
+      case ';': ++_pos; return token{token_kind::semicolon, ";", _line};
+      case '"': return quoted_string();
+      default: break;
+    }
+    std::size_t begin = _pos;
+    while (_pos < _text.size() && !is_delimiter(_text[_pos]) &&
+           !is_comment_start()) {
+      ++_pos;
+    }
+    return token{token_kind::word, _text.substr(begin, _pos - begin), _line};
+  }
+
+private:
+  static bool is_space(char c) noexcept {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+  }
+  static bool is_delimiter(char c) noexcept {
+    return is_space(c) || c == '{' || c == '}' || c == ';' || c == '"';
+  }
+  bool is_comment_start() const noexcept {
+    std::string_view rest = std::string_view(_text).substr(_pos);
+    return rest.front() == '#' || str_starts_with(rest, "//") ||
+           str_starts_with(rest, "/*");
+  }
+
+  void skip_blanks_and_comments() {
+    while (_pos < _text.size()) {
+      std::string_view rest = std::string_view(_text).substr(_pos);
+      if (rest.front() == '\n') {
+        ++_line;
+        ++_pos;
+      } else if (is_space(rest.front())) {
+        ++_pos;
+      } else if (rest.front() == '#' || str_starts_with(rest, "//")) {
+        auto eol = rest.find('\n');
+        _pos = eol == std::string_view::npos ? _text.size() : _pos + eol;
+      } else if (str_starts_with(rest, "/*")) {
+        auto end = rest.find("*/", 2);
+        if (end == std::string_view::npos) {
+          throw config_error(_line, "unterminated comment");
+        }
+        for (std::size_t i = 0; i < end; ++i) {
+          _line += rest[i] == '\n';
+        }
+        _pos += end + 2;
+      } else {
+        return;
+      }
+    }
+  }
+
+  token quoted_string() {
+    std::size_t line = _line;
+    auto end = _text.find('"', _pos + 1);
+    if (end == std::string::npos) {
+      throw config_error(line, "unterminated string");
+    }
+    std::string text = _text.substr(_pos + 1, end - _pos - 1);
+    for (char c : text) {
+      _line += c == '\n';
+    }
+    _pos = end + 1;
+    return token{token_kind::string, std::move(text), line};
+  }
+
+  std::string _text;
+  std::size_t _pos = 0;
+  std::size_t _line = 1;
+};
+
+// A statement is a sequence of words and strings, optionally followed by
+// a block of statements, and terminated by a semicolon.
+struct statement {
+  std::vector<token> args;
+  std::optional<std::vector<statement>> block;
+};
+
+std::vector<statement> parse_block(lexer& lex, bool nested) {
+  std::vector<statement> result;
+  for (;;) {
+    token t = lex.next();
+    if (t.kind == token_kind::end) {
+      if (nested) {
+        throw config_error(t.line, "unexpected end, `}` expected");
+      }
+      return result;
+    }
+    if (t.kind == token_kind::close_brace) {
+      if (!nested) {
+        throw config_error(t.line, "unexpected `}`");
+      }
+      return result;
+    }
+    if (t.kind == token_kind::semicolon) {
+      continue;
+    }
+    if (t.kind == token_kind::open_brace) {
+      throw config_error(t.line, "unexpected `{`");
+    }
+
+    statement s;
+    s.args.push_back(std::move(t));
+    for (bool done = false; !done;) {
+      t = lex.next();
+      switch (t.kind) {
+        case token_kind::word:
+        case token_kind::string: s.args.push_back(std::move(t)); break;
+        case token_kind::open_brace:
+          s.block = parse_block(lex, true);
+          if (t = lex.next(); t.kind != token_kind::semicolon) {
+            throw config_error(t.line, "`;` expected after `}`");
+          }
+          done = true;
+          break;
+        case token_kind::semicolon: done = true; break;
+        case token_kind::close_brace:
+        case token_kind::end: throw config_error(t.line, "`;` expected");
+      }
+    }
+    result.push_back(std::move(s));
+  }
+}
+
+// @return the argument of a statement of the form `<keyword> <argument>;`
+//     or nothing if the keyword is different
+std::optional<std::string> option_value(const statement& s,
+                                        std::string_view keyword) {
+  if (s.args.front().text != keyword) {
+    return std::nullopt;
+  }
+  if (s.args.size() != 2 || s.block) {
+    throw config_error(s.args.front().line,
+                       "`" + std::string(keyword) + "` takes one argument");
+  }
+  return s.args[1].text;
+}
+
+std::string join_path(const std::string& directory, const std::string& path) {
+  if (directory.empty() || str_starts_with(path, '/')) {
+    return path;
+  }
+  return str_ends_with(directory, '/') ? directory + path
+                                       : directory + '/' + path;
+}
+
+std::optional<zone_config_entry> read_zone_statement(const statement& s) {
+  std::size_t line = s.args.front().line;
+  if (s.args.size() < 2 || s.args.size() > 3 || !s.block) {
+    throw config_error(line, "`zone \"<name>\" [<class>] { ... };` expected");
+  }
+  // zones of other classes, e.g. `CH`, are not served
+  if (s.args.size() == 3 && !parse_record_class(s.args[2].text)) {
+    return std::nullopt;
+  }
+  zone_config_entry entry;
+  entry.name = s.args[1].text;
+  if (!str_ends_with(entry.name, '.')) {
+    entry.name.append(1, '.');
+  }
+  if (!is_valid_domain_name(entry.name)) {
+    throw config_error(line, "invalid zone name `" + s.args[1].text + "`");
+  }
+  std::optional<std::string> type;
+  for (const auto& option : *s.block) {
+    if (auto value = option_value(option, "type")) {
+      type = std::move(value);
+    } else if (auto value = option_value(option, "file")) {
+      entry.file = std::move(*value);
+    }
+  }
+  if (!type) {
+    throw config_error(line, "zone `" + entry.name + "` has no type");
+  }
+  if (*type != "master" && *type != "primary") {
+    return std::nullopt;
+  }
+  if (entry.file.empty()) {
+    throw config_error(line, "zone `" + entry.name + "` has no file");
+  }
+  return entry;
+}
+}  // namespace
+
+zone_config read_zone_config(std::istream& is,
+                             const std::string& base_directory) {
+  lexer lex(is);
+  std::vector<statement> statements = parse_block(lex, false);
+
+  std::string directory = base_directory;
+  for (const auto& s : statements) {
+    if (s.args.front().text != "options" || !s.block) {
+      continue;
+    }
+    for (const auto& option : *s.block) {
+      if (auto value = option_value(option, "directory")) {
+        directory = join_path(base_directory, *value);
+      }
+    }
+  }
+
+  zone_config config;
+  std::unordered_set<domain_name, domain_name_hash> names;
+  for (const auto& s : statements) {
+    if (s.args.front().text != "zone") {
+      continue;
+    }
+    auto entry = read_zone_statement(s);
+    if (!entry) {
+      continue;
+    }
+    if (!names.insert(domain_name(entry->name)).second) {
+      throw config_error(s.args.front().line,
+                         "duplicate zone `" + entry->name + "`");
+    }
+    entry->file = join_path(directory, entry->file);
+    config.zones.push_back(std::move(*entry));
+  }
+  return config;
+}
+
+zone_config read_zone_config(const std::string& path) {
+  std::ifstream is(path);
+  if (!is) {
+    throw std::runtime_error("can't open `" + path + "`");
+  }
+  auto slash = path.rfind('/');
+  std::string base_directory = slash == std::string::npos ? std::string()
+                               : slash == 0 ? std::string("/")
+                                            : path.substr(0, slash);
+  return read_zone_config(is, base_directory);
+}
+}  // namespace beryl
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace beryl {
+// A zone to serve as listed in the configuration.
+struct zone_config_entry {
+  // the fully qualified name of the zone, e.g. `movie.edu.`
+  std::string name;
+  // the path of the zone file, relative to the working directory unless
+  // absolute
+  std::string file;
+};
+
+struct zone_config {
+  std::vector<zone_config_entry> zones;
+};
+
+// Reads the zones of a configuration in the format of BIND's `named.conf`.
+// Only a subset of the format matters to beryl:
+// -- `directory` of the `options` statement, which relative zone file
+//    paths are resolved against;
+// -- `zone` statements of the `IN` class, if any, with their `type` and
+//    `file`. Only `master` (or `primary`) zones are taken, the other types,
+//    e.g. `hint` or `slave`, are skipped.
+// Any other statement is skipped as a whole. Comments are `//`, `#` and
+// `/* */`.
+//
+// @param base_directory - the directory relative zone file paths are
+//     resolved against when `directory` is not set, e.g. the one of
+//     the configuration file; empty for the working directory.
+// @throw std::runtime_error if the configuration is invalid; the message
+//     starts with the number of the offending line.
+zone_config read_zone_config(std::istream& is,
+                             const std::string& base_directory = "");
+
+// @throw std::runtime_error if the file can't be read or is invalid
+zone_config read_zone_config(const std::string& path);
+}  // namespace beryl
@@ -0,0 +1,399 @@
+#include "beryl/zone_image.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/crc.hpp>
+
+#include "beryl/chrono.hpp"
+#include "beryl/resource_record.hpp"
+#include "beryl/wire.hpp"
+
+namespace beryl {
+namespace {
+constexpr std::size_t offset_size = sizeof(std::uint32_t);
+constexpr std::size_t node_counts_size = 2 * sizeof(std::uint32_t);
+constexpr std::size_t rrset_header_size = 2 * sizeof(std::uint16_t);
+constexpr std::size_t record_header_size =
+    sizeof(std::uint32_t) + sizeof(std::uint16_t);
+constexpr std::size_t max_label_length = 63;
+constexpr std::size_t max_name_length = 255;
+
+std::uint32_t crc32(std::string_view data) {
+  boost::crc_32_type crc;
+  crc.process_bytes(data.data(), data.size());
+  return crc.checksum();
+}
+
+std::runtime_error invalid_image(const std::string& path, const char* what) {
+  return std::runtime_error("invalid zone image `" + path + "`: " + what);
+}
+
+// A view of a node of the image.
+class node_view {
+public:
+  explicit node_view(const char* data) noexcept : _data(data) {}
+
+  [[nodiscard]] std::string_view label() const noexcept {
+    return std::string_view(_data + 1, static_cast<unsigned char>(*_data));
+  }
+  [[nodiscard]] std::uint32_t child_count() const noexcept {
+    return wire::get_uint32(counts());
+  }
+  [[nodiscard]] std::uint32_t rrset_count() const noexcept {
+    return wire::get_uint32(counts() + sizeof(std::uint32_t));
+  }
+  [[nodiscard]] std::uint32_t child(std::size_t i) const noexcept {
+    return wire::get_uint32(counts() + node_counts_size + i * offset_size);
+  }
+  [[nodiscard]] std::uint32_t rrset(std::size_t i) const noexcept {
+    return child(child_count() + i);
+  }
+
+private:
+  [[nodiscard]] const char* counts() const noexcept {
+    return _data + 1 + label().size();
+  }
+
+  const char* _data;
+};
+
+// Walks the structure of an image once, checking that every node, record
+// set and record lies within the payload, so that serving the image can
+// trust the offsets and lengths it reads. The layout must be the one
+// `zone_image_writer` writes: every node right after the offsets of its
+// parent or after the subtree of its previous sibling, then the record
+// sets in the order of their nodes. That rules out cycles and shared
+// parts, so the walk takes linear time.
+class layout_check {
+public:
+  explicit layout_check(std::string_view payload) noexcept
+      : _payload(payload) {}
+
+  // @return the number of records, or nothing if the layout is broken
+  std::optional<std::size_t> run() {
+    std::size_t end = check_node(0, 0);
+    for (auto offset : _rrsets) {
+      if (end == 0 || offset != end) {
+        return std::nullopt;
+      }
+      end = check_rrset(offset);
+    }
+    if (end == 0 || end != _payload.size()) {
+      return std::nullopt;
+    }
+    return _records;
+  }
+
+private:
+  // @param name_length - the length of the name of the parent in the wire
+  //     format, without the root label
+  // @return the end of the subtree of the node, or 0 if it is broken
+  std::size_t check_node(std::size_t offset, std::size_t name_length) {
+    if (offset == _payload.size()) {
+      return 0;
+    }
+    node_view node(_payload.data() + offset);
+    std::size_t label_length = node.label().size();
+    if ((label_length == 0) != (offset == 0) ||
+        label_length > max_label_length) {
+      return 0;
+    }
+    if (offset > 0) {
+      name_length += label_length + 1;
+    }
+    std::size_t end = offset + 1 + label_length + node_counts_size;
+    if (name_length + 1 > max_name_length || end > _payload.size()) {
+      return 0;
+    }
+    std::size_t child_count = node.child_count();
+    std::size_t rrset_count = node.rrset_count();
+    if ((_payload.size() - end) / offset_size < child_count + rrset_count) {
+      return 0;
+    }
+    end += (child_count + rrset_count) * offset_size;
+    for (std::size_t i = 0; i < rrset_count; ++i) {
+      _rrsets.push_back(node.rrset(i));
+    }
+    for (std::size_t i = 0; i < child_count && end != 0; ++i) {
+      end = node.child(i) == end ? check_node(end, name_length) : 0;
+    }
+    return end;
+  }
+
+  // @return the end of the record set, or 0 if it is broken
+  std::size_t check_rrset(std::size_t offset) {
+    if (_payload.size() - offset < rrset_header_size) {
+      return 0;
+    }
+    std::size_t count =
+        wire::get_uint16(_payload.data() + offset + sizeof(std::uint16_t));
+    std::size_t end = offset + rrset_header_size;
+    for (std::size_t i = 0; i < count; ++i) {
+      if (_payload.size() - end < record_header_size) {
+        return 0;
+      }
+      std::size_t length =
+          wire::get_uint16(_payload.data() + end + sizeof(std::uint32_t));
+      end += record_header_size;
+      if (_payload.size() - end < length) {
+        return 0;
+      }
+      end += length;
+    }
+    _records += count;
+    return end;
+  }
+
+  std::string_view _payload;
+  std::vector<std::uint32_t> _rrsets;
+  std::size_t _records = 0;
+};
+
+template <typename Functor>
+void for_each_record(std::string_view payload, node_view node,
+                     domain_name& owner, Functor& f) {
+  for (std::size_t i = 0; i < node.rrset_count(); ++i) {
+    f(owner, payload.data() + node.rrset(i));
+  }
+  for (std::size_t i = 0; i < node.child_count(); ++i) {
+    node_view child(payload.data() + node.child(i));
+    auto l = child.label();
+    owner.add_subdomain(label_view(l.data(), l.size()));
+    for_each_record(payload, child, owner, f);
+    owner.remove_subdomain();
+  }
+}
+}  // namespace
+
+record_type zone_image::rrset_view::type() const noexcept {
+  return static_cast<record_type>(wire::get_uint16(_data));
+}
+
+std::size_t zone_image::rrset_view::size() const noexcept {
+  return wire::get_uint16(_data + sizeof(std::uint16_t));
+}
+
+std::uint32_t zone_image::rrset_view::ttl(const char* record) noexcept {
+  return wire::get_uint32(record);
+}
+
+std::size_t zone_image::rrset_view::rdata_length(const char* record) noexcept {
+  return wire::get_uint16(record + sizeof(std::uint32_t));
+}
+
+zone_image::zone_image(const std::string& path) : _file(path) {
+  std::string_view content = _file.content();
+  if (content.size() < header_size ||
+      content.substr(0, magic.size()) != magic) {
+    throw invalid_image(path, "not a zone image");
+  }
+  const char* header = content.data() + magic.size();
+  if (wire::get_uint32(header) != version) {
+    throw invalid_image(path, "unsupported version");
+  }
+  std::uint32_t checksum = wire::get_uint32(header + 4);
+  std::uint32_t payload_size = wire::get_uint32(header + 8);
+  _record_count = wire::get_uint32(header + 12);
+  _payload = content.substr(header_size);
+  if (_payload.size() != payload_size) {
+    throw invalid_image(path, "truncated");
+  }
+  if (crc32(_payload) != checksum) {
+    throw invalid_image(path, "checksum mismatch");
+  }
+  auto records = layout_check(_payload).run();
+  if (!records || *records != _record_count) {
+    throw invalid_image(path, "malformed");
+  }
+}
+
+const char* zone_image::find_node(const domain_name& name) const noexcept {
+  node_view node(_payload.data());
+  const char* data = _payload.data();
+  for (const auto& label : name) {
+    std::string_view l(label.data(), label.size());
+    std::size_t first = 0;
+    std::size_t last = node.child_count();
+    while (first < last) {
+      std::size_t middle = first + (last - first) / 2;
+      if (node_view(_payload.data() + node.child(middle)).label() < l) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+    if (first == node.child_count()) {
+      return nullptr;
+    }
+    data = _payload.data() + node.child(first);
+    node_view child(data);
+    if (child.label() != l) {
+      return nullptr;
+    }
+    node = child;
+  }
+  return data;
+}
+
+std::size_t zone_image::rrset_count(const char* node) noexcept {
+  return node_view(node).rrset_count();
+}
+
+std::uint32_t zone_image::rrset_offset(const char* node,
+                                       std::size_t i) noexcept {
+  return node_view(node).rrset(i);
+}
+
+std::optional<zone_image::rrset_view>
+zone_image::find(const domain_name& name, record_type type) const noexcept {
+  std::optional<rrset_view> result;
+  for_each_rrset(name, [&result, type](const rrset_view& rrset) {
+    if (rrset.type() == type) {
+      result = rrset;
+    }
+  });
+  return result;
+}
+
+domain_name zone_image::origin() const {
+  // The names above the apex have neither records nor siblings.
+  domain_name name(".");
+  node_view node(_payload.data());
+  while (node.rrset_count() == 0 && node.child_count() == 1) {
+    node = node_view(_payload.data() + node.child(0));
+    auto l = node.label();
+    name.add_subdomain(label_view(l.data(), l.size()));
+  }
+  return node.rrset_count() == 0 ? domain_name(".") : name;
+}
+
+void zone_image::read(record_consumer& consumer) const {
+  consumer.consume_zone_begin();
+  domain_name owner(".");
+  auto consume = [&consumer](const domain_name& name, const char* data) {
+    rrset_view rrset(data);
+    rrset.for_each([&consumer, &name, &rrset](const record& r) {
+      consumer.consume(domain_name(name),
+                       wire::make_record(rrset.type(), r.ttl, r.rdata));
+    });
+  };
+  for_each_record(_payload, node_view(_payload.data()), owner, consume);
+  consumer.consume_zone_end();
+}
+
+struct zone_image_writer::node {
+  using rrset_map =
+      std::map<std::uint16_t,
+               std::vector<std::pair<std::uint32_t, std::string>>>;
+
+  // `std::string` compares labels the same way as the image is searched
+  std::map<std::string, std::unique_ptr<node>> children;
+  // TTLs and data in the wire format of the records by type
+  rrset_map rrsets;
+};
+
+zone_image_writer::zone_image_writer() : _root(std::make_unique<node>()) {}
+
+zone_image_writer::~zone_image_writer() = default;
+
+void zone_image_writer::consume(domain_name&& name, resource_record_ptr rr) {
+  add(name, *rr);
+}
+
+void zone_image_writer::consume_batch(parsed_record* records,
+                                      std::size_t size) {
+  // Records are encoded in place, with no copy to the heap.
+  for (std::size_t i = 0; i < size; ++i) {
+    add(records[i].owner, records[i].get());
+  }
+}
+
+void zone_image_writer::add(const domain_name& name,
+                            const resource_record& rr) {
+  node* n = _root.get();
+  for (const auto& label : name) {
+    auto& child = n->children[std::string(label.data(), label.size())];
+    if (!child) {
+      child = std::make_unique<node>();
+    }
+    n = child.get();
+  }
+  std::string rdata;
+  wire::put_rdata(rdata, rr);
+  n->rrsets[static_cast<std::uint16_t>(rr.type())].emplace_back(
+      rr.ttl(chrono::zone_time), std::move(rdata));
+  ++_record_count;
+}
+
+void zone_image_writer::write(std::ostream& os) const {
+  static constexpr std::size_t max_offset =
+      std::numeric_limits<std::uint32_t>::max();
+  static constexpr std::size_t max_rrset_size =
+      std::numeric_limits<std::uint16_t>::max();
+
+  std::string payload;
+  auto set_offset = [&payload](std::size_t slot) {
+    if (payload.size() > max_offset) {
+      throw std::runtime_error("the zone image exceeds 4 GiB");
+    }
+    std::string offset;
+    wire::put_uint32(offset, static_cast<std::uint32_t>(payload.size()));
+    payload.replace(slot, offset.size(), offset);
+  };
+
+  // Nodes are written depth first. The offsets of the record sets are
+  // filled in once the sets are placed after all the nodes.
+  std::vector<std::pair<std::size_t, const node::rrset_map::value_type*>>
+      rrset_slots;
+  auto put_node = [&](const auto& self, std::string_view label,
+                      const node& n) -> void {
+    payload.push_back(static_cast<char>(label.size()));
+    payload.append(label);
+    wire::put_uint32(payload, static_cast<std::uint32_t>(n.children.size()));
+    wire::put_uint32(payload, static_cast<std::uint32_t>(n.rrsets.size()));
+    std::size_t slot = payload.size();
+    payload.append((n.children.size() + n.rrsets.size()) * offset_size, '\0');
+    std::size_t rrset_slot = slot + n.children.size() * offset_size;
+    for (const auto& rrset : n.rrsets) {
+      rrset_slots.emplace_back(rrset_slot, &rrset);
+      rrset_slot += offset_size;
+    }
+    for (const auto& [child_label, child] : n.children) {
+      set_offset(slot);
+      slot += offset_size;
+      self(self, child_label, *child);
+    }
+  };
+  put_node(put_node, {}, *_root);
+
+  for (const auto& [slot, rrset] : rrset_slots) {
+    const auto& [type, records] = *rrset;
+    if (records.size() > max_rrset_size) {
+      throw std::runtime_error("too many records in an RRset");
+    }
+    set_offset(slot);
+    wire::put_uint16(payload, type);
+    wire::put_uint16(payload, static_cast<std::uint16_t>(records.size()));
+    for (const auto& [ttl, rdata] : records) {
+      wire::put_uint32(payload, ttl);
+      wire::put_uint16(payload, static_cast<std::uint16_t>(rdata.size()));
+      payload.append(rdata);
+    }
+  }
+  if (payload.size() > max_offset) {
+    throw std::runtime_error("the zone image exceeds 4 GiB");
+  }
+
+  std::string header(zone_image::magic);
+  wire::put_uint32(header, zone_image::version);
+  wire::put_uint32(header, crc32(payload));
+  wire::put_uint32(header, static_cast<std::uint32_t>(payload.size()));
+  wire::put_uint32(header, _record_count);
+  header.resize(zone_image::header_size, '\0');
+  os.write(header.data(), static_cast<std::streamsize>(header.size()));
+  os.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+}
+}  // namespace beryl
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/mapped_file.hpp"
+#include "beryl/record_consumer.hpp"
+#include "beryl/record_type.hpp"
+
+namespace beryl {
+// A zone compiled into a binary image which is served from a memory
+// mapping as is, without parsing. Processes mapping the same image share
+// its pages in the page cache.
+//
+// The image consists of a header and a payload. All integers are in
+// network byte order.
+//
+// Header:
+//   magic "BERYLZIM" | version: u32 | CRC-32 of the payload: u32 |
+//   payload size: u32 | record count: u32 | reserved: u64
+//
+// The payload starts with the nodes of the domain tree, depth first from
+// the root node, followed by the record sets in the order of their nodes.
+// Offsets are counted from the beginning of the payload.
+//
+// Node:
+//   label length: u8 | label | child count: u32 | RRset count: u32 |
+//   child offsets: u32[], ordered by the labels of the children |
+//   RRset offsets: u32[], ordered by type
+//
+// RRset:
+//   type: u16 | record count: u16 |
+//   records: { TTL: u32 | data length: u16 | data in the wire format }[]
+class zone_image {
+public:
+  static constexpr std::uint32_t version = 1;
+  static constexpr std::string_view magic = "BERYLZIM";
+  static constexpr std::size_t header_size = 32;
+
+  // A record of an RRset, with the data in the wire format.
+  struct record {
+    std::uint32_t ttl;
+    std::string_view rdata;
+  };
+
+  class rrset_view {
+  public:
+    [[nodiscard]] record_type type() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    // Calls `f(const record&)` for every record of the set.
+    template <typename Functor>
+    void for_each(Functor f) const {
+      static constexpr std::size_t set_header_size = 4;
+      static constexpr std::size_t record_header_size = 6;
+      const char* pos = _data + set_header_size;
+      for (std::size_t i = 0, n = size(); i < n; ++i) {
+        std::size_t length = rdata_length(pos);
+        f(record{ttl(pos), std::string_view(pos + record_header_size, length)});
+        pos += record_header_size + length;
+      }
+    }
+
+  private:
+    friend class zone_image;
+    explicit rrset_view(const char* data) noexcept : _data(data) {}
+    static std::uint32_t ttl(const char* record) noexcept;
+    static std::size_t rdata_length(const char* record) noexcept;
+
+    const char* _data;
+  };
+
+  // Maps the image and verifies the header, the checksum and the layout
+  // of the payload. Computing the checksum reads the whole image once,
+  // which also brings it into the page cache.
+  //
+  // @throw std::system_error if the file can't be opened or mapped
+  // @throw std::runtime_error if the file isn't a valid image
+  explicit zone_image(const std::string& path);
+
+  [[nodiscard]] std::optional<rrset_view>
+  find(const domain_name& name, record_type type) const noexcept;
+
+  // Calls `f(const rrset_view&)` for every record set of the name,
+  // ordered by type.
+  //
+  // @return whether the image has the name, i.e. records of the name or
+  //     of the names below it
+  template <typename Functor>
+  bool for_each_rrset(const domain_name& name, Functor f) const {
+    const char* node = find_node(name);
+    if (!node) {
+      return false;
+    }
+    for (std::size_t i = 0, n = rrset_count(node); i < n; ++i) {
+      f(rrset_view(_payload.data() + rrset_offset(node, i)));
+    }
+    return true;
+  }
+
+  // @return the apex of the zone, i.e. the topmost name having records,
+  //     or the root if the image is empty
+  [[nodiscard]] domain_name origin() const;
+
+  [[nodiscard]] std::size_t record_count() const noexcept {
+    return _record_count;
+  }
+
+  // Feeds all the records of the image to the consumer: owners depth first,
+  // the records of an owner ordered by type.
+  void read(record_consumer& consumer) const;
+
+private:
+  // @return the node of the name or `nullptr`
+  const char* find_node(const domain_name& name) const noexcept;
+  static std::size_t rrset_count(const char* node) noexcept;
+  static std::uint32_t rrset_offset(const char* node, std::size_t i) noexcept;
+
+  mapped_file _file;
+  std::string_view _payload;
+  std::uint32_t _record_count = 0;
+};
+
+// Collects the records of a zone, e.g. fed by `read_zone`, and writes
+// them as a zone image.
+class zone_image_writer final : public record_consumer {
+public:
+  zone_image_writer();
+  ~zone_image_writer() final;
+
+  void consume_zone_begin() final {}
+  void consume_zone_end() final {}
+  void consume(domain_name&& name, resource_record_ptr rr) final;
+  void consume_batch(parsed_record* records, std::size_t size) final;
+
+  // @throw std::runtime_error if the image would exceed 4 GiB
+  void write(std::ostream& os) const;
+
+private:
+  struct node;
+
+  void add(const domain_name& name, const resource_record& rr);
+
+  std::unique_ptr<node> _root;
+  std::uint32_t _record_count = 0;
+};
+}  // namespace beryl
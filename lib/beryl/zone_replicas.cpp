@@ -0,0 +1,83 @@
+#include "beryl/zone_replicas.hpp"
+
+#include <exception>
+#include <thread>
+#include <utility>
+
+// jemalloc's, null unless the binary is linked with it
+extern "C" int mallctl(const char* name, void* oldp, std::size_t* oldlenp,
+                       void* newp, std::size_t newlen) __attribute__((weak));
+
+namespace beryl {
+namespace {
+// @return a new jemalloc arena or nothing if the allocator isn't jemalloc
+std::optional<unsigned> create_arena() noexcept {
+  unsigned arena = 0;
+  std::size_t size = sizeof(arena);
+  if (!mallctl || mallctl("arenas.create", &arena, &size, nullptr, 0) != 0) {
+    return std::nullopt;
+  }
+  return arena;
+}
+
+// Makes the calling thread allocate from the arena only: the cache of
+// the thread, which may hold memory of other arenas, is turned off.
+void use_arena(unsigned arena) noexcept {
+  bool off = false;
+  mallctl("thread.tcache.enabled", nullptr, nullptr, &off, sizeof(off));
+  mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena));
+}
+}  // namespace
+
+zone_replicas::zone_replicas(const zone_table& zones,
+                             std::vector<_impl::numa_node> nodes)
+    : _zones(zones), _nodes(std::move(nodes)) {
+  for (std::size_t i = 0; i < _nodes.size(); ++i) {
+    _replicas.push_back(std::make_unique<zone_table>());
+    _arenas.push_back(create_arena());
+  }
+  update();
+}
+
+void zone_replicas::update() {
+  zone_table::zone_map published = _zones.snapshot();
+  std::vector<const zone*> changed;
+  for (const auto& [origin, z] : published) {
+    if (auto it = _copied.find(origin);
+        it == _copied.end() || it->second != z) {
+      changed.push_back(z.get());
+    }
+  }
+  if (changed.empty()) {
+    return;
+  }
+  // The nodes are copied to at the same time, each by a thread of its own.
+  // A failure of a thread is passed to the caller once all are done.
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(_nodes.size());
+  for (std::size_t i = 0; i < _nodes.size(); ++i) {
+    threads.emplace_back([this, i, &changed, &errors]() {
+      try {
+        _impl::pin_to_cpus(_nodes[i].cpus);
+        if (_arenas[i]) {
+          use_arena(*_arenas[i]);
+        }
+        for (const zone* z : changed) {
+          _replicas[i]->publish(copy_zone(*z));
+        }
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (const auto& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+  _copied = std::move(published);
+}
+}  // namespace beryl
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "beryl/server_thread.hpp"
+#include "beryl/zone_table.hpp"
+
+namespace beryl {
+// Copies of the zones of a table, one per NUMA node. The copy of a node
+// is made by a thread running on the node, so under the first-touch
+// policy of Linux its memory, i.e. the records, the nodes of the trees
+// and the answers rendered ahead, is local to the node. With jemalloc,
+// the thread allocates from an arena of the node, which never hands out
+// pages freed on another node, e.g. by `load_zones`. The servers give
+// the threads of a node its copy, see `udp_server`, and a thread on
+// the remote socket doesn't reach across the interconnect to answer.
+class zone_replicas {
+public:
+  // Copies the published zones to every node.
+  //
+  // @param nodes - the nodes to copy the zones to, with the CPUs
+  //     the threads serving queries are placed on
+  explicit zone_replicas(const zone_table& zones,
+                         std::vector<_impl::numa_node> nodes =
+                             _impl::numa_nodes());
+  zone_replicas(const zone_replicas&) = delete;
+  zone_replicas& operator=(const zone_replicas&) = delete;
+
+  // Copies the zones published to the table since the last update, e.g.
+  // on a reload, to every node.
+  //
+  // @throw std::exception what copying a zone throws; the zones are
+  //     copied again on the next update then
+  void update();
+
+  [[nodiscard]] const std::vector<_impl::numa_node>& nodes() const noexcept {
+    return _nodes;
+  }
+  // @param node - the index of the node in `nodes()`
+  [[nodiscard]] const zone_table& replica(std::size_t node) const noexcept {
+    return *_replicas[node];
+  }
+
+private:
+  const zone_table& _zones;
+  std::vector<_impl::numa_node> _nodes;
+  // `zone_table` is neither copyable nor movable
+  std::vector<std::unique_ptr<zone_table>> _replicas;
+  // the jemalloc arenas of the nodes, if the allocator is jemalloc
+  std::vector<std::optional<unsigned>> _arenas;
+  // the zones of the table as they were on the last update
+  zone_table::zone_map _copied;
+};
+}  // namespace beryl
@@ -0,0 +1,397 @@
+#include "beryl/zone_table.hpp"
+
+#include <sys/stat.h>
+
+#include <cassert>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "beryl/chrono.hpp"
+#include "beryl/query_responder.hpp"
+#include "beryl/read_zone.hpp"
+#include "beryl/wire.hpp"
+#include "beryl/zone_image.hpp"
+
+namespace beryl {
+namespace {
+// @return a key which tells records apart, including their TTLs, and
+//     orders the records of a name by type
+std::string record_key(const resource_record& rr) {
+  std::string key;
+  wire::put_uint16(key, static_cast<std::uint16_t>(rr.type()));
+  wire::put_rdata(key, rr);
+  wire::put_uint32(key, rr.ttl(chrono::zone_time));
+  return key;
+}
+
+// @param name - the name of the zone as configured
+// @throw std::runtime_error unless the zone has an SOA record at its
+//     apex, e.g. when its file is that of another zone
+void check_apex(const zone& z, const std::string& name) {
+  const auto& records = z.records();
+  for (auto cur = records.find(z.origin());
+       cur != records.end() && cur.domain() == z.origin(); cur.increment()) {
+    if (cur.value()->type() == record_type::soa) {
+      return;
+    }
+  }
+  throw std::runtime_error("no SOA record at the apex `" + name + "`");
+}
+
+// The canonical order of names, which is the order of `domain_tree`:
+// a name goes before its subdomains, siblings are ordered by their
+// labels.
+bool canonical_less(const domain_name& lhs, const domain_name& rhs) noexcept {
+  return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
+                                      rhs.end());
+}
+
+struct keyed_record {
+  domain_name owner;
+  std::string key;
+  std::shared_ptr<const resource_record> record;
+};
+
+bool operator<(const keyed_record& lhs, const keyed_record& rhs) noexcept {
+  if (canonical_less(lhs.owner, rhs.owner)) {
+    return true;
+  }
+  if (canonical_less(rhs.owner, lhs.owner)) {
+    return false;
+  }
+  return lhs.key < rhs.key;
+}
+
+// Matches the records of the new version of a zone, as `read_zone` streams
+// them, against the records of the current version, tracked by a pointer
+// and a bit each. The records of a name are looked up in the tree once per
+// run of the name in the file, mostly once, as zone files keep the records
+// of a name together. Only the added records are kept.
+class record_matcher final : public record_consumer {
+public:
+  explicit record_matcher(const zone& current) : _current(current) {
+    _records.reserve(current.record_count());
+    for (auto cur = current.records().begin(); cur != current.records().end();
+         cur.increment()) {
+      _records.push_back(cur.value().get());
+    }
+    std::sort(_records.begin(), _records.end(), std::less<>());
+    _matched.resize(_records.size());
+  }
+
+  void consume_zone_begin() final {}
+  void consume_zone_end() final {}
+  void consume(domain_name&& name, resource_record_ptr rr) final {
+    if (!_owner || *_owner != name) {
+      look_up(name);
+    }
+    std::string key = record_key(*rr);
+    auto first = std::lower_bound(
+        _owner_records.begin(), _owner_records.end(), key,
+        [](const auto& lhs, const std::string& rhs) {
+          return lhs.first < rhs;
+        });
+    for (; first != _owner_records.end() && first->first == key; ++first) {
+      if (match(first->second)) {
+        return;
+      }
+    }
+    added.push_back(keyed_record{std::move(name), std::move(key),
+                                 std::shared_ptr<const resource_record>(
+                                     std::move(rr))});
+  }
+
+  // @return whether a record of the new version matches `rr`; every
+  //     match is taken once
+  bool take_match(const resource_record* rr) noexcept {
+    return flip(rr, true);
+  }
+
+  std::vector<keyed_record> added;
+
+private:
+  void look_up(const domain_name& name) {
+    _owner = name;
+    _owner_records.clear();
+    for (auto cur = _current.records().find(name);
+         cur != _current.records().end() && cur.domain() == name;
+         cur.increment()) {
+      _owner_records.emplace_back(record_key(*cur.value()),
+                                  cur.value().get());
+    }
+    std::sort(_owner_records.begin(), _owner_records.end(),
+              [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+              });
+  }
+
+  bool match(const resource_record* rr) noexcept { return flip(rr, false); }
+
+  // Flips the bit of a copy of `rr` in `_records` which is `from`.
+  //
+  // @return whether there is one
+  bool flip(const resource_record* rr, bool from) noexcept {
+    auto [first, last] = std::equal_range(_records.begin(), _records.end(),
+                                          rr, std::less<>());
+    for (; first != last; ++first) {
+      auto i = static_cast<std::size_t>(first - _records.begin());
+      if (_matched[i] == from) {
+        _matched[i] = !from;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const zone& _current;
+  // the records of the current version, by address
+  std::vector<const resource_record*> _records;
+  // whether the record at the same index in `_records` is matched
+  std::vector<bool> _matched;
+  // the name of the last record and the records of the current version
+  // with the name, by key
+  std::optional<domain_name> _owner;
+  std::vector<std::pair<std::string, const resource_record*>> _owner_records;
+};
+
+// @param records - sorted by the caller
+void add_changes(std::vector<zone_change>& changes,
+                 std::vector<keyed_record>& records) {
+  changes.reserve(records.size());
+  for (auto& r : records) {
+    changes.push_back(zone_change{std::move(r.owner), std::move(r.record)});
+  }
+}
+}  // namespace
+
+zone::zone(std::shared_ptr<const zone_image> image)
+    : _origin(image->origin()),
+      _count(image->record_count()),
+      _image(std::move(image)) {}
+
+void zone::consume(domain_name&& name, resource_record_ptr rr) {
+  std::shared_ptr<const resource_record> shared = std::move(rr);
+  _records.insert(name, shared);
+  ++_count;
+}
+
+void zone::consume_batch(parsed_record* records, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    std::shared_ptr<const resource_record> rr = records[i].release();
+    _records.insert(records[i].owner, rr);
+  }
+  _count += size;
+}
+
+void zone::apply(const zone_diff& diff) {
+  if (diff.empty()) {
+    return;
+  }
+  _templates.reset();
+  for (const auto& change : diff.removed) {
+    std::string key = record_key(*change.record);
+    bool removed = false;
+    _count -= _records.erase_if(
+        change.owner, [&key, &removed](const auto& rr) {
+          if (removed || record_key(*rr) != key) {
+            return false;
+          }
+          removed = true;
+          return true;
+        });
+    assert(removed && "the removed record isn't in the zone");
+  }
+  for (const auto& change : diff.added) {
+    _records.insert(change.owner, change.record);
+    ++_count;
+  }
+}
+
+std::shared_ptr<zone> copy_zone(const zone& z) {
+  if (z.image()) {
+    return std::make_shared<zone>(z);
+  }
+  auto copy = std::make_shared<zone>(z.origin());
+  std::string rdata;
+  for (auto cur = z.records().begin(); cur != z.records().end();
+       cur.increment()) {
+    const resource_record& rr = *cur.value();
+    rdata.clear();
+    wire::put_rdata(rdata, rr);
+    copy->consume(domain_name(cur.domain()),
+                  wire::make_record(rr.type(), rr.ttl(chrono::zone_time),
+                                    rdata));
+  }
+  if (z.templates()) {
+    prerender(*copy);
+  }
+  return copy;
+}
+
+std::shared_ptr<zone> open_zone_image(const std::string& path) {
+  auto image = std::make_shared<const zone_image>(path);
+  if (!image->find(image->origin(), record_type::soa)) {
+    throw std::runtime_error("zone image `" + path + "` has no SOA record");
+  }
+  return std::make_shared<zone>(std::move(image));
+}
+
+zone_diff diff_zone(const zone& current, const zone_config_entry& entry) {
+  record_matcher matcher(current);
+  read_zone(entry.file, entry.name, matcher);
+
+  std::vector<keyed_record> removed;
+  for (auto cur = current.records().begin(); cur != current.records().end();
+       cur.increment()) {
+    if (!matcher.take_match(cur.value().get())) {
+      removed.push_back(
+          keyed_record{cur.domain(), record_key(*cur.value()), cur.value()});
+    }
+  }
+  std::sort(removed.begin(), removed.end());
+  std::sort(matcher.added.begin(), matcher.added.end());
+
+  zone_diff diff;
+  add_changes(diff.removed, removed);
+  add_changes(diff.added, matcher.added);
+  return diff;
+}
+
+zone_diff reload_zone(zone_table& table, const zone_config_entry& entry,
+                      bool prerender) {
+  domain_name origin(entry.name);
+  std::shared_ptr<const zone> current = table.find(origin);
+  bool published = current && current->origin() == origin;
+  if (published && current->image()) {
+    // the image overrides the file
+    return {};
+  }
+  if (published) {
+    prerender = current->templates() != nullptr;
+  } else {
+    current = std::make_shared<zone>(origin);
+  }
+  zone_diff diff = diff_zone(*current, entry);
+  if (published && diff.empty()) {
+    return diff;
+  }
+  auto next = std::make_shared<zone>(*current);
+  next->apply(diff);
+  check_apex(*next, entry.name);
+  if (prerender) {
+    beryl::prerender(*next);
+  }
+  table.publish(std::move(next));
+  return diff;
+}
+
+void zone_table::publish(std::shared_ptr<const zone> z) {
+  assert(z && "a zone must be given");
+  std::unique_lock lock(_mutex);
+  auto origin = z->origin();
+  _zones.insert_or_assign(std::move(origin), std::move(z));
+  _version.fetch_add(1, std::memory_order_release);
+}
+
+zone_table::zone_map zone_table::snapshot() const {
+  std::shared_lock lock(_mutex);
+  return _zones;
+}
+
+std::shared_ptr<const zone> zone_table::find(domain_name name) const {
+  std::shared_lock lock(_mutex);
+  for (;;) {
+    if (auto it = _zones.find(name); it != _zones.end()) {
+      return it->second;
+    }
+    if (name.begin() == name.end()) {
+      return nullptr;
+    }
+    name.remove_subdomain();
+  }
+}
+
+std::size_t zone_table::size() const {
+  std::shared_lock lock(_mutex);
+  return _zones.size();
+}
+
+namespace {
+// @return the size of the file or zero if it can't be found out, in which
+//     case reading the zone reports the problem
+std::size_t file_size(const std::string& path) {
+  struct stat st {};
+  if (::stat(path.c_str(), &st) != 0) {
+    return 0;
+  }
+  return static_cast<std::size_t>(st.st_size);
+}
+}  // namespace
+
+std::vector<zone_load_error> load_zones(
+    const std::vector<zone_config_entry>& zones, zone_table& table,
+    std::size_t thread_count, bool prerender) {
+  assert(thread_count > 0 && "thread count must be positive");
+  std::vector<std::size_t> sizes;
+  sizes.reserve(zones.size());
+  for (const auto& entry : zones) {
+    sizes.push_back(file_size(entry.file));
+  }
+  std::vector<std::size_t> order(zones.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&sizes](std::size_t lhs, std::size_t rhs) {
+                     return sizes[lhs] > sizes[rhs];
+                   });
+
+  // A worker writes the problem of the zones it has taken only.
+  std::vector<std::optional<std::string>> problems(zones.size());
+  std::atomic<std::size_t> next{0};
+  auto work = [&]() {
+    for (;;) {
+      std::size_t i = next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= order.size()) {
+        return;
+      }
+      const auto& entry = zones[order[i]];
+      try {
+        auto z = std::make_shared<zone>(domain_name(entry.name));
+        read_zone(entry.file, entry.name, *z);
+        check_apex(*z, entry.name);
+        if (prerender) {
+          beryl::prerender(*z);
+        }
+        table.publish(std::move(z));
+      } catch (const std::exception& e) {
+        problems[order[i]] = e.what();
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < std::min(thread_count, zones.size()); ++t) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::vector<zone_load_error> errors;
+  for (std::size_t i = 0; i < zones.size(); ++i) {
+    if (problems[i]) {
+      errors.push_back(zone_load_error{zones[i].name, std::move(*problems[i])});
+    }
+  }
+  return errors;
+}
+}  // namespace beryl
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/domain_tree.hpp"
+#include "beryl/record_consumer.hpp"
+#include "beryl/resource_record.hpp"
+#include "beryl/zone_config.hpp"
+
+namespace beryl {
+class answer_templates;
+class zone_image;
+
+struct zone_change {
+  domain_name owner;
+  std::shared_ptr<const resource_record> record;
+};
+
+// The difference between two versions of a zone, as IXFR transfers it:
+// the records to delete and the records to add, each in the canonical
+// order of names. A record whose TTL changes is deleted and added.
+struct zone_diff {
+  [[nodiscard]] bool empty() const noexcept {
+    return removed.empty() && added.empty();
+  }
+
+  std::vector<zone_change> removed;
+  std::vector<zone_change> added;
+};
+
+// The records of an authoritative zone, filled by `read_zone`, or a zone
+// image served as is, see `open_zone_image`.
+class zone final : public record_consumer {
+public:
+  using record_tree = domain_tree<std::shared_ptr<const resource_record>>;
+
+  explicit zone(domain_name origin) : _origin(std::move(origin)) {}
+  // The records are those of the image, the tree is empty.
+  explicit zone(std::shared_ptr<const zone_image> image);
+  // The copy shares the records and the nodes of the tree with the zone
+  // until either is changed, see `domain_tree`.
+  zone(const zone&) = default;
+  zone& operator=(const zone&) = delete;
+
+  [[nodiscard]] const domain_name& origin() const noexcept { return _origin; }
+  [[nodiscard]] const record_tree& records() const noexcept {
+    return _records;
+  }
+  [[nodiscard]] std::size_t record_count() const noexcept { return _count; }
+  // @return the image the zone is served from or `nullptr`
+  [[nodiscard]] const zone_image* image() const noexcept {
+    return _image.get();
+  }
+  // @return the answers rendered ahead, see `prerender`, or `nullptr`
+  [[nodiscard]] const answer_templates* templates() const noexcept {
+    return _templates.get();
+  }
+  void set_templates(std::shared_ptr<const answer_templates> t) noexcept {
+    _templates = std::move(t);
+  }
+
+  void consume_zone_begin() final {}
+  void consume_zone_end() final {}
+  void consume(domain_name&& name, resource_record_ptr rr) final;
+  void consume_batch(parsed_record* records, std::size_t size) final;
+
+  // Deletes the removed records and inserts the added ones. Not
+  // synchronized with the readers of the zone, though only the nodes
+  // the zone doesn't share with its copies are changed, so the changes are
+  // applied to a copy of a published zone, see `reload_zone`. The answers
+  // rendered ahead are dropped unless the diff is empty.
+  //
+  // @pre the removed records are in the zone
+  void apply(const zone_diff& diff);
+
+private:
+  domain_name _origin;
+  record_tree _records;
+  std::size_t _count = 0;
+  std::shared_ptr<const answer_templates> _templates;
+  std::shared_ptr<const zone_image> _image;
+};
+
+// The zones being served, by origin. Zones are published one by one while
+// the server is already serving the published ones; lookups take a shared
+// lock only and share the ownership of the zone found, so a zone
+// republished on reload stays alive until the queries using it are done.
+class zone_table {
+public:
+  using zone_map = std::unordered_map<domain_name, std::shared_ptr<const zone>,
+                                      domain_name_hash>;
+
+  // Adds the zone or replaces the one with the same origin.
+  void publish(std::shared_ptr<const zone> z);
+
+  // @return the closest zone enclosing `name`, i.e. the one with
+  //     the longest origin `name` is within, or `nullptr` if none
+  [[nodiscard]] std::shared_ptr<const zone> find(domain_name name) const;
+
+  [[nodiscard]] std::size_t size() const;
+
+  // Changes whenever a zone is published. Threads serving queries keep
+  // a copy of the table, see `snapshot`, and check the version only,
+  // rather than share the lock and the reference counts of the zones on
+  // every query.
+  [[nodiscard]] std::uint64_t version() const noexcept {
+    return _version.load(std::memory_order_acquire);
+  }
+  // @return the published zones; the version of the copy is
+  //     `version()` called before
+  [[nodiscard]] zone_map snapshot() const;
+
+private:
+  mutable std::shared_mutex _mutex;
+  zone_map _zones;
+  std::atomic<std::uint64_t> _version{0};
+};
+
+// Copies the zone deeply: the records, the tree and the answers rendered
+// ahead are allocated anew by the calling thread, so that, pinned to
+// a NUMA node, the thread makes a copy local to the node. The image of
+// a zone is shared, as its pages are in the page cache.
+std::shared_ptr<zone> copy_zone(const zone& z);
+
+// Maps a zone image, see `zone_image`, as a zone to be published.
+//
+// @throw std::system_error if the file can't be opened or mapped
+// @throw std::runtime_error if the file isn't a valid image or the image
+//     has no SOA record at its apex
+std::shared_ptr<zone> open_zone_image(const std::string& path);
+
+// Compares the zone with the new version of its file. The new version is
+// streamed through `read_zone` and every record is matched against
+// the records of its name in the zone as it is read; only the added
+// records are kept, and the records of the zone take a pointer and a bit
+// each. The changes are sorted in the canonical order.
+//
+// @throw std::runtime_error if the new version can't be read
+zone_diff diff_zone(const zone& current, const zone_config_entry& entry);
+
+// Reloads a zone of the table applying only the changes to its records.
+// The changes are applied to a copy of the published zone, which shares
+// the records and the nodes the changes don't touch, and the copy is
+// published, so the queries being answered meanwhile see either version
+// as a whole. The answers of a prerendered zone are rendered again.
+// A zone not published yet, e.g. one which failed to load, is loaded.
+// A zone served from an image, see `open_zone_image`, is left as it is.
+// The reloads of a zone aren't synchronized with each other.
+//
+// @param prerender - whether to render the answers of a zone loaded anew
+// @return the changes
+// @throw std::runtime_error if the new version can't be read or has no
+//     SOA record at the apex, nothing is published then
+zone_diff reload_zone(zone_table& table, const zone_config_entry& entry,
+                      bool prerender = false);
+
+struct zone_load_error {
+  // the fully qualified name of the zone
+  std::string zone;
+  std::string message;
+};
+
+// Reads the zones concurrently with `thread_count` threads and publishes
+// each of them to `table` as soon as it is read. The largest zone files are
+// read first: an idle thread takes the largest of the remaining ones, so
+// the loading takes about as long as reading the largest zone rather than
+// all of them in turn. A zone which can't be read or has no SOA record at
+// its apex isn't published, nor does it stop the others from loading.
+//
+// @param prerender - whether to render the answers of a zone ahead, see
+//     `prerender`, before it is published
+// @return the problems of the zones which are not published, in the order
+//     of `zones`
+std::vector<zone_load_error> load_zones(
+    const std::vector<zone_config_entry>& zones, zone_table& table,
+    std::size_t thread_count, bool prerender = false);
+}  // namespace beryl
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <zlib.h>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace unit_testing {
+// @return `data` compressed in the gzip format
+inline std::string gzip(std::string_view data) {
+  z_stream stream{};
+  // 16 makes zlib write a gzip header and trailer
+  constexpr int gzip_window_bits = 15 + 16;
+  constexpr int memory_level = 8;
+  if (::deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     gzip_window_bits, memory_level,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("can't initialize gzip compression");
+  }
+  std::string out(::deflateBound(&stream, static_cast<uLong>(data.size())),
+                  '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+  int rc = ::deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  ::deflateEnd(&stream);
+  if (rc != Z_STREAM_END) {
+    throw std::runtime_error("can't compress");
+  }
+  return out;
+}
+}  // namespace unit_testing
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace unit_testing {
+// A temporary file with the given content, removed on destruction.
+class temp_file {
+public:
+  explicit temp_file(std::string_view content) {
+    int fd = ::mkstemp(_path.data());
+    if (fd < 0) {
+      throw std::runtime_error("can't create a temporary file");
+    }
+    for (auto rest = content; !rest.empty();) {
+      auto written = ::write(fd, rest.data(), rest.size());
+      if (written < 0) {
+        ::close(fd);
+        throw std::runtime_error("can't write a temporary file");
+      }
+      rest.remove_prefix(static_cast<std::size_t>(written));
+    }
+    ::close(fd);
+  }
+  ~temp_file() { ::unlink(_path.c_str()); }
+  temp_file(const temp_file&) = delete;
+  temp_file& operator=(const temp_file&) = delete;
+
+  [[nodiscard]] const std::string& path() const noexcept { return _path; }
+
+private:
+  std::string _path = "/tmp/beryl_unit_XXXXXX";
+};
+}  // namespace unit_testing
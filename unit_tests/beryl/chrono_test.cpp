@@ -0,0 +1,11 @@
+#include "beryl/chrono.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(chrono_test, now_is_close_to_system_clock) {
+  auto expected = std::chrono::duration_cast<beryl::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+  auto got = beryl::chrono::now().time_since_epoch();
+  EXPECT_LE((got - expected).count(), 1);
+  EXPECT_GE((got - expected).count(), -1);
+}
@@ -0,0 +1,150 @@
+#include "beryl/dns_message.hpp"
+
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/record_class.hpp"
+#include "beryl/record_type.hpp"
+#include "beryl/wire.hpp"
+
+using beryl::dns_message_view;
+using beryl::record_type;
+namespace dns = beryl::dns;
+namespace wire = beryl::wire;
+
+namespace {
+constexpr std::uint16_t query_id = 0xbeef;
+constexpr std::uint16_t type_mx = 15;
+constexpr std::uint16_t class_ch = 3;
+
+std::string make_header(std::uint16_t qdcount,
+                        std::uint16_t flags = dns::flag_rd) {
+  std::string message;
+  wire::put_uint16(message, query_id);
+  wire::put_uint16(message, flags);
+  wire::put_uint16(message, qdcount);
+  wire::put_uint16(message, 0);
+  wire::put_uint16(message, 0);
+  wire::put_uint16(message, 1);
+  return message;
+}
+
+// the name is in the wire format as is, e.g. with upper case letters
+std::string make_query(std::string_view name, std::uint16_t qtype,
+                       std::uint16_t qclass = dns::class_in) {
+  std::string message = make_header(1);
+  message.append(name.data(), name.size());
+  wire::put_uint16(message, qtype);
+  wire::put_uint16(message, qclass);
+  return message;
+}
+
+constexpr std::string_view www_example{"\3WwW\7example\3com\0", 17};
+}  // namespace
+
+TEST(dns_message_test, header) {
+  auto message = dns_message_view::parse(make_header(1, dns::flag_rd));
+  ASSERT_TRUE(message);
+  EXPECT_EQ(message->id(), query_id);
+  EXPECT_EQ(message->flags(), dns::flag_rd);
+  EXPECT_FALSE(message->is_response());
+  EXPECT_EQ(message->opcode(), 0);
+  EXPECT_EQ(message->question_count(), 1);
+  EXPECT_EQ(message->answer_count(), 0);
+  EXPECT_EQ(message->authority_count(), 0);
+  EXPECT_EQ(message->additional_count(), 1);
+
+  constexpr std::uint16_t notify = 4;
+  message = dns_message_view::parse(make_header(
+      0, static_cast<std::uint16_t>(dns::flag_qr |
+                                    notify << dns::opcode_shift)));
+  ASSERT_TRUE(message);
+  EXPECT_TRUE(message->is_response());
+  EXPECT_EQ(message->opcode(), notify);
+}
+
+TEST(dns_message_test, short_header) {
+  std::string header = make_header(1);
+  EXPECT_FALSE(dns_message_view::parse(""));
+  EXPECT_FALSE(
+      dns_message_view::parse(std::string_view(header).substr(0, 11)));
+}
+
+TEST(dns_message_test, question) {
+  // an OPT record may follow the question
+  std::string query = make_query(www_example, 1) + std::string(11, '\0');
+  auto message = dns_message_view::parse(query);
+  ASSERT_TRUE(message);
+  auto question = message->question();
+  ASSERT_TRUE(question);
+  EXPECT_EQ(question->name().data(), www_example);
+  std::vector<std::string_view> labels(question->name().begin(),
+                                       question->name().end());
+  EXPECT_EQ(labels,
+            (std::vector<std::string_view>{"WwW", "example", "com"}));
+  EXPECT_EQ(question->name().to_domain_name(),
+            beryl::domain_name("www.example.com."));
+  EXPECT_EQ(question->qtype(), 1);
+  EXPECT_EQ(question->supported_type(), record_type::a);
+  EXPECT_EQ(question->supported_class(), beryl::record_class::in);
+  EXPECT_EQ(question->data(),
+            std::string_view(query).substr(dns::header_size,
+                                           www_example.size() + 4));
+  // the data points into the message
+  EXPECT_EQ(question->data().data(), query.data() + dns::header_size);
+}
+
+TEST(dns_message_test, root_question) {
+  std::string query = make_query(std::string_view("\0", 1), dns::type_any);
+  auto question = dns_message_view::parse(query)->question();
+  ASSERT_TRUE(question);
+  EXPECT_EQ(question->name().begin(), question->name().end());
+  EXPECT_EQ(question->name().to_domain_name(), beryl::domain_name("."));
+  EXPECT_EQ(question->qtype(), dns::type_any);
+  EXPECT_FALSE(question->supported_type());
+}
+
+TEST(dns_message_test, unsupported_type_and_class) {
+  std::string query = make_query(www_example, type_mx, class_ch);
+  auto question = dns_message_view::parse(query)->question();
+  ASSERT_TRUE(question);
+  EXPECT_EQ(question->qtype(), type_mx);
+  EXPECT_EQ(question->qclass(), class_ch);
+  EXPECT_FALSE(question->supported_type());
+  EXPECT_FALSE(question->supported_class());
+}
+
+TEST(dns_message_test, malformed_question) {
+  auto question_of = [](const std::string& query) {
+    return dns_message_view::parse(query)->question();
+  };
+  EXPECT_FALSE(question_of(make_header(1)));
+  EXPECT_FALSE(question_of(make_header(0)));
+  std::string two = make_query(www_example, 1);
+  two[dns::qdcount_offset + 1] = 2;
+  EXPECT_FALSE(question_of(two));
+  // cut in the name, in the type and the class
+  std::string query = make_query(www_example, 1);
+  EXPECT_FALSE(question_of(query.substr(0, dns::header_size + 5)));
+  EXPECT_FALSE(question_of(query.substr(0, query.size() - 1)));
+  // a compression pointer
+  EXPECT_FALSE(question_of(make_query(std::string_view("\xc0\x0c", 2), 1)));
+  // a label longer than 63
+  std::string long_label(1, '\x40');
+  long_label.append(64, 'a').push_back('\0');
+  EXPECT_FALSE(question_of(make_query(long_label, 1)));
+  // a name longer than 255
+  std::string long_name;
+  for (int i = 0; i < 5; ++i) {
+    long_name.push_back('\x3f');
+    long_name.append(63, 'a');
+  }
+  long_name.push_back('\0');
+  EXPECT_FALSE(question_of(make_query(long_name, 1)));
+}
@@ -1,6 +1,8 @@
 #include "beryl/domain_name.hpp"
 
 #include <initializer_list>
+#include <string_view>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -201,6 +203,23 @@ TEST(domain_name_remove_subdomain_test, yields_expected_result) {
             domain_name("bravo.alpha."));
 }
 
+TEST(domain_name_from_wire_test, labels_of_any_octets) {
+  using namespace std::string_view_literals;
+  EXPECT_EQ(domain_name::from_wire("\0"sv), domain_name("."));
+  EXPECT_EQ(domain_name::from_wire("\3WWW\5Alpha\0"sv),
+            domain_name("www.alpha."));
+
+  auto name = domain_name::from_wire("\6_DMARC\2\x81\xC1\5alpha\0"sv);
+  std::vector<std::string_view> labels;
+  for (const auto& label : name) {
+    labels.emplace_back(label.data(), label.size());
+  }
+  EXPECT_EQ(labels, (std::vector<std::string_view>{"alpha", "\x81\xC1",
+                                                   "_dmarc"}));
+  // the octets of the labels aren't taken for lengths
+  EXPECT_EQ(name.remove_subdomain().remove_subdomain(), domain_name("alpha."));
+}
+
 TEST(domain_name_equals_test, equal) {
   EXPECT_EQ(domain_name("."), domain_name("."));
   EXPECT_EQ(domain_name("alpha."), domain_name("alpha."));
@@ -213,3 +232,18 @@ TEST(domain_name_equals_test, not_equal) {
   EXPECT_NE(domain_name("bravo.alpha."), domain_name("alpha."));
   EXPECT_NE(domain_name("alpha."), domain_name("bravo.alpha."));
 }
+
+TEST(domain_name_view_test, ancestor_view_equals_ancestor_name) {
+  using domain_name_view = beryl::domain_name_view;
+  domain_name dname("alpha.alpha.bravo.");
+  EXPECT_EQ(domain_name_view(dname, 0), domain_name_view(domain_name(".")));
+  EXPECT_EQ(domain_name_view(dname, 1),
+            domain_name_view(domain_name("bravo.")));
+  EXPECT_EQ(domain_name_view(dname, 2),
+            domain_name_view(domain_name("alpha.bravo.")));
+  EXPECT_EQ(domain_name_view(dname, 3), domain_name_view(dname));
+  EXPECT_NE(domain_name_view(dname, 2), domain_name_view(dname));
+  EXPECT_EQ(domain_name_view(dname, 2).hash(),
+            domain_name("alpha.bravo.").hash());
+  EXPECT_EQ(to_string(domain_name_view(dname, 2)), ".bravo.alpha");
+}
@@ -165,6 +165,59 @@ TEST(domain_tree_test, iteration) {
 }
 // clang-format on
 
+TEST(domain_tree_test, erase_if) {
+  auto dtree = generate_domain_tree({{"alpha.", {1, 11}},
+                                     {"charlie.bravo.alpha.", {3, 33}},
+                                     {"delta.alpha.", {4}}});
+  auto is_odd = [](int v) { return v % 2 == 1; };
+  EXPECT_EQ(dtree.erase_if(domain_name("echo.alpha."), is_odd), 0U);
+  EXPECT_EQ(dtree.erase_if(domain_name("bravo.alpha."), is_odd), 0U);
+  EXPECT_EQ(dtree.erase_if(domain_name("charlie.bravo.alpha."),
+                           [](int v) { return v == 3; }),
+            1U);
+  expect_domain_tree_eq("one value erased", dtree,
+                        {{".alpha", {1, 11}},
+                         {".alpha.bravo.charlie", {33}},
+                         {".alpha.delta", {4}}});
+
+  // the nodes left empty are removed up to the first one in use
+  EXPECT_EQ(dtree.erase_if(domain_name("charlie.bravo.alpha."), is_odd), 1U);
+  trace_t trace;
+  EXPECT_EQ(dtree.find(domain_name("charlie.bravo.alpha."), tracer(trace)),
+            dtree.end());
+  EXPECT_EQ(trace, trace_t({{".", {}}, {".alpha", {1, 11}}}));
+
+  // a node with children is kept
+  EXPECT_EQ(dtree.erase_if(domain_name("alpha."), is_odd), 2U);
+  expect_domain_tree_eq("inner node emptied", dtree, {{".alpha.delta", {4}}});
+  EXPECT_EQ(dtree.erase_if(domain_name("delta.alpha."), is_odd), 0U);
+  EXPECT_EQ(dtree.erase_if(domain_name("delta.alpha."),
+                           [](int v) { return v == 4; }),
+            1U);
+  EXPECT_EQ(dtree.begin(), dtree.end());
+  trace.clear();
+  dtree.find(domain_name("delta.alpha."), tracer(trace));
+  EXPECT_EQ(trace, trace_t({{".", {}}}));
+}
+
+TEST(domain_tree_test, copy_on_write) {
+  const auto original = generate_domain_tree({{"alpha.", {1}},
+                                              {"charlie.bravo.alpha.", {3}},
+                                              {"delta.alpha.", {4}}});
+  domain_tree<int> copy(original);
+  copy.insert(domain_name("echo.bravo.alpha."), 5);
+  copy.insert(domain_name("alpha."), 11);
+  copy.erase_if(domain_name("delta.alpha."), [](int) { return true; });
+  expect_domain_tree_eq("copy changed", copy,
+                        {{".alpha", {1, 11}},
+                         {".alpha.bravo.charlie", {3}},
+                         {".alpha.bravo.echo", {5}}});
+  expect_domain_tree_eq("original kept", original,
+                        {{".alpha", {1}},
+                         {".alpha.bravo.charlie", {3}},
+                         {".alpha.delta", {4}}});
+}
+
 template <typename T>
 class domain_tree_find_test : public ::testing::Test {};
 
@@ -0,0 +1,91 @@
+#include "beryl/gzip_reader.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "unit_testing/expect_throw_msg_eq.hpp"
+#include "unit_testing/gzip.hpp"
+
+using beryl::gzip_reader;
+using unit_testing::gzip;
+
+namespace {
+std::string read_all(gzip_reader& reader) {
+  std::string result;
+  std::string block;
+  while (reader.next(block)) {
+    result += block;
+  }
+  return result;
+}
+
+std::string make_text() {
+  std::string text;
+  for (int i = 0; i < 20000; ++i) {
+    text += "host" + std::to_string(i) + " IN A 192.0.2." +
+            std::to_string(i % 256) + "\n";
+  }
+  return text;
+}
+}  // namespace
+
+TEST(gzip_reader_test, is_gzip) {
+  EXPECT_TRUE(gzip_reader::is_gzip(gzip("zone")));
+  EXPECT_FALSE(gzip_reader::is_gzip("$TTL 1h\n"));
+  EXPECT_FALSE(gzip_reader::is_gzip("\x1f"));
+  EXPECT_FALSE(gzip_reader::is_gzip(""));
+}
+
+TEST(gzip_reader_test, decompression) {
+  auto text = make_text();
+  auto compressed = gzip(text);
+  {
+    gzip_reader reader(compressed);
+    EXPECT_EQ(read_all(reader), text);
+  }
+  {
+    // more blocks than buffers
+    gzip_reader reader(compressed, 1000, 2);
+    EXPECT_EQ(read_all(reader), text);
+    std::string block;
+    EXPECT_FALSE(reader.next(block));
+  }
+  {
+    auto empty = gzip("");
+    gzip_reader reader(empty);
+    EXPECT_EQ(read_all(reader), "");
+  }
+}
+
+TEST(gzip_reader_test, multiple_members) {
+  auto compressed = gzip("first\n") + gzip("second\n");
+  gzip_reader reader(compressed, 4, 1);
+  EXPECT_EQ(read_all(reader), "first\nsecond\n");
+}
+
+TEST(gzip_reader_test, invalid_data) {
+  auto text = make_text();
+  auto compressed = gzip(text);
+  {
+    gzip_reader reader(std::string_view(compressed).substr(
+        0, compressed.size() / 2));
+    EXPECT_THROW_MSG_EQ(read_all(reader), std::runtime_error,
+                        "truncated gzip data");
+  }
+  {
+    auto corrupt = compressed;
+    corrupt[3] = '\xff';  // reserved flags
+    gzip_reader reader(corrupt);
+    EXPECT_THROW(read_all(reader), std::runtime_error);
+  }
+}
+
+TEST(gzip_reader_test, reader_dropped_early) {
+  auto compressed = gzip(make_text());
+  gzip_reader reader(compressed, 100, 1);
+  std::string block;
+  EXPECT_TRUE(reader.next(block));
+  EXPECT_EQ(block.size(), 100U);
+}
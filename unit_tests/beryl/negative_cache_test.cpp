@@ -0,0 +1,118 @@
+#include "beryl/negative_cache.hpp"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "beryl/resource_record.hpp"
+
+using beryl::domain_name;
+using beryl::negative_answer;
+using beryl::negative_cache;
+using beryl::record_type;
+using beryl::soa_record;
+using beryl::chrono::seconds;
+using beryl::chrono::time_point;
+
+namespace {
+soa_record make_soa(std::uint32_t ttl, std::uint32_t min_ttl) {
+  return soa_record(ttl, "ns0.lima.mike.", "admin.lima.mike.", 1u, 2u, 3u, 4u,
+                    min_ttl);
+}
+}  // namespace
+
+TEST(negative_cache_test, nodata_is_per_type) {
+  time_point now(seconds(1'000'000));
+  negative_cache cache(1000, 4, std::chrono::hours(3), now);
+  domain_name zone("lima.mike.");
+  domain_name name("alpha.lima.mike.");
+  cache.insert_nodata(name, record_type::aaaa, zone, make_soa(3600, 600), now);
+
+  auto e = cache.find(name, record_type::aaaa, now);
+  ASSERT_TRUE(e);
+  EXPECT_EQ(e->answer, negative_answer::nodata);
+  EXPECT_EQ(e->zone, zone);
+  EXPECT_EQ(e->soa->ttl(now), 600);
+  EXPECT_EQ(e->soa->ttl(now + seconds(100)), 500);
+  EXPECT_FALSE(cache.find(name, record_type::a, now));
+  EXPECT_FALSE(cache.find(domain_name("x.alpha.lima.mike."), record_type::aaaa,
+                          now));
+}
+
+TEST(negative_cache_test, nxdomain_covers_the_subtree) {
+  time_point now(seconds(1'000'000));
+  negative_cache cache(1000, 4, std::chrono::hours(3), now);
+  domain_name zone("lima.mike.");
+  cache.insert_nxdomain(domain_name("alpha.lima.mike."), zone,
+                        make_soa(3600, 600), now);
+  EXPECT_EQ(cache.size(), 1);
+
+  for (const auto* name : {"alpha.lima.mike.", "x.alpha.lima.mike.",
+                           "y.x.alpha.lima.mike.", "alpha.alpha.lima.mike."}) {
+    SCOPED_TRACE(name);
+    for (auto type : {record_type::a, record_type::aaaa, record_type::ns}) {
+      auto e = cache.find(domain_name(name), type, now);
+      ASSERT_TRUE(e);
+      EXPECT_EQ(e->answer, negative_answer::nxdomain);
+    }
+  }
+  EXPECT_FALSE(cache.find(zone, record_type::a, now));
+  EXPECT_FALSE(
+      cache.find(domain_name("bravo.lima.mike."), record_type::a, now));
+  EXPECT_FALSE(cache.find(domain_name("alpha.mike."), record_type::a, now));
+}
+
+TEST(negative_cache_test, nodata_takes_precedence_over_nxdomain) {
+  time_point now(seconds(1'000'000));
+  negative_cache cache(1000, 1, std::chrono::hours(3), now);
+  domain_name zone("lima.mike.");
+  domain_name name("x.alpha.lima.mike.");
+  cache.insert_nxdomain(domain_name("alpha.lima.mike."), zone,
+                        make_soa(3600, 600), now);
+  cache.insert_nodata(name, record_type::a, zone, make_soa(3600, 60), now);
+  auto e = cache.find(name, record_type::a, now);
+  ASSERT_TRUE(e);
+  EXPECT_EQ(e->answer, negative_answer::nodata);
+}
+
+TEST(negative_cache_test, negative_ttl_is_bounded) {
+  time_point now(seconds(1'000'000));
+  negative_cache cache(1000, 1, seconds(900), now);
+  domain_name zone("lima.mike.");
+  auto ttl_of = [&](const char* name, std::uint32_t ttl,
+                    std::uint32_t min_ttl) {
+    cache.insert_nxdomain(domain_name(name), zone, make_soa(ttl, min_ttl), now);
+    auto e = cache.find(domain_name(name), record_type::a, now);
+    return e ? e->soa->ttl(now) : 0;
+  };
+  EXPECT_EQ(ttl_of("alpha.lima.mike.", 3600, 600), 600);
+  EXPECT_EQ(ttl_of("bravo.lima.mike.", 300, 600), 300);
+  EXPECT_EQ(ttl_of("charlie.lima.mike.", 3600, 7200), 900);
+  EXPECT_EQ(ttl_of("delta.lima.mike.", 3600, 0), 0);
+  EXPECT_EQ(cache.size(), 3);
+}
+
+TEST(negative_cache_test, expired_entries_are_evicted) {
+  time_point now(seconds(1'000'000));
+  negative_cache cache(1000, 2, std::chrono::hours(3), now);
+  domain_name zone("lima.mike.");
+  domain_name name("alpha.lima.mike.");
+  cache.insert_nxdomain(name, zone, make_soa(3600, 60), now);
+  cache.insert_nodata(zone, record_type::aaaa, zone, make_soa(3600, 120), now);
+  EXPECT_TRUE(cache.find(name, record_type::a, now + seconds(59)));
+  EXPECT_FALSE(cache.find(name, record_type::a, now + seconds(60)));
+  cache.expire(now + seconds(120));
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(negative_cache_test, entry_count_is_bounded) {
+  time_point now(seconds(1'000'000));
+  negative_cache cache(100, 1, std::chrono::hours(3), now);
+  domain_name zone("lima.mike.");
+  for (int i = 0; i < 1000; ++i) {
+    cache.insert_nxdomain(
+        domain_name("random" + std::to_string(i) + ".lima.mike."), zone,
+        make_soa(3600, 600), now);
+  }
+  EXPECT_EQ(cache.size(), 100);
+}
@@ -0,0 +1,441 @@
+#include "beryl/query_responder.hpp"
+
+#include <cstdint>
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/read_zone.hpp"
+#include "beryl/record_type.hpp"
+#include "beryl/wire.hpp"
+#include "beryl/zone_image.hpp"
+#include "beryl/zone_table.hpp"
+
+#include "unit_testing/temp_file.hpp"
+
+using beryl::domain_name;
+using beryl::query_responder;
+using beryl::record_type;
+using beryl::zone_table;
+namespace dns = beryl::dns;
+namespace wire = beryl::wire;
+
+namespace {
+constexpr std::uint16_t query_id = 0x1234;
+
+std::string make_query(const std::string& name, std::uint16_t qtype,
+                       std::uint16_t flags = dns::flag_rd,
+                       std::uint16_t qclass = dns::class_in) {
+  std::string query;
+  wire::put_uint16(query, query_id);
+  wire::put_uint16(query, flags);
+  wire::put_uint16(query, 1);
+  wire::put_uint16(query, 0);
+  wire::put_uint16(query, 0);
+  wire::put_uint16(query, 0);
+  // the labels are put as they are, as `domain_name` takes host names only
+  for (std::size_t pos = 0, dot; pos + 1 < name.size(); pos = dot + 1) {
+    dot = name.find('.', pos);
+    query.push_back(static_cast<char>(dot - pos));
+    query.append(name, pos, dot - pos);
+  }
+  query.push_back('\0');
+  wire::put_uint16(query, qtype);
+  wire::put_uint16(query, qclass);
+  return query;
+}
+
+std::string make_query(const std::string& name, record_type qtype) {
+  return make_query(name, static_cast<std::uint16_t>(qtype));
+}
+
+struct header {
+  explicit header(const std::string& message)
+      : id(wire::get_uint16(message.data())),
+        flags(wire::get_uint16(message.data() + 2)),
+        qdcount(wire::get_uint16(message.data() + 4)),
+        ancount(wire::get_uint16(message.data() + 6)),
+        nscount(wire::get_uint16(message.data() + 8)),
+        arcount(wire::get_uint16(message.data() + 10)) {}
+
+  [[nodiscard]] dns::rcode rcode() const noexcept {
+    return static_cast<dns::rcode>(flags & dns::rcode_mask);
+  }
+  [[nodiscard]] bool authoritative() const noexcept {
+    return (flags & dns::flag_aa) != 0;
+  }
+
+  std::uint16_t id;
+  std::uint16_t flags;
+  std::uint16_t qdcount;
+  std::uint16_t ancount;
+  std::uint16_t nscount;
+  std::uint16_t arcount;
+};
+
+const char* const movie_edu =
+    "$ORIGIN movie.edu.\n"
+    "$TTL 1h\n"
+    "@ IN SOA ns al 1 3h 1h 1w 1h\n"
+    "@ IN NS ns\n"
+    "ns IN A 192.249.249.1\n"
+    "www IN A 192.249.249.2\n"
+    "www IN A 192.249.249.3\n"
+    "www IN AAAA 2001:db8::1\n"
+    "ftp IN CNAME www\n"
+    "host.sub IN A 192.249.249.4\n"
+    "fx IN NS ns.fx\n"
+    "ns.fx IN A 192.253.254.1\n";
+
+std::shared_ptr<beryl::zone> read_movie_edu() {
+  std::istringstream is(movie_edu);
+  auto z = std::make_shared<beryl::zone>(domain_name("movie.edu."));
+  beryl::read_zone(is, *z);
+  return z;
+}
+
+class query_responder_test : public ::testing::Test {
+protected:
+  query_responder_test() {
+    _zones.publish(read_movie_edu());
+  }
+
+  header ask(const std::string& query) {
+    EXPECT_TRUE(_responder.respond(query, _response));
+    return header(_response);
+  }
+
+  zone_table _zones;
+  query_responder _responder{_zones};
+  std::string _response;
+};
+}  // namespace
+
+TEST_F(query_responder_test, answer) {
+  auto query = make_query("WWW.movie.edu.", record_type::a);
+  auto h = ask(query);
+  EXPECT_EQ(h.id, query_id);
+  EXPECT_EQ(h.flags & ~dns::rcode_mask,
+            dns::flag_qr | dns::flag_aa | dns::flag_rd);
+  EXPECT_EQ(h.rcode(), dns::rcode::no_error);
+  EXPECT_EQ(h.qdcount, 1);
+  EXPECT_EQ(h.ancount, 2);
+  EXPECT_EQ(h.nscount, 0);
+  // the question is echoed as is
+  EXPECT_EQ(_response.substr(dns::header_size, query.size() - dns::header_size),
+            query.substr(dns::header_size));
+
+  h = ask(make_query("www.movie.edu.", dns::type_any));
+  EXPECT_EQ(h.ancount, 3);
+  h = ask(make_query("ftp.movie.edu.", record_type::a));
+  EXPECT_EQ(h.ancount, 1);
+  h = ask(make_query("movie.edu.", record_type::soa));
+  EXPECT_EQ(h.ancount, 1);
+}
+
+TEST_F(query_responder_test, negative_answers) {
+  auto h = ask(make_query("nope.movie.edu.", record_type::a));
+  EXPECT_TRUE(h.authoritative());
+  EXPECT_EQ(h.rcode(), dns::rcode::name_error);
+  EXPECT_EQ(h.ancount, 0);
+  EXPECT_EQ(h.nscount, 1);
+
+  h = ask(make_query("ns.movie.edu.", record_type::aaaa));
+  EXPECT_EQ(h.rcode(), dns::rcode::no_error);
+  EXPECT_EQ(h.ancount, 0);
+  EXPECT_EQ(h.nscount, 1);
+
+  // an empty non-terminal exists
+  h = ask(make_query("sub.movie.edu.", record_type::a));
+  EXPECT_EQ(h.rcode(), dns::rcode::no_error);
+  EXPECT_EQ(h.nscount, 1);
+
+  h = ask(make_query("www.example.com.", record_type::a));
+  EXPECT_EQ(h.rcode(), dns::rcode::refused);
+  EXPECT_FALSE(h.authoritative());
+}
+
+TEST_F(query_responder_test, referral) {
+  auto h = ask(make_query("www.fx.movie.edu.", record_type::a));
+  EXPECT_FALSE(h.authoritative());
+  EXPECT_EQ(h.rcode(), dns::rcode::no_error);
+  EXPECT_EQ(h.ancount, 0);
+  EXPECT_EQ(h.nscount, 1);
+  EXPECT_EQ(h.arcount, 1);
+}
+
+TEST_F(query_responder_test, invalid_queries) {
+  std::string response;
+  EXPECT_FALSE(_responder.respond("short", response));
+  EXPECT_FALSE(_responder.respond(
+      make_query("www.movie.edu.", 1, dns::flag_qr), response));
+
+  auto h = ask(make_query("www.movie.edu.", 1, 2 << dns::opcode_shift));
+  EXPECT_EQ(h.rcode(), dns::rcode::not_implemented);
+  EXPECT_EQ(h.qdcount, 0);
+
+  auto query = make_query("www.movie.edu.", record_type::a);
+  h = ask(query.substr(0, query.size() - 1));
+  EXPECT_EQ(h.rcode(), dns::rcode::format_error);
+  query[5] = 2;  // QDCOUNT
+  h = ask(query);
+  EXPECT_EQ(h.rcode(), dns::rcode::format_error);
+
+  h = ask(make_query("www.movie.edu.", 1, 0, 3));
+  EXPECT_EQ(h.rcode(), dns::rcode::refused);
+}
+
+TEST_F(query_responder_test, labels_other_than_host_names) {
+  // e.g. of service names and policies, which aren't malformed
+  constexpr std::uint16_t type_txt = 16;
+  constexpr std::uint16_t type_srv = 33;
+  auto h = ask(make_query("_dmarc.MOVIE.edu.", type_txt));
+  EXPECT_EQ(h.rcode(), dns::rcode::name_error);
+  EXPECT_TRUE(h.authoritative());
+  h = ask(make_query("_sip._tcp.example.com.", type_srv));
+  EXPECT_EQ(h.rcode(), dns::rcode::refused);
+  h = ask(make_query("\xC1_.www.movie.edu.", record_type::a));
+  EXPECT_EQ(h.rcode(), dns::rcode::name_error);
+}
+
+TEST_F(query_responder_test, published_zones_are_picked_up) {
+  auto h = ask(make_query("www.example.com.", record_type::a));
+  EXPECT_EQ(h.rcode(), dns::rcode::refused);
+  std::istringstream is(
+      "example.com. 60 IN SOA ns.example.com. al.example.com. 1 2 3 4 5\n"
+      "www.example.com. 60 IN A 192.0.2.1\n");
+  auto z = std::make_shared<beryl::zone>(domain_name("example.com."));
+  beryl::read_zone(is, *z);
+  _zones.publish(std::move(z));
+  h = ask(make_query("www.example.com.", record_type::a));
+  EXPECT_EQ(h.rcode(), dns::rcode::no_error);
+  EXPECT_EQ(h.ancount, 1);
+}
+
+TEST_F(query_responder_test, large_response_is_truncated) {
+  std::string text =
+      "big.test. 60 IN SOA ns.big.test. al.big.test. 1 2 3 4 5\n";
+  for (int i = 0; i < 40; ++i) {
+    text += "big.test. 60 IN A 10.0.0." + std::to_string(i) + "\n";
+  }
+  std::istringstream is(text);
+  auto z = std::make_shared<beryl::zone>(domain_name("big.test."));
+  beryl::read_zone(is, *z);
+  _zones.publish(std::move(z));
+  auto query = make_query("big.test.", record_type::a);
+  auto h = ask(query);
+  EXPECT_NE(h.flags & dns::flag_tc, 0);
+  EXPECT_EQ(h.ancount, 0);
+  EXPECT_EQ(_response.size(), query.size());
+}
+
+TEST_F(query_responder_test, cached_response_is_patched) {
+  auto first = make_query("www.movie.edu.", record_type::a);
+  ask(first);
+  std::string first_response = _response;
+  EXPECT_EQ(_responder.cached_count(), 1);
+
+  // another ID, no RD flag, the name in another case
+  auto second = make_query("WwW.MOVIE.edu.", 1, 0);
+  second[0] = '\x43';
+  second[1] = '\x21';
+  auto h = ask(second);
+  EXPECT_EQ(_responder.cached_count(), 1);
+  EXPECT_EQ(h.id, 0x4321);
+  EXPECT_EQ(h.flags & dns::flag_rd, 0);
+  EXPECT_TRUE(h.authoritative());
+  EXPECT_EQ(h.ancount, 2);
+  std::size_t question_end = second.size();
+  EXPECT_EQ(_response.substr(dns::header_size,
+                             question_end - dns::header_size),
+            second.substr(dns::header_size));
+  EXPECT_EQ(_response.substr(question_end),
+            first_response.substr(question_end));
+}
+
+TEST_F(query_responder_test, size_limit_is_part_of_cache_key) {
+  std::string text =
+      "big.test. 60 IN SOA ns.big.test. al.big.test. 1 2 3 4 5\n";
+  for (int i = 0; i < 40; ++i) {
+    text += "big.test. 60 IN A 10.0.0." + std::to_string(i) + "\n";
+  }
+  std::istringstream is(text);
+  auto z = std::make_shared<beryl::zone>(domain_name("big.test."));
+  beryl::read_zone(is, *z);
+  _zones.publish(std::move(z));
+
+  auto query = make_query("big.test.", record_type::a);
+  auto h = ask(query);
+  EXPECT_NE(h.flags & dns::flag_tc, 0);
+  EXPECT_TRUE(_responder.respond(query, _response, dns::max_tcp_size));
+  h = header(_response);
+  EXPECT_EQ(h.flags & dns::flag_tc, 0);
+  EXPECT_EQ(h.ancount, 40);
+  EXPECT_EQ(_responder.cached_count(), 2);
+}
+
+TEST_F(query_responder_test, refusals_and_missing_names_are_not_cached) {
+  EXPECT_EQ(ask(make_query("nope.movie.edu.", record_type::a)).rcode(),
+            dns::rcode::name_error);
+  EXPECT_EQ(ask(make_query("www.example.com.", record_type::a)).rcode(),
+            dns::rcode::refused);
+  EXPECT_EQ(_responder.cached_count(), 0);
+  // a name without the type asked for is
+  EXPECT_EQ(ask(make_query("www.movie.edu.", record_type::ptr)).ancount, 0);
+  EXPECT_EQ(_responder.cached_count(), 1);
+}
+
+TEST(response_cache_test, visited_responses_survive_eviction) {
+  beryl::_impl::response_cache cache(2);
+  cache.insert("hot", "1");
+  ASSERT_NE(cache.find("hot"), nullptr);
+  cache.insert("cold", "2");
+  // over the capacity, the entry not asked for since it was inserted goes
+  cache.insert("new", "3");
+  EXPECT_EQ(cache.size(), 2U);
+  ASSERT_NE(cache.find("hot"), nullptr);
+  EXPECT_EQ(*cache.find("hot"), "1");
+  EXPECT_EQ(cache.find("cold"), nullptr);
+
+  // a flood of keys asked once doesn't wipe the one asked for again
+  for (int i = 0; i < 100; ++i) {
+    cache.insert("flood" + std::to_string(i), "4");
+    ASSERT_NE(cache.find("hot"), nullptr);
+  }
+  EXPECT_EQ(cache.size(), 2U);
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0U);
+  EXPECT_EQ(cache.find("hot"), nullptr);
+}
+
+TEST_F(query_responder_test, cache_may_be_off) {
+  query_responder responder(_zones, 0);
+  EXPECT_TRUE(
+      responder.respond(make_query("www.movie.edu.", record_type::a),
+                        _response));
+  EXPECT_EQ(header(_response).ancount, 2);
+  EXPECT_EQ(responder.cached_count(), 0);
+}
+
+TEST_F(query_responder_test, prerendered_answers) {
+  // the same zone with the answers rendered ahead
+  auto z = read_movie_edu();
+  beryl::prerender(*z);
+  ASSERT_NE(z->templates(), nullptr);
+  // the names with their types and ANY
+  EXPECT_EQ(z->templates()->size(), 16);
+  EXPECT_GT(z->templates()->memory_usage(), 0);
+  zone_table prerendered;
+  prerendered.publish(std::move(z));
+  query_responder responder(prerendered);
+
+  for (const auto& query :
+       {make_query("WWW.movie.edu.", record_type::a),
+        make_query("www.movie.edu.", dns::type_any),
+        make_query("ftp.movie.edu.", record_type::a),
+        make_query("movie.edu.", record_type::soa),
+        make_query("movie.edu.", record_type::ns),
+        make_query("host.sub.movie.edu.", record_type::a),
+        make_query("ns.fx.movie.edu.", record_type::a),
+        make_query("fx.movie.edu.", record_type::ns),
+        make_query("nope.movie.edu.", record_type::a),
+        make_query("www.movie.edu.", record_type::ptr)}) {
+    std::string expected;
+    EXPECT_TRUE(_responder.respond(query, expected));
+    std::string response;
+    EXPECT_TRUE(responder.respond(query, response));
+    EXPECT_EQ(response, expected);
+  }
+  // the answers about the types the names don't have are cached only,
+  // e.g. the CNAME answer to A, but NXDOMAIN isn't
+  EXPECT_EQ(responder.cached_count(), 2);
+}
+
+TEST_F(query_responder_test, prerendered_sections_are_referred_to) {
+  auto z = read_movie_edu();
+  beryl::prerender(*z);
+  zone_table prerendered;
+  prerendered.publish(std::move(z));
+  query_responder responder(prerendered);
+
+  auto query = make_query("www.movie.edu.", record_type::a);
+  beryl::response_parts parts;
+  ASSERT_TRUE(responder.respond(query, parts));
+  EXPECT_FALSE(parts.sections.empty());
+  std::string response;
+  EXPECT_TRUE(_responder.respond(query, response));
+  EXPECT_EQ(parts.head + std::string(parts.sections), response);
+  EXPECT_EQ(header(parts.head).ancount, 2);
+  // the same bytes are referred to again
+  auto sections = parts.sections;
+  ASSERT_TRUE(responder.respond(query, parts));
+  EXPECT_EQ(parts.sections.data(), sections.data());
+
+  // a negative answer is rendered as a whole
+  ASSERT_TRUE(responder.respond(make_query("nope.movie.edu.", record_type::a),
+                                parts));
+  EXPECT_TRUE(parts.sections.empty());
+  EXPECT_EQ(header(parts.head).rcode(), dns::rcode::name_error);
+
+  // the zones are left to the caller to refresh
+  prerendered.publish(std::make_shared<beryl::zone>(domain_name("movie.edu.")));
+  EXPECT_TRUE(responder.outdated());
+  ASSERT_TRUE(responder.respond(query, parts));
+  EXPECT_EQ(parts.sections.data(), sections.data());
+  responder.refresh();
+  EXPECT_FALSE(responder.outdated());
+  ASSERT_TRUE(responder.respond(query, parts));
+  EXPECT_TRUE(parts.sections.empty());
+}
+
+TEST_F(query_responder_test, zone_image_is_answered_from) {
+  std::istringstream is(movie_edu);
+  beryl::zone_image_writer writer;
+  beryl::read_zone(is, writer);
+  std::ostringstream image;
+  writer.write(image);
+  unit_testing::temp_file file(image.str());
+  zone_table images;
+  images.publish(beryl::open_zone_image(file.path()));
+  query_responder image_responder(images, 0);
+
+  // the image is answered from as the zone read from the same file is,
+  // though the records of a name may go in another order
+  for (const auto& [name, qtype] :
+       {std::pair("WWW.movie.edu.", static_cast<std::uint16_t>(1)),
+        std::pair("www.movie.edu.", dns::type_any),
+        std::pair("ftp.movie.edu.", static_cast<std::uint16_t>(1)),
+        std::pair("ftp.movie.edu.", static_cast<std::uint16_t>(5)),
+        std::pair("ns.movie.edu.", static_cast<std::uint16_t>(28)),
+        std::pair("nope.movie.edu.", static_cast<std::uint16_t>(1)),
+        std::pair("sub.movie.edu.", static_cast<std::uint16_t>(1)),
+        std::pair("host.sub.movie.edu.", static_cast<std::uint16_t>(1)),
+        std::pair("www.fx.movie.edu.", static_cast<std::uint16_t>(1)),
+        std::pair("fx.movie.edu.", static_cast<std::uint16_t>(2)),
+        std::pair("movie.edu.", static_cast<std::uint16_t>(6)),
+        std::pair("_dmarc.movie.edu.", static_cast<std::uint16_t>(16)),
+        std::pair("www.example.com.", static_cast<std::uint16_t>(1))}) {
+    SCOPED_TRACE(std::string(name) + " " + std::to_string(qtype));
+    auto query = make_query(name, qtype);
+    std::string expected;
+    std::string response;
+    ASSERT_TRUE(_responder.respond(query, expected));
+    ASSERT_TRUE(image_responder.respond(query, response));
+    EXPECT_EQ(response.size(), expected.size());
+    EXPECT_EQ(response.substr(0, dns::header_size),
+              expected.substr(0, dns::header_size));
+  }
+
+  auto query = make_query("www.movie.edu.", record_type::a);
+  std::string expected;
+  std::string response;
+  ASSERT_TRUE(_responder.respond(query, expected));
+  ASSERT_TRUE(image_responder.respond(query, response));
+  EXPECT_EQ(header(response).ancount, 2);
+  EXPECT_TRUE(header(response).authoritative());
+}
@@ -1,6 +1,7 @@
 #include "beryl/read_zone.hpp"
 
 #include <sstream>
+#include <system_error>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -11,11 +12,14 @@
 #include "beryl/resource_record.hpp"
 
 #include "unit_testing/expect_throw_msg_eq.hpp"
+#include "unit_testing/gzip.hpp"
+#include "unit_testing/temp_file.hpp"
 
 using beryl::domain_name;
 using beryl::read_zone;
 using beryl::record_consumer;
 using beryl::resource_record;
+using beryl::resource_record_ptr;
 
 namespace {
 class visitor_x final : public beryl::record_visitor {
@@ -45,7 +49,7 @@ class consumer_x : public record_consumer {
 public:
   void consume_zone_begin() final {}
   void consume_zone_end() final {}
-  void consume(domain_name&& name, std::unique_ptr<resource_record> rr) final {
+  void consume(domain_name&& name, resource_record_ptr rr) final {
     _records.emplace_back(std::move(name), std::move(rr));
   }
 
@@ -62,24 +66,73 @@ public:
   }
 
 private:
-  std::vector<std::pair<domain_name, std::unique_ptr<resource_record>>> _records;
+  std::vector<std::pair<domain_name, resource_record_ptr>> _records;
 };
 
+// The zones of the tests are small, so the parallel reader splits them
+// into chunks of a few lines.
+constexpr std::size_t parallel_thread_counts[] = {1, 2, 3, 7};
+
+// Reads the zone from a stream, from a memory-mapped file, from the file
+// with several threads and from the gzipped file.
 void expect_invalid_zone(const std::string& zone, const std::string& msg) {
   SCOPED_TRACE(zone);
-  std::stringstream s;
-  s << zone;
-  consumer_x c;
-  EXPECT_THROW_MSG_EQ(read_zone(s, c), std::runtime_error, msg.c_str());
+  {
+    std::stringstream s;
+    s << zone;
+    consumer_x c;
+    EXPECT_THROW_MSG_EQ(read_zone(s, c), std::runtime_error, msg.c_str());
+  }
+  {
+    unit_testing::temp_file f(zone);
+    consumer_x c;
+    EXPECT_THROW_MSG_EQ(read_zone(f.path(), c), std::runtime_error,
+                        msg.c_str());
+    for (std::size_t thread_count : parallel_thread_counts) {
+      SCOPED_TRACE(thread_count);
+      consumer_x pc;
+      EXPECT_THROW_MSG_EQ(read_zone(f.path(), pc, thread_count),
+                          std::runtime_error, msg.c_str());
+    }
+  }
+  {
+    unit_testing::temp_file f(unit_testing::gzip(zone));
+    consumer_x c;
+    EXPECT_THROW_MSG_EQ(read_zone(f.path(), c), std::runtime_error,
+                        msg.c_str());
+  }
 }
 
 void expect_zone_eq(const std::string& zone, const std::string& expected) {
   SCOPED_TRACE(zone);
-  std::stringstream s;
-  s << zone;
-  consumer_x c;
-  read_zone(s, c);
-  EXPECT_EQ(c.to_string(), expected);
+  {
+    std::stringstream s;
+    s << zone;
+    consumer_x c;
+    read_zone(s, c);
+    EXPECT_EQ(c.to_string(), expected);
+  }
+  {
+    unit_testing::temp_file f(zone);
+    consumer_x c;
+    read_zone(f.path(), c);
+    EXPECT_EQ(c.to_string(), expected);
+    for (std::size_t thread_count : parallel_thread_counts) {
+      SCOPED_TRACE(thread_count);
+      consumer_x pc;
+      read_zone(f.path(), pc, thread_count);
+      EXPECT_EQ(pc.to_string(), expected);
+    }
+  }
+  {
+    unit_testing::temp_file f(unit_testing::gzip(zone));
+    consumer_x c;
+    read_zone(f.path(), c);
+    EXPECT_EQ(c.to_string(), expected);
+    consumer_x pc;
+    read_zone(f.path(), pc, 2);
+    EXPECT_EQ(pc.to_string(), expected);
+  }
 }
 }  // namespace
 
@@ -174,6 +227,26 @@ TEST(dns_read_zone_test, cname_too_few_or_too_many_tokens_is_not_ok) {
       "line 2: too many tokens in the resource record");
 }
 
+TEST(dns_read_zone_test, ptr_too_few_or_too_many_tokens_is_not_ok) {
+  expect_invalid_zone(
+      "1.168.192.in-addr.arpa. 3600 IN SOA ns0.lima.mike. admin.lima.mike. "
+      "1 2 3 4 5\n"
+      "7.1.168.192.in-addr.arpa. 600 IN PTR",
+      "line 2: too few tokens in the resource record");
+  expect_zone_eq(
+      "1.168.192.in-addr.arpa. 3600 IN SOA ns0.lima.mike. admin.lima.mike. "
+      "1 2 3 4 5\n"
+      "7.1.168.192.in-addr.arpa. 600 IN PTR alpha.lima.mike.",
+      ".arpa.in-addr.192.168.1 3600 IN SOA .mike.lima.ns0 .mike.lima.admin "
+      "1 2 3 4 5\n"
+      ".arpa.in-addr.192.168.1.7 600 IN PTR .mike.lima.alpha");
+  expect_invalid_zone(
+      "1.168.192.in-addr.arpa. 3600 IN SOA ns0.lima.mike. admin.lima.mike. "
+      "1 2 3 4 5\n"
+      "7.1.168.192.in-addr.arpa. 600 IN PTR alpha.lima.mike. 42",
+      "line 2: too many tokens in the resource record");
+}
+
 TEST(dns_read_zone_test, a_too_few_or_too_many_tokens_is_not_ok) {
   expect_invalid_zone(
       "lima.mike. 3600 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n"
@@ -283,13 +356,26 @@ TEST(dns_read_zone_test, invalid_record_class_is_not_ok) {
       "line 1: unsupported resource record class: `HS`");
 }
 
+TEST(dns_read_zone_test, mnemonics_are_case_insensitive) {
+  expect_zone_eq(
+      "lima.mike. 3600 in soa ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n"
+      "lima.mike. 3600 In Ns ns0.lima.mike.\n"
+      "alpha.lima.mike. 3600 iN cNaMe lima.mike.",
+      ".mike.lima 3600 IN SOA .mike.lima.ns0 .mike.lima.admin 1 2 3 4 5\n"
+      ".mike.lima 3600 IN NS .mike.lima.ns0\n"
+      ".mike.lima.alpha 3600 IN CNAME .mike.lima");
+  expect_invalid_zone(
+      "lima.mike. 60 ch SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5",
+      "line 1: unsupported resource record class: `ch`");
+}
+
 TEST(dns_read_zone_test, unexpected_record_type_is_not_ok) {
   expect_invalid_zone(
-      "lima.mike. 3600 IN soa ns0.lima.mike. admin.lima.mike. 1 2 3 4 5",
-      "line 1: unsupported resource record type: `soa`");
+      "lima.mike. 3600 IN SO ns0.lima.mike. admin.lima.mike. 1 2 3 4 5",
+      "line 1: unsupported resource record type: `SO`");
   expect_invalid_zone(
-      "lima.mike. 3600 IN sOa ns0.lima.mike. admin.lima.mike. 1 2 3 4 5",
-      "line 1: unsupported resource record type: `sOa`");
+      "lima.mike. 3600 IN SOAA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5",
+      "line 1: unsupported resource record type: `SOAA`");
   expect_invalid_zone(
       "lima.mike. 3600 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n"
       "lima.mike. 3600 IN TXT \"alpha=bravo charlie=delta echo=foxtrot\"",
@@ -431,13 +517,13 @@ TEST(dns_read_zone_test, no_records_is_not_ok) {
   expect_invalid_zone("", "the zone has no resource records");
 }
 
-TEST(dns_read_zone_test, leading_space_or_tab_is_not_ok) {
+TEST(dns_read_zone_test, omitted_owner_of_first_record_is_not_ok) {
   expect_invalid_zone(
       " lima.mike. 3600 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5",
-      "line 1: the line starts with a space");
+      "line 1: the record has no owner name");
   expect_invalid_zone(
       "\tlima.mike. 3600 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5",
-      "line 1: invalid domain name: `\tlima.mike.`");
+      "line 1: the record has no owner name");
 }
 
 TEST(dns_read_zone_test, valid_zone_is_ok) {
@@ -536,3 +622,326 @@ TEST(dns_read_zone_test, heavily_annotated_zone_is_ok) {
       ".mike.lima.alpha 666 IN A 1.2.3.4\n"
       ".mike.lima.alpha 777 IN AAAA 1:2:3:4:c:d:e:f");
 }
+
+TEST(dns_read_zone_test, missing_file_is_not_ok) {
+  consumer_x c;
+  EXPECT_THROW(read_zone(std::string("/nonexistent/zone.db"), c),
+               std::system_error);
+}
+
+TEST(dns_read_zone_test, corrupt_gzipped_file_is_not_ok) {
+  auto compressed = unit_testing::gzip(
+      "lima.mike. 60 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n");
+  unit_testing::temp_file f(compressed.substr(0, compressed.size() - 4));
+  consumer_x c;
+  EXPECT_THROW_MSG_EQ(read_zone(f.path(), c), std::runtime_error,
+                      "truncated gzip data");
+}
+
+TEST(dns_read_zone_test, error_line_is_counted_across_chunks) {
+  std::string zone =
+      "lima.mike. 111 IN SOA ns0.lima.mike. admin.lima.mike. 11 22 33 44 55\n";
+  for (int i = 0; i < 20; ++i) {
+    zone += "\n; padding\nalpha.lima.mike. 666 IN A 1.2.3." +
+            std::to_string(i) + "\n";
+  }
+  zone += "lima.mike. 111 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n";
+  expect_invalid_zone(zone, "line 62: second SOA record in the zone");
+}
+
+TEST(dns_read_zone_test, master_file_syntax_is_ok) {
+  expect_zone_eq(
+      "$TTL 3h\n"
+      "movie.edu. IN SOA terminator.movie.edu. al.robocop.movie.edu. (\n"
+      "                          1        ; Serial\n"
+      "                          3h       ; Refresh after 3 hours\n"
+      "                          1h       ; Retry after 1 hour\n"
+      "                          1w       ; Expire after 1 week\n"
+      "                          1h )     ; Negative caching TTL of 1 hour\n"
+      ";\n"
+      "; Name servers\n"
+      ";\n"
+      "movie.edu.  IN NS  terminator.movie.edu.\n"
+      "@           IN NS  wormhole\n"
+      ";\n"
+      "; Addresses for the canonical names\n"
+      ";\n"
+      "localhost   IN A     127.0.0.1\n"
+      "robocop     IN A     192.249.249.2\n"
+      "terminator  IN A     192.249.249.3\n"
+      "wormhole    IN A     192.249.249.1\n"
+      "            IN A     192.253.253.1\n"
+      "\t\t    1d IN AAAA 2001:db8::1\n"
+      ";\n"
+      "; Aliases\n"
+      ";\n"
+      "bigt        IN CNAME terminator\n"
+      "dh          IN CNAME diehard\n"
+      "wh          IN 1h30m CNAME wormhole\n"
+      "$ORIGIN 249.249.192.in-addr.arpa.\n"
+      "1 IN PTR wormhole.movie.edu.\n",
+      ".edu.movie 10800 IN SOA .edu.movie.terminator .edu.movie.robocop.al "
+      "1 10800 3600 604800 3600\n"
+      ".edu.movie 10800 IN NS .edu.movie.terminator\n"
+      ".edu.movie 10800 IN NS .edu.movie.wormhole\n"
+      ".edu.movie.localhost 10800 IN A 127.0.0.1\n"
+      ".edu.movie.robocop 10800 IN A 192.249.249.2\n"
+      ".edu.movie.terminator 10800 IN A 192.249.249.3\n"
+      ".edu.movie.wormhole 10800 IN A 192.249.249.1\n"
+      ".edu.movie.wormhole 10800 IN A 192.253.253.1\n"
+      ".edu.movie.wormhole 86400 IN AAAA 2001:db8::1\n"
+      ".edu.movie.bigt 10800 IN CNAME .edu.movie.terminator\n"
+      ".edu.movie.dh 10800 IN CNAME .edu.movie.diehard\n"
+      ".edu.movie.wh 5400 IN CNAME .edu.movie.wormhole\n"
+      ".arpa.in-addr.192.249.249.1 10800 IN PTR .edu.movie.wormhole");
+}
+
+TEST(dns_read_zone_test, omitted_ttl_is_the_last_stated_one) {
+  expect_zone_eq(
+      "lima.mike. 60 IN SOA ns0 admin 1 2 3 4 5\n"
+      "ns0 IN A 1.2.3.4\n"
+      "ns1 120 IN A 1.2.3.5\n"
+      "ns2 A 1.2.3.6\n",
+      ".mike.lima 60 IN SOA .mike.lima.ns0 .mike.lima.admin 1 2 3 4 5\n"
+      ".mike.lima.ns0 60 IN A 1.2.3.4\n"
+      ".mike.lima.ns1 120 IN A 1.2.3.5\n"
+      ".mike.lima.ns2 120 IN A 1.2.3.6");
+  expect_zone_eq(
+      "$TTL 30\n"
+      "lima.mike. 60 IN SOA ns0 admin 1 2 3 4 5\n"
+      "ns0 IN A 1.2.3.4\n",
+      ".mike.lima 60 IN SOA .mike.lima.ns0 .mike.lima.admin 1 2 3 4 5\n"
+      ".mike.lima.ns0 30 IN A 1.2.3.4");
+  expect_invalid_zone(
+      "lima.mike. IN SOA ns0 admin 1 2 3 4 5\n",
+      "line 1: the record has no TTL and there is no `$TTL`");
+}
+
+TEST(dns_read_zone_test, relative_names_need_origin) {
+  expect_invalid_zone("lima.mike 60 IN SOA ns0 admin 1 2 3 4 5\n",
+                      "line 1: invalid domain name: `lima.mike`");
+  expect_invalid_zone("@ 60 IN SOA ns0 admin 1 2 3 4 5\n",
+                      "line 1: no origin to substitute `@` with");
+  expect_zone_eq(
+      "$ORIGIN mike.\n"
+      "lima 60 IN SOA ns0.lima admin.lima 1 2 3 4 5\n"
+      "$ORIGIN lima\n"
+      "alpha 60 IN A 1.2.3.4\n",
+      ".mike.lima 60 IN SOA .mike.lima.ns0 .mike.lima.admin 1 2 3 4 5\n"
+      ".mike.lima.alpha 60 IN A 1.2.3.4");
+}
+
+TEST(dns_read_zone_test, invalid_directive_is_not_ok) {
+  expect_invalid_zone("$INCLUDE db.lima.mike\n",
+                      "line 1: unsupported directive: `$INCLUDE`");
+  expect_invalid_zone("$TTL\n", "line 1: too few tokens in the directive");
+  expect_invalid_zone("$ORIGIN lima.mike. 60\n",
+                      "line 1: too many tokens in the directive");
+  expect_invalid_zone("$TTL 1y\n", "line 1: invalid time value: `1y`");
+  expect_invalid_zone("$TTL 9999999w\n",
+                      "line 1: invalid time value: `9999999w`");
+  expect_invalid_zone("$ORIGIN li#ma.mike.\n",
+                      "line 1: invalid domain name: `li#ma.mike.`");
+}
+
+TEST(dns_read_zone_test, unbalanced_parentheses_are_not_ok) {
+  expect_invalid_zone(
+      "lima.mike. 60 IN SOA ns0.lima.mike. admin.lima.mike. ( 1 2\n"
+      "3 4 5\n",
+      "line 3: unbalanced parentheses");
+  expect_invalid_zone(
+      "lima.mike. 60 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5 )\n",
+      "line 1: unbalanced parentheses");
+}
+
+TEST(dns_read_zone_test, multi_line_records_are_counted) {
+  std::string zone =
+      "$TTL 60\n"
+      "lima.mike. IN SOA ns0.lima.mike. admin.lima.mike. (\n"
+      "  1 2 3 4 5 )\n";
+  for (int i = 0; i < 10; ++i) {
+    zone += "alpha.lima.mike. IN NS (\n  ns" + std::to_string(i) +
+            ".lima.mike. )\n";
+  }
+  zone += "alpha.lima.mike. IN NS ( ns0.*lima.mike. )\n";
+  expect_invalid_zone(zone, "line 24: invalid domain name: `ns0.*lima.mike.`");
+}
+
+TEST(dns_read_zone_test, long_stream_is_read_in_blocks) {
+  std::string zone =
+      "lima.mike. 60 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n";
+  std::string expected =
+      ".mike.lima 60 IN SOA .mike.lima.ns0 .mike.lima.admin 1 2 3 4 5";
+  for (int i = 0; i < 10000; ++i) {
+    auto host = "host" + std::to_string(i);
+    zone += host + ".lima.mike. 60 IN CNAME ( ns0.lima.mike. ) ; comment\n";
+    expected += "\n.mike.lima." + host + " 60 IN CNAME .mike.lima.ns0";
+  }
+  expect_zone_eq(zone, expected);
+}
+
+// Entries longer than the head of a block joined to the entry split
+// between two blocks of the gzipped file.
+TEST(dns_read_zone_test, long_entries_span_blocks) {
+  std::string zone =
+      "lima.mike. 60 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n";
+  std::string expected =
+      ".mike.lima 60 IN SOA .mike.lima.ns0 .mike.lima.admin 1 2 3 4 5";
+  std::string comment(10000, 'x');
+  for (int i = 0; i < 200; ++i) {
+    auto host = "host" + std::to_string(i);
+    zone += host + ".lima.mike. 60 IN CNAME ( ; " + comment +
+            "\n    ns0.lima.mike. )\n";
+    expected += "\n.mike.lima." + host + " 60 IN CNAME .mike.lima.ns0";
+  }
+  expect_zone_eq(zone, expected);
+}
+
+TEST(dns_read_zone_test, records_are_consumed_in_batches) {
+  class batch_consumer final : public record_consumer {
+  public:
+    void consume_zone_begin() final {}
+    void consume_zone_end() final {}
+    void consume(domain_name&&, resource_record_ptr) final { ++single; }
+    void consume_batch(beryl::parsed_record* records, std::size_t size) final {
+      ++batches;
+      for (std::size_t i = 0; i < size; ++i) {
+        ttls.push_back(records[i].get().ttl());
+      }
+    }
+
+    std::size_t single = 0;
+    std::size_t batches = 0;
+    std::vector<std::uint32_t> ttls;
+  };
+
+  constexpr std::uint32_t record_count = 10000;
+  std::string zone =
+      "lima.mike. 0 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n";
+  std::vector<std::uint32_t> expected_ttls{0};
+  for (std::uint32_t i = 1; i < record_count; ++i) {
+    zone += "lima.mike. " + std::to_string(i) + " IN A 192.0.2.1\n";
+    expected_ttls.push_back(i);
+  }
+  {
+    std::istringstream s(zone);
+    batch_consumer c;
+    read_zone(s, c);
+    EXPECT_EQ(0U, c.single);
+    EXPECT_LT(c.batches, record_count / 100);
+    EXPECT_EQ(expected_ttls, c.ttls);
+  }
+  unit_testing::temp_file f(zone);
+  for (auto thread_count : parallel_thread_counts) {
+    SCOPED_TRACE(thread_count);
+    batch_consumer c;
+    read_zone(f.path(), c, thread_count);
+    EXPECT_EQ(0U, c.single);
+    EXPECT_EQ(expected_ttls, c.ttls);
+  }
+}
+
+namespace {
+class diagnostics_x final : public beryl::zone_error_sink {
+public:
+  explicit diagnostics_x(std::size_t limit = 1000) : _limit(limit) {}
+
+  bool report(const beryl::zone_diagnostic& d) final {
+    std::ostringstream s;
+    s << d.line << ":" << d.column << " " << static_cast<int>(d.code) << " "
+      << d.message;
+    diagnostics.push_back(s.str());
+    return diagnostics.size() < _limit;
+  }
+
+  std::vector<std::string> diagnostics;
+
+private:
+  std::size_t _limit;
+};
+
+std::string diagnostic(std::uint32_t line, std::uint32_t column,
+                       beryl::zone_error_code code, const std::string& msg) {
+  return std::to_string(line) + ":" + std::to_string(column) + " " +
+         std::to_string(static_cast<int>(code)) + " " + msg;
+}
+}  // namespace
+
+TEST(dns_read_zone_test, invalid_records_are_reported_and_skipped) {
+  using beryl::zone_error_code;
+  const std::string zone =
+      "$TTL 60\n"
+      "lima.mike. IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n"
+      "alpha IN A 192.0.2.1\n"
+      "bravo IN A 192.0.2.300\n"
+      "charlie IN MX 10 alpha\n"
+      "delta IN CNAME ( al*pha\n"
+      "  )\n"
+      "echo  XX NS alpha\n"
+      "foxtrot IN NS alpha )\n"
+      "$TTL 1x\n"
+      "golf IN AAAA 2001:db8::1\n"
+      "lima.mike. IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n";
+  const std::vector<std::string> expected_diagnostics{
+      diagnostic(4, 12, zone_error_code::invalid_address,
+                 "invalid IPv4 address: `192.0.2.300`"),
+      diagnostic(5, 12, zone_error_code::unsupported_type,
+                 "unsupported resource record type: `MX`"),
+      diagnostic(6, 18, zone_error_code::invalid_domain_name,
+                 "invalid domain name: `al*pha.lima.mike.`"),
+      diagnostic(8, 7, zone_error_code::unsupported_type,
+                 "unsupported resource record type: `XX`"),
+      diagnostic(9, 21, zone_error_code::unbalanced_parentheses,
+                 "unbalanced parentheses"),
+      diagnostic(10, 6, zone_error_code::invalid_time,
+                 "invalid time value: `1x`"),
+      diagnostic(12, 15, zone_error_code::misplaced_soa,
+                 "second SOA record in the zone")};
+  const std::string expected_records =
+      ".mike.lima 60 IN SOA .mike.lima.ns0 .mike.lima.admin 1 2 3 4 5\n"
+      ".mike.lima.alpha 60 IN A 192.0.2.1\n"
+      ".mike.lima.golf 60 IN AAAA 2001:db8::1";
+
+  {
+    std::istringstream s(zone);
+    consumer_x c;
+    diagnostics_x d;
+    EXPECT_EQ(expected_diagnostics.size(), read_zone(s, c, d));
+    EXPECT_EQ(expected_diagnostics, d.diagnostics);
+    EXPECT_EQ(expected_records, c.to_string());
+  }
+  unit_testing::temp_file f(zone);
+  consumer_x c;
+  diagnostics_x d;
+  EXPECT_EQ(expected_diagnostics.size(), read_zone(f.path(), c, d));
+  EXPECT_EQ(expected_diagnostics, d.diagnostics);
+  EXPECT_EQ(expected_records, c.to_string());
+}
+
+TEST(dns_read_zone_test, error_sink_can_stop_reading) {
+  std::istringstream s(
+      "lima.mike. 60 IN SOA ns0.lima.mike. admin.lima.mike. 1 2 3 4 5\n"
+      "alpha 60 IN A 192.0.2.1\n"
+      "bravo 60 IN A x\n"
+      "charlie 60 IN A 192.0.2.3\n"
+      "delta 60 IN A y\n");
+  consumer_x c;
+  diagnostics_x d(1);
+  EXPECT_EQ(1U, read_zone(s, c, d));
+  EXPECT_EQ(1U, d.diagnostics.size());
+  EXPECT_EQ(
+      ".mike.lima 60 IN SOA .mike.lima.ns0 .mike.lima.admin 1 2 3 4 5\n"
+      ".mike.lima.alpha 60 IN A 192.0.2.1",
+      c.to_string());
+}
+
+TEST(dns_read_zone_test, zone_without_records_is_reported) {
+  std::istringstream s("; nothing\n$TTL 60\n");
+  consumer_x c;
+  diagnostics_x d;
+  EXPECT_EQ(1U, read_zone(s, c, d));
+  EXPECT_EQ((std::vector<std::string>{diagnostic(
+                0, 0, beryl::zone_error_code::no_records,
+                "the zone has no resource records")}),
+            d.diagnostics);
+}
@@ -0,0 +1,191 @@
+#include "beryl/record_cache.hpp"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "beryl/resource_record.hpp"
+
+using beryl::a_record;
+using beryl::domain_name;
+using beryl::ns_record;
+using beryl::record_cache;
+using beryl::record_type;
+using beryl::chrono::seconds;
+using beryl::chrono::time_point;
+
+namespace {
+constexpr std::size_t megabyte = 1024 * 1024;
+
+// A stand-in for an upstream server: answers every A query with one record
+// expiring in `ttl` seconds and counts the queries.
+class upstream_x {
+public:
+  upstream_x(const time_point& now, std::int64_t ttl)
+      : _now(now), _ttl(ttl), _queries(0) {}
+
+  record_cache::rrset operator()(const domain_name&, record_type type) {
+    ++_queries;
+    if (type != record_type::a) {
+      return {};
+    }
+    return {std::make_shared<a_record>(_now + seconds(_ttl), "192.0.2.1")};
+  }
+
+  [[nodiscard]] int queries() const noexcept { return _queries; }
+
+private:
+  time_point _now;
+  std::int64_t _ttl;
+  int _queries;
+};
+}  // namespace
+
+TEST(record_cache_test, miss_fetches_from_upstream_and_hit_does_not) {
+  time_point now(seconds(1'000'000));
+  record_cache cache(megabyte, 4, now);
+  upstream_x upstream(now, 60);
+  domain_name name("alpha.lima.mike.");
+
+  auto fetch = [&upstream](auto&&... args) { return upstream(args...); };
+  auto first = cache.find_or_fetch(name, record_type::a, fetch, now);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(upstream.queries(), 1);
+  auto second =
+      cache.find_or_fetch(name, record_type::a, fetch, now + seconds(30));
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(upstream.queries(), 1);
+  EXPECT_EQ((*second)[0]->ttl(now + seconds(30)), 30);
+  EXPECT_EQ(cache.size(), 1);
+
+  EXPECT_FALSE(cache.find(name, record_type::aaaa, now));
+  EXPECT_FALSE(
+      cache.find(domain_name("bravo.lima.mike."), record_type::a, now));
+}
+
+TEST(record_cache_test, empty_answer_is_not_cached) {
+  time_point now(seconds(1'000'000));
+  record_cache cache(megabyte, 1, now);
+  upstream_x upstream(now, 60);
+  domain_name name("alpha.lima.mike.");
+  auto fetch = [&upstream](auto&&... args) { return upstream(args...); };
+  EXPECT_FALSE(cache.find_or_fetch(name, record_type::ns, fetch, now));
+  EXPECT_FALSE(cache.find_or_fetch(name, record_type::ns, fetch, now));
+  EXPECT_EQ(upstream.queries(), 2);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(record_cache_test, expired_entries_are_evicted) {
+  time_point now(seconds(1'000'000));
+  record_cache cache(megabyte, 2, now);
+  domain_name short_lived("alpha.lima.mike.");
+  domain_name long_lived("bravo.lima.mike.");
+  cache.insert(short_lived, record_type::a,
+               {std::make_shared<a_record>(now + seconds(10), "192.0.2.1")},
+               now);
+  cache.insert(long_lived, record_type::ns,
+               {std::make_shared<ns_record>(now + seconds(1000),
+                                            "ns0.lima.mike.")},
+               now);
+  EXPECT_EQ(cache.size(), 2);
+  auto usage = cache.memory_usage();
+
+  EXPECT_TRUE(cache.find(short_lived, record_type::a, now + seconds(9)));
+  EXPECT_FALSE(cache.find(short_lived, record_type::a, now + seconds(10)));
+
+  cache.insert(short_lived, record_type::a,
+               {std::make_shared<a_record>(now + seconds(20), "192.0.2.1")},
+               now);
+  cache.expire(now + seconds(19));
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.memory_usage(), usage);
+  cache.expire(now + seconds(20));
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_LT(cache.memory_usage(), usage);
+  EXPECT_TRUE(cache.find(long_lived, record_type::ns, now + seconds(20)));
+}
+
+TEST(record_cache_test, record_set_expires_with_its_earliest_record) {
+  time_point now(seconds(1'000'000));
+  record_cache cache(megabyte, 1, now);
+  domain_name name("alpha.lima.mike.");
+  cache.insert(name, record_type::a,
+               {std::make_shared<a_record>(now + seconds(100), "192.0.2.1"),
+                std::make_shared<a_record>(now + seconds(10), "192.0.2.2")},
+               now);
+  EXPECT_TRUE(cache.find(name, record_type::a, now + seconds(9)));
+  EXPECT_FALSE(cache.find(name, record_type::a, now + seconds(10)));
+}
+
+TEST(record_cache_test, memory_limit_is_enforced) {
+  time_point now(seconds(1'000'000));
+  const std::size_t limit = 16 * 1024;
+  record_cache cache(limit, 1, now);
+  domain_name hot("hot.lima.mike.");
+  cache.insert(hot, record_type::a,
+               {std::make_shared<a_record>(now + seconds(600), "192.0.2.1")},
+               now);
+  for (int i = 0; i < 1000; ++i) {
+    domain_name name("host" + std::to_string(i) + ".lima.mike.");
+    cache.insert(name, record_type::a,
+                 {std::make_shared<a_record>(now + seconds(600), "192.0.2.2")},
+                 now);
+    // SIEVE keeps an entry which is accessed between evictions
+    EXPECT_TRUE(cache.find(hot, record_type::a, now));
+    EXPECT_LE(cache.memory_usage(), limit);
+  }
+  EXPECT_LT(cache.size(), 1000);
+  EXPECT_GT(cache.size(), 0);
+}
+
+TEST(record_cache_test, newest_entry_expires) {
+  time_point now(seconds(1'000'000));
+  const std::size_t limit = 4 * 1024;
+  record_cache cache(limit, 1, now);
+  domain_name oldest("oldest.lima.mike.");
+  domain_name newest("newest.lima.mike.");
+  cache.insert(oldest, record_type::a,
+               {std::make_shared<a_record>(now + seconds(600), "192.0.2.1")},
+               now);
+  cache.insert(newest, record_type::a,
+               {std::make_shared<a_record>(now + seconds(10), "192.0.2.2")},
+               now);
+  EXPECT_FALSE(cache.find(newest, record_type::a, now + seconds(10)));
+  EXPECT_EQ(cache.size(), 1);
+
+  // the eviction queue is intact: the entries are still inserted and
+  // evicted, while the entry asked for is kept
+  for (int i = 0; i < 100; ++i) {
+    domain_name name("host" + std::to_string(i) + ".lima.mike.");
+    cache.insert(name, record_type::a,
+                 {std::make_shared<a_record>(now + seconds(600), "192.0.2.3")},
+                 now + seconds(10));
+    EXPECT_TRUE(cache.find(oldest, record_type::a, now + seconds(10)));
+    EXPECT_LE(cache.memory_usage(), limit);
+  }
+  EXPECT_GT(cache.size(), 1);
+}
+
+TEST(record_cache_test, concurrent_access) {
+  time_point now(seconds(1'000'000));
+  record_cache cache(megabyte, 8, now);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, &now, t]() {
+      upstream_x upstream(now, 60);
+      auto fetch = [&upstream](auto&&... args) { return upstream(args...); };
+      for (int i = 0; i < 1000; ++i) {
+        domain_name name("host" + std::to_string((i * 7 + t) % 100) +
+                         ".lima.mike.");
+        EXPECT_TRUE(cache.find_or_fetch(name, record_type::a, fetch, now));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(cache.size(), 100);
+}
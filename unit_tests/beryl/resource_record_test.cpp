@@ -1,7 +1,10 @@
 #include "beryl/resource_record.hpp"
 
+#include <cctype>
+
 #include <limits>
 #include <string>
+#include <type_traits>
 
 #include <gtest/gtest.h>
 
@@ -13,6 +16,7 @@ using beryl::a_record;
 using beryl::aaaa_record;
 using beryl::cname_record;
 using beryl::ns_record;
+using beryl::ptr_record;
 using beryl::record_type;
 using beryl::soa_record;
 
@@ -85,6 +89,7 @@ TEST(resource_record, ttl) {
   test_ttl<aaaa_record>("aaaa_record", "::1");
   test_ttl<ns_record>("ns_record", "ns0.lima.mike.");
   test_ttl<cname_record>("cname_record", "kilo.lima.mike.");
+  test_ttl<ptr_record>("ptr_record", "kilo.lima.mike.");
   test_ttl<soa_record>("soa_record", "ns0.lima.mike.", "admin.lima.mike.", 1u,
                        2u, 3u, 4u, 5u);
 }
@@ -94,10 +99,33 @@ TEST(dns_resource_record_test, record_type) {
   EXPECT_EQ(aaaa_record(3600u, "::1").type(), record_type::aaaa);
   EXPECT_EQ(ns_record(0u, "ns0.foo.").type(), record_type::ns);
   EXPECT_EQ(cname_record(0u, "bar.foo.").type(), record_type::cname);
+  EXPECT_EQ(ptr_record(0u, "bar.foo.").type(), record_type::ptr);
   EXPECT_EQ(soa_record(0u, "ns0.foo.", "admin.foo.", 0u, 0u, 0u, 0u, 0u).type(),
             record_type::soa);
 }
 
+TEST(dns_resource_record_test, record_type_mnemonic) {
+  static_assert(beryl::parse_record_type("cname") == record_type::cname);
+  static_assert(beryl::to_string(record_type::aaaa) == "AAAA");
+  for (auto rt : {record_type::a, record_type::ns, record_type::cname,
+                  record_type::soa, record_type::ptr, record_type::aaaa}) {
+    std::string name(beryl::to_string(rt));
+    EXPECT_EQ(beryl::parse_record_type(name), rt);
+    for (auto& c : name) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    EXPECT_EQ(beryl::parse_record_type(name), rt);
+  }
+  for (const char* name : {"", "MX", "TXT", "SOAA", "AA", "CNAM", "A6"}) {
+    EXPECT_FALSE(beryl::parse_record_type(name)) << name;
+  }
+  EXPECT_THROW_MSG_EQ(beryl::to_record_type("TXT"), std::runtime_error,
+                      "unsupported resource record type: `TXT`");
+
+  EXPECT_EQ(beryl::parse_record_class("in"), beryl::record_class::in);
+  EXPECT_FALSE(beryl::parse_record_class("CH"));
+}
+
 TEST(dns_a_resource_record_test, valid_address_is_ok) {
   EXPECT_EQ(a_record(0u, "127.0.0.1").address().to_string(), "127.0.0.1");
   EXPECT_EQ(a_record(0u, "0.0.0.0").address().to_string(), "0.0.0.0");
@@ -162,6 +190,12 @@ TEST(dns_cname_resource_record_test, cname) {
   });
 }
 
+TEST(dns_ptr_resource_record_test, ptrdname) {
+  test_domain_name("ptr domain name", [](const std::string& ptrdname) {
+    return ptr_record(0u, ptrdname).name;
+  });
+}
+
 TEST(dns_soa_resource_record_test, nameserver) {
   test_domain_name("soa nameserver", [](const std::string& ns) {
     return soa_record(0u, ns, "ns0.foo.", 1u, 2u, 3u, 4u, 5u).nameserver;
@@ -209,9 +243,26 @@ TEST(dns_soa_resource_record_test, min_ttl) {
 }
 
 TEST(dns_resource_record_test, size) {
-  EXPECT_EQ(sizeof(a_record), 24);
-  EXPECT_EQ(sizeof(aaaa_record), 32);
-  EXPECT_EQ(sizeof(ns_record), 40);
-  EXPECT_EQ(sizeof(cname_record), 40);
-  EXPECT_EQ(sizeof(soa_record), 88);
+  EXPECT_EQ(sizeof(a_record), 12);
+  EXPECT_EQ(sizeof(aaaa_record), 24);
+  EXPECT_EQ(sizeof(ns_record), 32);
+  EXPECT_EQ(sizeof(cname_record), 32);
+  EXPECT_EQ(sizeof(ptr_record), 32);
+  EXPECT_EQ(sizeof(soa_record), 80);
+}
+
+TEST(dns_resource_record_test, apply) {
+  auto name_of = [](const auto& rr) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(rr)>, ns_record>) {
+      return "ns " + beryl::to_string(rr.name);
+    } else {
+      return std::string("other");
+    }
+  };
+  beryl::resource_record_ptr ns =
+      beryl::make_resource_record<ns_record>(0u, "bar.foo.");
+  beryl::resource_record_ptr a =
+      beryl::make_resource_record<a_record>(0u, "192.0.2.1");
+  EXPECT_EQ(ns->apply(name_of), "ns .foo.bar");
+  EXPECT_EQ(a->apply(name_of), "other");
 }
@@ -0,0 +1,172 @@
+#include "beryl/reverse_index.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "beryl/read_zone.hpp"
+#include "beryl/resource_record.hpp"
+
+#include "unit_testing/expect_throw_msg_eq.hpp"
+
+using beryl::domain_name;
+using beryl::reverse_index;
+using address_v4 = beryl::reverse_index::address_v4;
+using address_v6 = beryl::reverse_index::address_v6;
+
+namespace {
+reverse_index load(const std::string& zone) {
+  std::stringstream s;
+  s << zone;
+  reverse_index index;
+  beryl::reverse_index_consumer consumer(index);
+  beryl::read_zone(s, consumer);
+  return index;
+}
+
+std::vector<domain_name> hosts(const reverse_index::lookup_result& r) {
+  return r.hosts ? *r.hosts : std::vector<domain_name>();
+}
+
+const char* const movie_edu =
+    "movie.edu. 3600 IN SOA toystory.movie.edu. al.movie.edu. 1 2 3 4 5\n"
+    "movie.edu. 3600 IN NS toystory.movie.edu.\n"
+    "shrek.movie.edu. 3600 IN A 192.249.249.2\n"
+    "toystory.movie.edu. 3600 IN A 192.249.249.3\n"
+    "wormhole.movie.edu. 3600 IN A 192.249.249.1\n"
+    "wormhole.movie.edu. 3600 IN A 192.253.253.1\n"
+    "wh249.movie.edu. 3600 IN A 192.249.249.1\n"
+    "toys.movie.edu. 3600 IN CNAME toystory.movie.edu.\n"
+    "shrek.movie.edu. 3600 IN AAAA 2001:db8::2\n";
+}  // namespace
+
+TEST(reverse_index_test, reverse_names) {
+  EXPECT_EQ(beryl::to_reverse_name(address_v4::from_string("192.249.249.3")),
+            domain_name("3.249.249.192.in-addr.arpa."));
+  EXPECT_EQ(beryl::to_reverse_name(address_v6::from_string("2001:db8::2")),
+            domain_name("2.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0."
+                        "0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa."));
+}
+
+TEST(reverse_index_test, find_by_address) {
+  auto index = load(movie_edu);
+  EXPECT_EQ(hosts(index.find(address_v4::from_string("192.249.249.3"))),
+            std::vector<domain_name>({domain_name("toystory.movie.edu.")}));
+  EXPECT_EQ(hosts(index.find(address_v4::from_string("192.249.249.1"))),
+            std::vector<domain_name>({domain_name("wormhole.movie.edu."),
+                                      domain_name("wh249.movie.edu.")}));
+  EXPECT_EQ(hosts(index.find(address_v6::from_string("2001:db8::2"))),
+            std::vector<domain_name>({domain_name("shrek.movie.edu.")}));
+  EXPECT_FALSE(index.find(address_v4::from_string("192.249.249.4")).hosts);
+  EXPECT_FALSE(index.find(address_v6::from_string("2001:db8::3")).hosts);
+}
+
+TEST(reverse_index_test, find_by_reverse_name) {
+  auto index = load(movie_edu);
+  EXPECT_EQ(hosts(index.find(domain_name("2.249.249.192.in-addr.arpa."))),
+            std::vector<domain_name>({domain_name("shrek.movie.edu.")}));
+  EXPECT_EQ(hosts(index.find(
+                domain_name("2.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0."
+                            "0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa."))),
+            std::vector<domain_name>({domain_name("shrek.movie.edu.")}));
+  EXPECT_FALSE(index.find(domain_name("249.249.192.in-addr.arpa.")).hosts);
+  EXPECT_FALSE(index.find(domain_name("256.249.249.192.in-addr.arpa.")).hosts);
+  EXPECT_FALSE(index.find(domain_name("02.249.249.192.in-addr.arpa.")).hosts);
+  EXPECT_FALSE(
+      index.find(domain_name("1.2.249.249.192.in-addr.arpa.")).hosts);
+  EXPECT_FALSE(
+      index.find(domain_name("2.249.249.192.in-addr.arpa.com.")).hosts);
+  EXPECT_FALSE(index.find(domain_name("movie.edu.")).hosts);
+}
+
+TEST(reverse_index_test, longest_prefix_delegation) {
+  auto index = load(movie_edu);
+  domain_name wide("249.192.in-addr.arpa.");
+  domain_name narrow("128-25.249.249.192.in-addr.arpa.");
+  index.delegate(address_v4::from_string("192.249.0.0"), 16, wide);
+  index.delegate(address_v4::from_string("192.249.249.128"), 25, narrow);
+
+  auto r = index.find(address_v4::from_string("192.249.249.3"));
+  EXPECT_TRUE(r.hosts);
+  ASSERT_TRUE(r.delegation);
+  EXPECT_EQ(*r.delegation, wide);
+
+  r = index.find(address_v4::from_string("192.249.249.200"));
+  EXPECT_FALSE(r.hosts);
+  ASSERT_TRUE(r.delegation);
+  EXPECT_EQ(*r.delegation, narrow);
+
+  r = index.find(domain_name("7.249.192.in-addr.arpa."));
+  ASSERT_TRUE(r.delegation);
+  EXPECT_EQ(*r.delegation, wide);
+
+  EXPECT_FALSE(index.find(address_v4::from_string("192.253.253.7")).delegation);
+  EXPECT_THROW_MSG_EQ(
+      index.delegate(address_v4::from_string("192.0.0.0"), 33, wide),
+      std::invalid_argument, "prefix length `33` exceeds the address length");
+}
+
+TEST(reverse_index_test, prefixes_in_any_order) {
+  // the delegations are inserted first, the hosts split their edges
+  reverse_index index;
+  domain_name all("in-addr.arpa.");
+  domain_name narrow("249.249.192.in-addr.arpa.");
+  index.delegate(address_v4::from_string("192.249.249.0"), 24, narrow);
+  index.delegate(address_v4::from_string("0.0.0.0"), 0, all);
+  index.insert(address_v4::from_string("192.249.249.3"),
+               domain_name("toystory.movie.edu."));
+  index.insert(address_v4::from_string("192.249.248.3"),
+               domain_name("shrek.movie.edu."));
+
+  auto r = index.find(address_v4::from_string("192.249.249.3"));
+  EXPECT_EQ(hosts(r),
+            std::vector<domain_name>({domain_name("toystory.movie.edu.")}));
+  ASSERT_TRUE(r.delegation);
+  EXPECT_EQ(*r.delegation, narrow);
+  r = index.find(address_v4::from_string("192.249.248.3"));
+  EXPECT_EQ(hosts(r),
+            std::vector<domain_name>({domain_name("shrek.movie.edu.")}));
+  ASSERT_TRUE(r.delegation);
+  EXPECT_EQ(*r.delegation, all);
+  // a prefix within an edge has no entry of its own
+  r = index.find(domain_name("249.192.in-addr.arpa."));
+  EXPECT_FALSE(r.hosts);
+  ASSERT_TRUE(r.delegation);
+  EXPECT_EQ(*r.delegation, all);
+  EXPECT_FALSE(index.find(address_v4::from_string("192.249.249.4")).hosts);
+}
+
+namespace {
+class ptr_collector : public beryl::record_consumer {
+public:
+  void consume_zone_begin() final {}
+  void consume_zone_end() final {}
+  void consume(domain_name&& name,
+               beryl::resource_record_ptr rr) final {
+    ASSERT_EQ(rr->type(), beryl::record_type::ptr);
+    std::ostringstream s;
+    s << name << " " << rr->ttl() << " " << rr->cast<beryl::ptr_record>()->name;
+    records.push_back(s.str());
+  }
+
+  std::vector<std::string> records;
+};
+}  // namespace
+
+TEST(reverse_index_test, make_ptr_records) {
+  auto index = load(movie_edu);
+  ptr_collector c;
+  index.make_ptr_records(c, 600);
+  EXPECT_EQ(
+      c.records,
+      std::vector<std::string>(
+          {".arpa.in-addr.192.249.249.1 600 .edu.movie.wormhole",
+           ".arpa.in-addr.192.249.249.1 600 .edu.movie.wh249",
+           ".arpa.in-addr.192.249.249.2 600 .edu.movie.shrek",
+           ".arpa.in-addr.192.249.249.3 600 .edu.movie.toystory",
+           ".arpa.in-addr.192.253.253.1 600 .edu.movie.wormhole",
+           ".arpa.ip6.2.0.0.1.0.d.b.8.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0."
+           "0.0.0.2 600 .edu.movie.shrek"}));
+}
@@ -0,0 +1,184 @@
+#include "beryl/tcp_server.hpp"
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <gtest/gtest.h>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/query_responder.hpp"
+#include "beryl/read_zone.hpp"
+#include "beryl/wire.hpp"
+#include "beryl/zone_table.hpp"
+
+namespace asio = boost::asio;
+using tcp = asio::ip::tcp;
+
+namespace {
+constexpr std::uint16_t type_a = 1;
+// more addresses than a UDP response takes
+constexpr int big_record_count = 64;
+
+void publish_test_zone(beryl::zone_table& zones) {
+  std::ostringstream text;
+  text << "test. 60 IN SOA ns.test. al.test. 1 2 3 4 5\n"
+          "www.test. 60 IN A 192.0.2.1\n";
+  for (int i = 0; i < big_record_count; ++i) {
+    text << "big.test. 60 IN A 192.0.2." << i << "\n";
+  }
+  std::istringstream is(text.str());
+  auto z = std::make_shared<beryl::zone>(beryl::domain_name("test."));
+  beryl::read_zone(is, *z);
+  zones.publish(std::move(z));
+}
+
+// @return the query prefixed with its length
+std::string make_query(std::uint16_t id, const char* name) {
+  std::string query;
+  beryl::wire::put_uint16(query, id);
+  beryl::wire::put_uint16(query, 0);
+  beryl::wire::put_uint16(query, 1);
+  query.append(6, '\0');
+  beryl::wire::put_name(query, beryl::domain_name(name));
+  beryl::wire::put_uint16(query, type_a);
+  beryl::wire::put_uint16(query, beryl::dns::class_in);
+  std::string message;
+  beryl::wire::put_uint16(message, static_cast<std::uint16_t>(query.size()));
+  return message + query;
+}
+
+std::string read_response(tcp::socket& socket) {
+  std::array<char, 2> length{};
+  asio::read(socket, asio::buffer(length));
+  std::string response(beryl::wire::get_uint16(length.data()), '\0');
+  asio::read(socket, asio::buffer(response));
+  return response;
+}
+
+class tcp_server_test : public ::testing::Test {
+protected:
+  tcp_server_test() {
+    publish_test_zone(_zones);
+    _options.port = 0;
+    _options.thread_count = 2;
+    _options.pin_threads = false;
+  }
+
+  tcp::socket connect(beryl::tcp_server& server) {
+    tcp::socket socket(_io);
+    socket.connect(
+        tcp::endpoint(asio::ip::make_address("127.0.0.1"), server.port()));
+    return socket;
+  }
+
+  beryl::zone_table _zones;
+  beryl::tcp_server_options _options;
+  asio::io_context _io;
+};
+}  // namespace
+
+TEST_F(tcp_server_test, pipelined_queries_are_answered) {
+  beryl::tcp_server server(_zones, _options);
+  server.start();
+  auto socket = connect(server);
+
+  // the queries go with one write, the last one split over two
+  std::string queries;
+  constexpr std::uint16_t query_count = 16;
+  for (std::uint16_t id = 0; id < query_count; ++id) {
+    queries += make_query(id, "www.test.");
+  }
+  std::string last = make_query(query_count, "www.test.");
+  queries += last.substr(0, 5);
+  asio::write(socket, asio::buffer(queries));
+  for (std::uint16_t id = 0; id < query_count; ++id) {
+    auto response = read_response(socket);
+    ASSERT_GT(response.size(), beryl::dns::header_size);
+    EXPECT_EQ(beryl::wire::get_uint16(response.data()), id);
+    EXPECT_EQ(beryl::wire::get_uint16(response.data() + 6), 1);
+  }
+  asio::write(socket, asio::buffer(last.substr(5)));
+  auto response = read_response(socket);
+  EXPECT_EQ(beryl::wire::get_uint16(response.data()), query_count);
+  server.stop();
+}
+
+TEST_F(tcp_server_test, large_response_is_not_truncated) {
+  beryl::tcp_server server(_zones, _options);
+  server.start();
+  auto socket = connect(server);
+
+  asio::write(socket, asio::buffer(make_query(1, "big.test.")));
+  auto response = read_response(socket);
+  ASSERT_GT(response.size(), beryl::dns::max_udp_size);
+  auto flags = beryl::wire::get_uint16(response.data() + 2);
+  EXPECT_EQ(flags & beryl::dns::flag_tc, 0);
+  EXPECT_EQ(beryl::wire::get_uint16(response.data() + 6), big_record_count);
+  server.stop();
+}
+
+TEST_F(tcp_server_test, queries_over_the_output_cap_wait) {
+  // a couple of large responses fill the cap
+  _options.max_pending_output = 2048;
+  beryl::tcp_server server(_zones, _options);
+  server.start();
+  auto socket = connect(server);
+
+  // the queries are sent before any response is read
+  std::string queries;
+  constexpr std::uint16_t query_count = 32;
+  for (std::uint16_t id = 0; id < query_count; ++id) {
+    queries += make_query(id, "big.test.");
+  }
+  asio::write(socket, asio::buffer(queries));
+  for (std::uint16_t id = 0; id < query_count; ++id) {
+    auto response = read_response(socket);
+    ASSERT_GT(response.size(), beryl::dns::header_size);
+    EXPECT_EQ(beryl::wire::get_uint16(response.data()), id);
+    EXPECT_EQ(beryl::wire::get_uint16(response.data() + 6), big_record_count);
+  }
+  server.stop();
+}
+
+TEST_F(tcp_server_test, idle_connection_is_closed) {
+  _options.idle_timeout = std::chrono::milliseconds(50);
+  beryl::tcp_server server(_zones, _options);
+  server.start();
+  auto socket = connect(server);
+
+  asio::write(socket, asio::buffer(make_query(1, "www.test.")));
+  read_response(socket);
+  std::array<char, 1> byte{};
+  boost::system::error_code ec;
+  asio::read(socket, asio::buffer(byte), ec);
+  EXPECT_EQ(ec, asio::error::eof);
+  server.stop();
+}
+
+TEST_F(tcp_server_test, connections_over_the_limit_wait) {
+  _options.thread_count = 1;
+  _options.max_connections = 1;
+  _options.idle_timeout = std::chrono::milliseconds(50);
+  beryl::tcp_server server(_zones, _options);
+  server.start();
+
+  // the second connection is accepted once the first one is closed
+  auto first = connect(server);
+  auto second = connect(server);
+  asio::write(second, asio::buffer(make_query(2, "www.test.")));
+  auto response = read_response(second);
+  EXPECT_EQ(beryl::wire::get_uint16(response.data()), 2);
+  server.stop();
+}
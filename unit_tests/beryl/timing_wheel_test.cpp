@@ -0,0 +1,62 @@
+#include "beryl/timing_wheel.hpp"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using beryl::timing_wheel;
+using beryl::chrono::seconds;
+using beryl::chrono::time_point;
+
+namespace {
+std::vector<int> advance(timing_wheel<int>& w, const time_point& now) {
+  std::vector<int> expired;
+  w.advance(now, [&expired](int v) { expired.push_back(v); });
+  return expired;
+}
+}  // namespace
+
+TEST(timing_wheel_test, empty) {
+  time_point start(seconds(1000));
+  timing_wheel<int> w(start);
+  EXPECT_TRUE(w.empty());
+  EXPECT_TRUE(advance(w, start + seconds(100)).empty());
+}
+
+TEST(timing_wheel_test, items_expire_in_order) {
+  time_point start(seconds(1000));
+  timing_wheel<int> w(start);
+  w.schedule(start + seconds(3), 3);
+  w.schedule(start + seconds(1), 1);
+  w.schedule(start + seconds(2), 2);
+  EXPECT_EQ(w.size(), 3);
+  EXPECT_TRUE(advance(w, start).empty());
+  EXPECT_EQ(advance(w, start + seconds(1)), std::vector<int>({1}));
+  EXPECT_EQ(advance(w, start + seconds(3)), std::vector<int>({2, 3}));
+  EXPECT_TRUE(w.empty());
+}
+
+TEST(timing_wheel_test, already_expired_item_fires_on_next_advance) {
+  time_point start(seconds(1000));
+  timing_wheel<int> w(start);
+  w.schedule(start - seconds(10), 42);
+  EXPECT_EQ(advance(w, start + seconds(1)), std::vector<int>({42}));
+}
+
+TEST(timing_wheel_test, items_are_cascaded_from_upper_levels) {
+  time_point start(seconds(1'000'000));
+  timing_wheel<int> w(start);
+  // Spread the items over all the levels and beyond the range of the wheel.
+  const std::vector<int> delays = {1,      63,      64,       65,      4095,
+                                   4096,   4097,    262143,   262144,  262145,
+                                   999999, 16777215, 16777216, 33554433};
+  for (auto d : delays) {
+    w.schedule(start + seconds(d), d);
+  }
+  for (auto d : delays) {
+    SCOPED_TRACE(d);
+    EXPECT_TRUE(advance(w, start + seconds(d - 1)).empty());
+    EXPECT_EQ(advance(w, start + seconds(d)), std::vector<int>({d}));
+  }
+  EXPECT_TRUE(w.empty());
+}
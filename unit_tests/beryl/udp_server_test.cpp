@@ -0,0 +1,244 @@
+#include "beryl/udp_server.hpp"
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <set>
+#include <system_error>
+#include <sstream>
+#include <string>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/ip/udp.hpp>
+
+#include <gtest/gtest.h>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/query_responder.hpp"
+#include "beryl/read_zone.hpp"
+#include "beryl/wire.hpp"
+#include "beryl/zone_image.hpp"
+#include "beryl/zone_table.hpp"
+
+#include "unit_testing/temp_file.hpp"
+
+namespace asio = boost::asio;
+using udp = asio::ip::udp;
+
+namespace {
+void publish_test_zone(beryl::zone_table& zones,
+                       const char* address = "192.0.2.1",
+                       bool prerender = false) {
+  std::istringstream is(
+      std::string("test. 60 IN SOA ns.test. al.test. 1 2 3 4 5\n"
+                  "www.test. 60 IN A ") +
+      address + "\n");
+  auto z = std::make_shared<beryl::zone>(beryl::domain_name("test."));
+  beryl::read_zone(is, *z);
+  if (prerender) {
+    beryl::prerender(*z);
+  }
+  zones.publish(std::move(z));
+}
+
+std::string make_query(std::uint16_t id) {
+  std::string query;
+  beryl::wire::put_uint16(query, id);
+  beryl::wire::put_uint16(query, 0);
+  beryl::wire::put_uint16(query, 1);
+  query.append(6, '\0');
+  beryl::wire::put_name(query, beryl::domain_name("www.test."));
+  beryl::wire::put_uint16(query, 1);
+  beryl::wire::put_uint16(query, beryl::dns::class_in);
+  return query;
+}
+}  // namespace
+
+TEST(udp_server_test, queries_are_answered_by_all_threads) {
+  beryl::zone_table zones;
+  publish_test_zone(zones);
+
+  beryl::udp_server_options options;
+  options.port = 0;
+  options.thread_count = 3;
+  options.pin_threads = false;
+  beryl::udp_server server(zones, options);
+  ASSERT_EQ(server.thread_count(), 3U);
+  ASSERT_NE(server.port(), 0);
+  server.start();
+
+  asio::io_context io;
+  udp::endpoint endpoint(asio::ip::make_address("127.0.0.1"), server.port());
+  // The kernel picks a socket by the client address, so several clients
+  // likely reach several threads.
+  for (std::uint16_t id = 0; id < 8; ++id) {
+    udp::socket client(io, udp::endpoint(udp::v4(), 0));
+    client.send_to(asio::buffer(make_query(id)), endpoint);
+
+    std::array<char, 512> response{};
+    udp::endpoint from;
+    auto size = client.receive_from(asio::buffer(response), from);
+    ASSERT_GT(size, beryl::dns::header_size);
+    EXPECT_EQ(beryl::wire::get_uint16(response.data()), id);
+    EXPECT_EQ(beryl::wire::get_uint16(response.data() + 6), 1);
+  }
+  server.stop();
+}
+
+TEST(udp_server_test, zone_image_is_served) {
+  std::istringstream is("test. 60 IN SOA ns.test. al.test. 1 2 3 4 5\n"
+                        "www.test. 60 IN A 192.0.2.1\n");
+  beryl::zone_image_writer writer;
+  beryl::read_zone(is, writer);
+  std::ostringstream image;
+  writer.write(image);
+  unit_testing::temp_file file(image.str());
+  beryl::zone_table zones;
+  zones.publish(beryl::open_zone_image(file.path()));
+
+  beryl::udp_server_options options;
+  options.port = 0;
+  options.thread_count = 1;
+  options.pin_threads = false;
+  beryl::udp_server server(zones, options);
+  server.start();
+
+  asio::io_context io;
+  udp::endpoint endpoint(asio::ip::make_address("127.0.0.1"), server.port());
+  udp::socket client(io, udp::endpoint(udp::v4(), 0));
+  client.send_to(asio::buffer(make_query(7)), endpoint);
+  std::array<char, 512> response{};
+  udp::endpoint from;
+  auto size = client.receive_from(asio::buffer(response), from);
+  server.stop();
+
+  ASSERT_GT(size, beryl::dns::header_size);
+  EXPECT_EQ(beryl::wire::get_uint16(response.data()), 7);
+  EXPECT_EQ(beryl::wire::get_uint16(response.data() + 2) &
+                beryl::dns::rcode_mask,
+            0);
+  EXPECT_EQ(beryl::wire::get_uint16(response.data() + 6), 1);
+  // the address ends the answer
+  EXPECT_EQ(std::string(response.data() + size - 4, 4),
+            std::string("\xC0\x00\x02\x01", 4));
+}
+
+TEST(udp_server_test, queries_are_answered_in_batches) {
+  beryl::zone_table zones;
+  publish_test_zone(zones);
+  beryl::udp_server_options options;
+  options.port = 0;
+  options.thread_count = 1;
+  options.pin_threads = false;
+  options.batch_size = 4;
+  beryl::udp_server server(zones, options);
+
+  asio::io_context io;
+  udp::endpoint endpoint(asio::ip::make_address("127.0.0.1"), server.port());
+  udp::socket client(io, udp::endpoint(udp::v4(), 0));
+  // The queries wait in the socket buffer, so the server takes them
+  // several at a time.
+  constexpr std::uint16_t query_count = 30;
+  for (std::uint16_t id = 0; id < query_count; ++id) {
+    client.send_to(asio::buffer(make_query(id)), endpoint);
+  }
+  client.send_to(asio::buffer(std::string("short")), endpoint);
+  server.start();
+
+  std::set<std::uint16_t> ids;
+  for (std::uint16_t i = 0; i < query_count; ++i) {
+    std::array<char, 512> response{};
+    udp::endpoint from;
+    auto size = client.receive_from(asio::buffer(response), from);
+    ASSERT_GT(size, beryl::dns::header_size);
+    ids.insert(beryl::wire::get_uint16(response.data()));
+  }
+  EXPECT_EQ(ids.size(), query_count);
+  server.stop();
+}
+
+TEST(udp_server_test, queries_are_answered_with_io_uring) {
+  beryl::zone_table zones;
+  publish_test_zone(zones);
+  beryl::udp_server_options options;
+  options.port = 0;
+  options.thread_count = 2;
+  options.pin_threads = false;
+  options.batch_size = 4;
+  options.engine = beryl::io_engine::io_uring;
+  std::optional<beryl::udp_server> server;
+  try {
+    server.emplace(zones, options);
+  } catch (const std::system_error& e) {
+    GTEST_SKIP() << e.what();
+  }
+
+  asio::io_context io;
+  udp::endpoint endpoint(asio::ip::make_address("127.0.0.1"), server->port());
+  udp::socket client(io, udp::endpoint(udp::v4(), 0));
+  // more queries than the slots of the responses and the buffers
+  constexpr std::uint16_t query_count = 30;
+  for (std::uint16_t id = 0; id < query_count; ++id) {
+    client.send_to(asio::buffer(make_query(id)), endpoint);
+  }
+  server->start();
+
+  std::set<std::uint16_t> ids;
+  for (std::uint16_t i = 0; i < query_count; ++i) {
+    std::array<char, 512> response{};
+    udp::endpoint from;
+    auto size = client.receive_from(asio::buffer(response), from);
+    ASSERT_GT(size, beryl::dns::header_size);
+    ids.insert(beryl::wire::get_uint16(response.data()));
+  }
+  EXPECT_EQ(ids.size(), query_count);
+  server->stop();
+}
+
+TEST(udp_server_test, prerendered_answers_are_gathered) {
+  for (auto engine : {beryl::io_engine::asio, beryl::io_engine::io_uring}) {
+    beryl::zone_table zones;
+    publish_test_zone(zones, "192.0.2.1", true);
+    beryl::udp_server_options options;
+    options.port = 0;
+    options.thread_count = 1;
+    options.pin_threads = false;
+    options.engine = engine;
+    std::optional<beryl::udp_server> server;
+    try {
+      server.emplace(zones, options);
+    } catch (const std::system_error& e) {
+      GTEST_SKIP() << e.what();
+    }
+    server->start();
+
+    asio::io_context io;
+    udp::endpoint endpoint(asio::ip::make_address("127.0.0.1"),
+                           server->port());
+    udp::socket client(io, udp::endpoint(udp::v4(), 0));
+    auto ask = [&](std::uint16_t id) {
+      client.send_to(asio::buffer(make_query(id)), endpoint);
+      std::array<char, 512> response{};
+      udp::endpoint from;
+      auto size = client.receive_from(asio::buffer(response), from);
+      return std::string(response.data(), size);
+    };
+    auto response = ask(1);
+    ASSERT_GT(response.size(), beryl::dns::header_size);
+    EXPECT_EQ(beryl::wire::get_uint16(response.data()), 1);
+    EXPECT_EQ(beryl::wire::get_uint16(response.data() + 6), 1);
+    EXPECT_EQ(response.substr(response.size() - 4),
+              std::string("\xc0\x00\x02\x01", 4));
+
+    // the new version of the zone is picked up once the responses
+    // referring to the old one are sent
+    publish_test_zone(zones, "192.0.2.2", true);
+    response = ask(2);
+    EXPECT_EQ(response.substr(response.size() - 4),
+              std::string("\xc0\x00\x02\x02", 4));
+    server->stop();
+  }
+}
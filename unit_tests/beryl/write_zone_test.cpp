@@ -0,0 +1,101 @@
+#include "beryl/write_zone.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#include <gtest/gtest.h>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/read_zone.hpp"
+#include "beryl/zone_table.hpp"
+
+#include "unit_testing/temp_file.hpp"
+
+using beryl::domain_name;
+using beryl::zone;
+
+namespace {
+std::string read_file(const std::string& path) {
+  std::ifstream is(path);
+  return std::string(std::istreambuf_iterator<char>(is),
+                     std::istreambuf_iterator<char>());
+}
+}  // namespace
+
+TEST(write_zone_test, master_file_text) {
+  unit_testing::temp_file zone_file(
+      "$ORIGIN movie.edu.\n"
+      "$TTL 3h\n"
+      "@ IN SOA toystory al ( 1 3h 1h 1w 1h )\n"
+      "@ IN NS toystory\n"
+      "toystory IN A 192.249.249.3\n"
+      "www 1h IN CNAME toystory\n"
+      "v6 IN AAAA 2001:db8::1\n"
+      "www.toystory IN PTR toystory\n");
+  zone z(domain_name("movie.edu."));
+  beryl::read_zone(zone_file.path(), z);
+
+  unit_testing::temp_file out("");
+  beryl::write_zone(z, out.path());
+  auto text = read_file(out.path());
+  EXPECT_EQ(text,
+            "movie.edu. 10800 IN SOA toystory.movie.edu. al.movie.edu. "
+            "1 10800 3600 604800 3600\n"
+            "movie.edu. 10800 IN NS toystory.movie.edu.\n"
+            "toystory.movie.edu. 10800 IN A 192.249.249.3\n"
+            "www.toystory.movie.edu. 10800 IN PTR toystory.movie.edu.\n"
+            "v6.movie.edu. 10800 IN AAAA 2001:db8::1\n"
+            "www.movie.edu. 3600 IN CNAME toystory.movie.edu.\n");
+
+  // the text reads back into the same zone
+  zone copy(domain_name("movie.edu."));
+  std::istringstream is(text);
+  beryl::read_zone(is, copy);
+  EXPECT_EQ(copy.record_count(), z.record_count());
+  unit_testing::temp_file copy_out("");
+  beryl::write_zone(copy, copy_out.path());
+  EXPECT_EQ(read_file(copy_out.path()), text);
+}
+
+TEST(write_zone_test, buffer_is_flushed_when_full) {
+  std::string zone_text = "test. 60 IN SOA ns.test. al.test. 1 2 3 4 5\n";
+  zone z(domain_name("test."));
+  {
+    std::string records = zone_text;
+    for (int i = 0; i < 1000; ++i) {
+      records += "host" + std::to_string(i) + ".test. 60 IN A 10.0.0.1\n";
+    }
+    std::istringstream is(records);
+    beryl::read_zone(is, z);
+  }
+
+  unit_testing::temp_file out("");
+  int fd = ::open(out.path().c_str(), O_WRONLY | O_TRUNC);
+  ASSERT_GE(fd, 0);
+  {
+    beryl::zone_writer writer(fd, 0);
+    const auto& records = z.records();
+    for (auto cur = records.begin(); cur != records.end(); cur.increment()) {
+      writer.write(cur.domain(), *cur.value());
+    }
+    writer.flush();
+  }
+  ::close(fd);
+  auto text = read_file(out.path());
+  EXPECT_EQ(std::count(text.begin(), text.end(), '\n'), 1001);
+  EXPECT_EQ(text.find(zone_text), 0U);
+}
+
+TEST(write_zone_test, unwritable_file) {
+  zone z(domain_name("test."));
+  EXPECT_THROW(beryl::write_zone(z, "/nonexistent/test.zone"),
+               std::system_error);
+}
@@ -0,0 +1,100 @@
+#include "beryl/zone_config.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "unit_testing/expect_throw_msg_eq.hpp"
+
+using beryl::read_zone_config;
+
+namespace {
+beryl::zone_config read(const char* text, const std::string& base = "") {
+  std::istringstream is(text);
+  return read_zone_config(is, base);
+}
+}  // namespace
+
+TEST(read_zone_config_test, named_conf) {
+  auto config = read(
+      "// BIND configuration file\n"
+      "options {\n"
+      "    directory \"/var/named\";\n"
+      "    listen-on port 8853 { 127.0.0.1; };\n"
+      "    listen-on-v6 {none;};\n"
+      "};\n"
+      "acl internal { 192.168.0.0/24; }; # trailing comment\n"
+      "/* a comment\n"
+      "   spanning lines */\n"
+      "zone \"movie.edu\" in {\n"
+      "    type master;\n"
+      "    file \"db.movie.edu\";\n"
+      "};\n"
+      "zone \"253.253.192.in-addr.arpa.\" IN {\n"
+      "    type primary; file \"/zones/db.192.253.253\";\n"
+      "};\n"
+      "zone \"example.com\" { type slave; file \"db.example\"; };\n"
+      "zone \".\" in {\n"
+      "    type hint;\n"
+      "    file \"db.cache\";\n"
+      "};\n"
+      "zone \"bind\" chaos { type master; file \"db.bind\"; };\n");
+  ASSERT_EQ(config.zones.size(), 2U);
+  EXPECT_EQ(config.zones[0].name, "movie.edu.");
+  EXPECT_EQ(config.zones[0].file, "/var/named/db.movie.edu");
+  EXPECT_EQ(config.zones[1].name, "253.253.192.in-addr.arpa.");
+  EXPECT_EQ(config.zones[1].file, "/zones/db.192.253.253");
+}
+
+TEST(read_zone_config_test, relative_paths) {
+  auto config = read(
+      "zone \"a.test\" { type master; file \"db.a\"; };\n", "/etc/beryl");
+  ASSERT_EQ(config.zones.size(), 1U);
+  EXPECT_EQ(config.zones[0].file, "/etc/beryl/db.a");
+
+  config = read(
+      "options { directory \"zones\"; };\n"
+      "zone \"a.test\" { type master; file \"db.a\"; };\n",
+      "/etc/beryl/");
+  ASSERT_EQ(config.zones.size(), 1U);
+  EXPECT_EQ(config.zones[0].file, "/etc/beryl/zones/db.a");
+
+  config = read("zone \"a.test\" { type master; file \"db.a\"; };\n");
+  ASSERT_EQ(config.zones.size(), 1U);
+  EXPECT_EQ(config.zones[0].file, "db.a");
+}
+
+TEST(read_zone_config_test, invalid_config) {
+  EXPECT_THROW_MSG_EQ(read("options {\n directory \"x\";\n"),
+                      std::runtime_error,
+                      "line 3: unexpected end, `}` expected");
+  EXPECT_THROW_MSG_EQ(read("options { };\n};\n"), std::runtime_error,
+                      "line 2: unexpected `}`");
+  EXPECT_THROW_MSG_EQ(read("options { } zone"), std::runtime_error,
+                      "line 1: `;` expected after `}`");
+  EXPECT_THROW_MSG_EQ(read("\n\"movie.edu"), std::runtime_error,
+                      "line 2: unterminated string");
+  EXPECT_THROW_MSG_EQ(read("/* options"), std::runtime_error,
+                      "line 1: unterminated comment");
+  EXPECT_THROW_MSG_EQ(read("zone \"a.test\" { file \"db.a\"; };"),
+                      std::runtime_error, "line 1: zone `a.test.` has no type");
+  EXPECT_THROW_MSG_EQ(read("zone \"a.test\" { type master; };"),
+                      std::runtime_error, "line 1: zone `a.test.` has no file");
+  EXPECT_THROW_MSG_EQ(read("zone \"a..test\" { type master; };"),
+                      std::runtime_error,
+                      "line 1: invalid zone name `a..test`");
+  EXPECT_THROW_MSG_EQ(read("zone \"a.test\";"), std::runtime_error,
+                      "line 1: `zone \"<name>\" [<class>] { ... };` expected");
+  EXPECT_THROW_MSG_EQ(read("zone \"a.test\" { type master file x; };"),
+                      std::runtime_error, "line 1: `type` takes one argument");
+  EXPECT_THROW_MSG_EQ(read("zone \"a.test\" { type master; file \"a\"; };\n"
+                           "zone \"A.test.\" { type master; file \"b\"; };"),
+                      std::runtime_error, "line 2: duplicate zone `A.test.`");
+}
+
+TEST(read_zone_config_test, file_not_found) {
+  EXPECT_THROW_MSG_EQ(read_zone_config("/nonexistent/named.conf"),
+                      std::runtime_error,
+                      "can't open `/nonexistent/named.conf`");
+}
@@ -0,0 +1,197 @@
+#include "beryl/zone_image.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/crc.hpp>
+#include <gtest/gtest.h>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/read_zone.hpp"
+#include "beryl/record_consumer.hpp"
+#include "beryl/record_visitor.hpp"
+#include "beryl/resource_record.hpp"
+#include "beryl/wire.hpp"
+
+#include "unit_testing/expect_throw_msg_eq.hpp"
+#include "unit_testing/temp_file.hpp"
+
+using beryl::domain_name;
+using beryl::record_type;
+using beryl::resource_record_ptr;
+using beryl::zone_image;
+using beryl::zone_image_writer;
+
+namespace {
+class visitor_x final : public beryl::record_visitor {
+public:
+  explicit visitor_x(std::ostream& os) : _os(os) {}
+  void visit_record_begin() final {}
+  void visit_record_end() final {}
+  void visit(beryl::record_class rc) final { _os << ' ' << rc; }
+  void visit(beryl::record_type rt) final { _os << ' ' << rt; }
+  void visit(std::uint32_t ui) final { _os << ' ' << ui; }
+  void visit(const domain_name& str) final { _os << ' ' << str; }
+  void visit(boost::asio::ip::address_v4 addr) final { _os << ' ' << addr; }
+  void visit(const boost::asio::ip::address_v6& addr) final {
+    _os << ' ' << addr;
+  }
+
+private:
+  std::ostream& _os;
+};
+
+// Collects the records as sorted lines of text.
+class consumer_x final : public beryl::record_consumer {
+public:
+  void consume_zone_begin() final {}
+  void consume_zone_end() final {}
+  void consume(domain_name&& name, resource_record_ptr rr) final {
+    std::ostringstream s;
+    visitor_x v(s);
+    s << name;
+    rr->accept(v);
+    _records.push_back(s.str());
+  }
+
+  std::vector<std::string> records() const {
+    auto result = _records;
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+private:
+  std::vector<std::string> _records;
+};
+
+const char* const zone =
+    "$TTL 3h\n"
+    "movie.edu. IN SOA terminator.movie.edu. al.robocop.movie.edu. (\n"
+    "                  1 3h 1h 1w 1h )\n"
+    "movie.edu.  IN NS  terminator.movie.edu.\n"
+    "@           IN NS  wormhole\n"
+    "robocop     IN A     192.249.249.2\n"
+    "terminator  IN A     192.249.249.3\n"
+    "wormhole    IN A     192.249.249.1\n"
+    "            IN A     192.253.253.1\n"
+    "            1d IN AAAA 2001:db8::1\n"
+    "bigt        IN CNAME terminator\n"
+    "$ORIGIN 249.249.192.in-addr.arpa.\n"
+    "1 IN PTR wormhole.movie.edu.\n";
+
+std::string compile(const std::string& zone_text) {
+  std::istringstream is(zone_text);
+  zone_image_writer writer;
+  beryl::read_zone(is, writer);
+  std::ostringstream os;
+  writer.write(os);
+  return os.str();
+}
+}  // namespace
+
+TEST(zone_image_test, records_survive_compilation) {
+  consumer_x parsed;
+  std::istringstream is(zone);
+  beryl::read_zone(is, parsed);
+
+  unit_testing::temp_file f(compile(zone));
+  zone_image image(f.path());
+  EXPECT_EQ(10U, image.record_count());
+  consumer_x loaded;
+  image.read(loaded);
+  EXPECT_EQ(parsed.records(), loaded.records());
+}
+
+TEST(zone_image_test, rrsets_are_found) {
+  unit_testing::temp_file f(compile(zone));
+  zone_image image(f.path());
+
+  auto wormhole =
+      image.find(domain_name("wormhole.movie.edu."), record_type::a);
+  ASSERT_TRUE(wormhole);
+  EXPECT_EQ(record_type::a, wormhole->type());
+  EXPECT_EQ(2U, wormhole->size());
+  std::vector<std::string> addresses;
+  wormhole->for_each([&addresses](const zone_image::record& r) {
+    EXPECT_EQ(10800U, r.ttl);
+    addresses.emplace_back(r.rdata);
+  });
+  EXPECT_EQ((std::vector<std::string>{"\xC0\xF9\xF9\x01", "\xC0\xFD\xFD\x01"}),
+            addresses);
+
+  auto ns = image.find(domain_name("movie.edu."), record_type::ns);
+  ASSERT_TRUE(ns);
+  EXPECT_EQ(2U, ns->size());
+  ns->for_each([](const zone_image::record& r) {
+    EXPECT_EQ(r.rdata.size(), beryl::wire::name_length(r.rdata));
+  });
+
+  EXPECT_FALSE(image.find(domain_name("wormhole.movie.edu."), record_type::ns));
+  EXPECT_FALSE(image.find(domain_name("edu."), record_type::ns));
+  EXPECT_FALSE(image.find(domain_name("x.movie.edu."), record_type::a));
+  EXPECT_FALSE(image.find(domain_name("movie.org."), record_type::soa));
+}
+
+TEST(zone_image_test, empty_image_is_ok) {
+  std::ostringstream os;
+  zone_image_writer().write(os);
+  unit_testing::temp_file f(os.str());
+  zone_image image(f.path());
+  EXPECT_EQ(0U, image.record_count());
+  EXPECT_FALSE(image.find(domain_name("."), record_type::soa));
+}
+
+TEST(zone_image_test, corrupted_image_is_not_ok) {
+  auto good = compile(zone);
+  auto expect_invalid = [](const std::string& content, const char* msg) {
+    unit_testing::temp_file f(content);
+    EXPECT_THROW_MSG_EQ(zone_image(f.path()), std::runtime_error,
+                        ("invalid zone image `" + f.path() + "`: " + msg)
+                            .c_str());
+  };
+  expect_invalid("", "not a zone image");
+  expect_invalid("BERYLZIM", "not a zone image");
+  expect_invalid("X" + good.substr(1), "not a zone image");
+
+  auto bad_version = good;
+  bad_version[zone_image::magic.size() + 3] = 2;
+  expect_invalid(bad_version, "unsupported version");
+
+  expect_invalid(good.substr(0, good.size() - 1), "truncated");
+
+  auto flipped = good;
+  flipped.back() = static_cast<char>(flipped.back() ^ 1);
+  expect_invalid(flipped, "checksum mismatch");
+
+  // The checksum matches but the structure doesn't.
+  auto restamped = [&good](const std::string& payload) {
+    boost::crc_32_type crc;
+    crc.process_bytes(payload.data(), payload.size());
+    std::string image = good.substr(0, zone_image::header_size);
+    std::string checksum;
+    beryl::wire::put_uint32(checksum, crc.checksum());
+    image.replace(zone_image::magic.size() + 4, checksum.size(), checksum);
+    return image + payload;
+  };
+  auto payload = good.substr(zone_image::header_size);
+  unit_testing::temp_file restamped_good(restamped(payload));
+  EXPECT_NO_THROW(zone_image(restamped_good.path()));
+  auto corrupt = [&payload, &restamped](std::size_t offset,
+                                        std::string_view bytes) {
+    auto corrupted = payload;
+    return restamped(corrupted.replace(offset, bytes.size(), bytes));
+  };
+  // the child count of the root
+  expect_invalid(corrupt(1, "\xff\xff\xff\xff"), "malformed");
+  // the offset of the first child of the root
+  expect_invalid(corrupt(9, "\x7f\xff\xff\xff"), "malformed");
+  // the data length of the last record, the AAAA one of wormhole
+  expect_invalid(corrupt(payload.size() - 18, "\xff\xff"), "malformed");
+  // the record count in the header
+  auto miscounted = restamped(payload);
+  ++miscounted[zone_image::magic.size() + 15];
+  expect_invalid(miscounted, "malformed");
+}
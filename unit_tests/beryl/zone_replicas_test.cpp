@@ -0,0 +1,164 @@
+#include "beryl/zone_replicas.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/query_responder.hpp"
+#include "beryl/read_zone.hpp"
+#include "beryl/server_thread.hpp"
+#include "beryl/wire.hpp"
+#include "beryl/zone_table.hpp"
+
+using beryl::domain_name;
+using beryl::zone;
+using beryl::zone_replicas;
+using beryl::zone_table;
+namespace impl = beryl::_impl;
+
+namespace {
+std::shared_ptr<zone> read_movie_edu(const char* address) {
+  std::istringstream is(std::string("$ORIGIN movie.edu.\n"
+                                    "$TTL 1h\n"
+                                    "@ IN SOA ns al 1 3h 1h 1w 1h\n"
+                                    "@ IN NS ns\n"
+                                    "ns IN A 192.249.249.1\n"
+                                    "www IN A ") +
+                        address + "\n");
+  auto z = std::make_shared<zone>(domain_name("movie.edu."));
+  beryl::read_zone(is, *z);
+  return z;
+}
+
+// two nodes on the CPUs of the first one, as the test may run on a single
+// node machine
+std::vector<impl::numa_node> two_nodes() {
+  auto cpus = impl::numa_nodes().front().cpus;
+  return {impl::numa_node{0, cpus}, impl::numa_node{1, cpus}};
+}
+}  // namespace
+
+TEST(zone_replicas_test, zones_are_copied_to_every_node) {
+  zone_table zones;
+  auto z = read_movie_edu("192.249.249.2");
+  beryl::prerender(*z);
+  zones.publish(z);
+  zone_replicas replicas(zones, two_nodes());
+  ASSERT_EQ(replicas.nodes().size(), 2U);
+
+  std::vector<std::shared_ptr<const zone>> copies;
+  for (std::size_t i = 0; i < replicas.nodes().size(); ++i) {
+    auto copy = replicas.replica(i).find(domain_name("www.movie.edu."));
+    ASSERT_NE(copy, nullptr);
+    EXPECT_NE(copy, z);
+    EXPECT_EQ(copy->origin(), z->origin());
+    EXPECT_EQ(copy->record_count(), z->record_count());
+    ASSERT_NE(copy->templates(), nullptr);
+    EXPECT_EQ(copy->templates()->size(), z->templates()->size());
+    // the records are copied too
+    auto record = copy->records().find(domain_name("www.movie.edu."));
+    ASSERT_NE(record, copy->records().end());
+    EXPECT_NE(record.value(),
+              z->records().find(domain_name("www.movie.edu.")).value());
+    copies.push_back(std::move(copy));
+  }
+  EXPECT_NE(copies[0], copies[1]);
+
+  // the copies answer as the zone does
+  beryl::query_responder responder(zones, 0);
+  beryl::query_responder replica_responder(replicas.replica(1), 0);
+  std::string query;
+  beryl::wire::put_uint16(query, 1);
+  beryl::wire::put_uint16(query, 0);
+  beryl::wire::put_uint16(query, 1);
+  query.append(6, '\0');
+  beryl::wire::put_name(query, domain_name("www.movie.edu."));
+  beryl::wire::put_uint16(query, 1);
+  beryl::wire::put_uint16(query, beryl::dns::class_in);
+  std::string expected;
+  std::string response;
+  ASSERT_TRUE(responder.respond(query, expected));
+  ASSERT_TRUE(replica_responder.respond(query, response));
+  EXPECT_EQ(response, expected);
+}
+
+TEST(zone_replicas_test, published_zones_are_copied_on_update) {
+  zone_table zones;
+  zones.publish(read_movie_edu("192.249.249.2"));
+  zones.publish(std::make_shared<zone>(domain_name("edu.")));
+  zone_replicas replicas(zones, two_nodes());
+  auto edu = replicas.replica(0).find(domain_name("edu."));
+  auto movie_edu = replicas.replica(0).find(domain_name("movie.edu."));
+
+  // nothing is published, nothing is copied
+  replicas.update();
+  EXPECT_EQ(replicas.replica(0).find(domain_name("movie.edu.")), movie_edu);
+
+  zones.publish(read_movie_edu("192.249.249.3"));
+  zones.publish(std::make_shared<zone>(domain_name("org.")));
+  replicas.update();
+  for (std::size_t i = 0; i < replicas.nodes().size(); ++i) {
+    EXPECT_EQ(replicas.replica(i).size(), 3U);
+    EXPECT_NE(replicas.replica(i).find(domain_name("org.")), nullptr);
+  }
+  EXPECT_NE(replicas.replica(0).find(domain_name("movie.edu.")), movie_edu);
+  EXPECT_EQ(replicas.replica(0).find(domain_name("edu.")), edu);
+}
+
+TEST(zone_replicas_test, numa_topology) {
+  auto nodes = impl::numa_nodes();
+  ASSERT_FALSE(nodes.empty());
+  for (const auto& node : nodes) {
+    EXPECT_FALSE(node.cpus.empty());
+  }
+
+  EXPECT_EQ(impl::parse_cpu_list("0-3,8,10-11\n"),
+            (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(impl::parse_cpu_list(""), std::vector<int>{});
+  EXPECT_EQ(impl::parse_cpu_list("3-1"), std::vector<int>{});
+  EXPECT_EQ(impl::parse_cpu_list("0,x"), std::vector<int>{});
+
+  // the threads take turns over the nodes
+  std::vector<impl::numa_node> two{{0, {0, 1}}, {1, {2, 3}}};
+  auto placements = impl::place_workers(two, 0);
+  ASSERT_EQ(placements.size(), 4U);
+  std::vector<int> cpus;
+  std::vector<std::size_t> node_indices;
+  for (const auto& p : placements) {
+    cpus.push_back(p.cpu);
+    node_indices.push_back(p.node);
+  }
+  EXPECT_EQ(cpus, (std::vector<int>{0, 2, 1, 3}));
+  EXPECT_EQ(node_indices, (std::vector<std::size_t>{0, 1, 0, 1}));
+  // more threads than CPUs share them
+  EXPECT_EQ(impl::place_workers(two, 6)[4].cpu, 0);
+
+  // uneven nodes, e.g. under a cpuset, take threads by their CPUs
+  std::vector<impl::numa_node> uneven{{0, {0, 1, 2, 3, 4, 5, 6, 7}},
+                                      {1, {8, 9}}};
+  auto cpus_on = [](const std::vector<impl::worker_placement>& placements,
+                     std::size_t node) {
+    std::vector<int> on_node;
+    for (const auto& p : placements) {
+      if (p.node == node) {
+        on_node.push_back(p.cpu);
+      }
+    }
+    std::sort(on_node.begin(), on_node.end());
+    return on_node;
+  };
+  placements = impl::place_workers(uneven, 0);
+  EXPECT_EQ(placements.size(), 10U);
+  EXPECT_EQ(cpus_on(placements, 0), uneven[0].cpus);
+  EXPECT_EQ(cpus_on(placements, 1), uneven[1].cpus);
+  placements = impl::place_workers(uneven, 5);
+  EXPECT_EQ(cpus_on(placements, 0), (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_EQ(cpus_on(placements, 1), std::vector<int>{8});
+  placements = impl::place_workers(uneven, 1);
+  EXPECT_EQ(cpus_on(placements, 0), std::vector<int>{0});
+}
@@ -0,0 +1,227 @@
+#include "beryl/zone_table.hpp"
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "beryl/domain_name.hpp"
+#include "beryl/read_zone.hpp"
+#include "beryl/record_type.hpp"
+#include "beryl/zone_config.hpp"
+#include "beryl/zone_image.hpp"
+
+#include "unit_testing/temp_file.hpp"
+
+using beryl::domain_name;
+using beryl::zone;
+using beryl::zone_table;
+
+TEST(zone_table_test, closest_enclosing_zone) {
+  zone_table table;
+  EXPECT_EQ(table.find(domain_name("www.movie.edu.")), nullptr);
+
+  table.publish(std::make_shared<zone>(domain_name("edu.")));
+  table.publish(std::make_shared<zone>(domain_name("movie.edu.")));
+  EXPECT_EQ(table.size(), 2U);
+
+  auto z = table.find(domain_name("www.movie.edu."));
+  ASSERT_NE(z, nullptr);
+  EXPECT_EQ(z->origin(), domain_name("movie.edu."));
+  z = table.find(domain_name("movie.edu."));
+  ASSERT_NE(z, nullptr);
+  EXPECT_EQ(z->origin(), domain_name("movie.edu."));
+  z = table.find(domain_name("berkeley.edu."));
+  ASSERT_NE(z, nullptr);
+  EXPECT_EQ(z->origin(), domain_name("edu."));
+  EXPECT_EQ(table.find(domain_name("example.com.")), nullptr);
+
+  table.publish(std::make_shared<zone>(domain_name(".")));
+  z = table.find(domain_name("example.com."));
+  ASSERT_NE(z, nullptr);
+  EXPECT_EQ(z->origin(), domain_name("."));
+}
+
+TEST(zone_table_test, republished_zone_replaces_the_old_one) {
+  zone_table table;
+  auto old_zone = std::make_shared<zone>(domain_name("movie.edu."));
+  table.publish(old_zone);
+  auto found = table.find(domain_name("www.movie.edu."));
+  table.publish(std::make_shared<zone>(domain_name("movie.edu.")));
+  EXPECT_EQ(table.size(), 1U);
+  EXPECT_NE(table.find(domain_name("www.movie.edu.")), old_zone);
+  // the zone found before stays alive
+  EXPECT_EQ(found, old_zone);
+}
+
+TEST(load_zones_test, zones_are_loaded_concurrently) {
+  unit_testing::temp_file movie(
+      "$TTL 3h\n"
+      "@ IN SOA ns.movie.edu. al.movie.edu. 1 3h 1h 1w 1h\n"
+      "@ IN NS ns\n"
+      "ns IN A 192.249.249.1\n"
+      "www IN A 192.249.249.2\n");
+  unit_testing::temp_file broken(
+      "example.com. 1h IN SOA ns.example.com. al.example.com. 1 3h 1h 1w 1h\n"
+      "www 1h IN A 300.1.1.1\n");
+  unit_testing::temp_file small(
+      "test. 1h IN SOA ns.test. al.test. 1 3h 1h 1w 1h\n");
+  std::vector<beryl::zone_config_entry> zones{
+      {"movie.edu.", movie.path()},
+      {"example.com.", broken.path()},
+      {"test.", small.path()},
+      {"missing.", "/nonexistent/db.missing"}};
+
+  zone_table table;
+  auto errors = beryl::load_zones(zones, table, 3);
+  ASSERT_EQ(errors.size(), 2U);
+  EXPECT_EQ(errors[0].zone, "example.com.");
+  EXPECT_EQ(errors[1].zone, "missing.");
+
+  EXPECT_EQ(table.size(), 2U);
+  auto z = table.find(domain_name("www.movie.edu."));
+  ASSERT_NE(z, nullptr);
+  EXPECT_EQ(z->record_count(), 4U);
+  EXPECT_NE(z->records().find(domain_name("www.movie.edu.")),
+            z->records().end());
+  z = table.find(domain_name("test."));
+  ASSERT_NE(z, nullptr);
+  EXPECT_EQ(z->record_count(), 1U);
+  EXPECT_EQ(table.find(domain_name("www.example.com.")), nullptr);
+}
+
+TEST(load_zones_test, zone_without_apex_soa_is_not_loaded) {
+  unit_testing::temp_file other(
+      "$TTL 1h\n"
+      "movie.org. IN SOA ns.movie.org. al.movie.org. 1 3h 1h 1w 1h\n"
+      "www.movie.edu. IN A 192.249.249.2\n");
+  std::vector<beryl::zone_config_entry> zones{{"movie.edu.", other.path()}};
+
+  zone_table table;
+  auto errors = beryl::load_zones(zones, table, 1);
+  ASSERT_EQ(errors.size(), 1U);
+  EXPECT_EQ(errors[0].zone, "movie.edu.");
+  EXPECT_EQ(errors[0].message, "no SOA record at the apex `movie.edu.`");
+  EXPECT_EQ(table.size(), 0U);
+
+  EXPECT_THROW(beryl::reload_zone(table, zones[0]), std::runtime_error);
+  EXPECT_EQ(table.size(), 0U);
+}
+
+namespace {
+std::vector<std::string> to_strings(const std::vector<beryl::zone_change>& v) {
+  std::vector<std::string> result;
+  for (const auto& change : v) {
+    result.push_back(to_string(change.owner) + " " +
+                     std::string(to_string(change.record->type())) + " " +
+                     std::to_string(change.record->ttl()));
+  }
+  return result;
+}
+}  // namespace
+
+TEST(zone_diff_test, reload_applies_the_changes_only) {
+  unit_testing::temp_file old_version(
+      "$TTL 1h\n"
+      "@ IN SOA ns.movie.edu. al.movie.edu. 1 3h 1h 1w 1h\n"
+      "@ IN NS ns\n"
+      "ns IN A 192.249.249.1\n"
+      "www IN A 192.249.249.2\n"
+      "ftp IN A 192.249.249.3\n"
+      "old.ftp IN A 192.249.249.4\n");
+  unit_testing::temp_file new_version(
+      "$TTL 1h\n"
+      "@ IN SOA ns.movie.edu. al.movie.edu. 2 3h 1h 1w 1h\n"
+      "www IN A 192.249.249.2\n"
+      "www IN A 192.249.249.20\n"
+      "@ IN NS ns\n"
+      "ns 2h IN A 192.249.249.1\n"
+      "ftp IN A 192.249.249.3\n"
+      "new IN AAAA ::1\n");
+  zone_table table;
+  beryl::zone_config_entry entry{"movie.edu.", new_version.path()};
+  auto old_zone = std::make_shared<zone>(domain_name("movie.edu."));
+  beryl::read_zone(old_version.path(), "movie.edu.", *old_zone);
+  ASSERT_EQ(old_zone->record_count(), 6U);
+  table.publish(old_zone);
+
+  auto diff = beryl::reload_zone(table, entry);
+  EXPECT_EQ(to_strings(diff.removed),
+            std::vector<std::string>({".edu.movie SOA 3600",
+                                      ".edu.movie.ftp.old A 3600",
+                                      ".edu.movie.ns A 3600"}));
+  EXPECT_EQ(to_strings(diff.added),
+            std::vector<std::string>({".edu.movie SOA 3600",
+                                      ".edu.movie.new AAAA 3600",
+                                      ".edu.movie.ns A 7200",
+                                      ".edu.movie.www A 3600"}));
+
+  auto z = table.find(domain_name("movie.edu."));
+  ASSERT_NE(z, old_zone);
+  EXPECT_EQ(z->record_count(), 7U);
+  EXPECT_EQ(z->records().find(domain_name("old.ftp.movie.edu.")),
+            z->records().end());
+  EXPECT_NE(z->records().find(domain_name("new.movie.edu.")),
+            z->records().end());
+  // the records not changed are shared
+  auto ftp = z->records().find(domain_name("ftp.movie.edu."));
+  ASSERT_NE(ftp, z->records().end());
+  EXPECT_EQ(ftp.value(),
+            old_zone->records().find(domain_name("ftp.movie.edu.")).value());
+
+  // the version being read is left as it was
+  EXPECT_EQ(old_zone->record_count(), 6U);
+  EXPECT_NE(old_zone->records().find(domain_name("old.ftp.movie.edu.")),
+            old_zone->records().end());
+  EXPECT_EQ(old_zone->records().find(domain_name("new.movie.edu.")),
+            old_zone->records().end());
+  std::size_t www_count = 0;
+  for (auto cur = old_zone->records().find(domain_name("www.movie.edu."));
+       cur != old_zone->records().end() &&
+       cur.domain() == domain_name("www.movie.edu.");
+       cur.increment()) {
+    ++www_count;
+  }
+  EXPECT_EQ(www_count, 1U);
+
+  // reloading the same version changes nothing
+  EXPECT_TRUE(beryl::reload_zone(table, entry).empty());
+  EXPECT_EQ(table.find(domain_name("movie.edu.")), z);
+
+  // a zone not published yet is loaded
+  beryl::zone_config_entry other{"movie.org.", new_version.path()};
+  EXPECT_EQ(beryl::reload_zone(table, other).added.size(), 7U);
+  auto org = table.find(domain_name("movie.org."));
+  ASSERT_NE(org, nullptr);
+  EXPECT_EQ(org->origin(), domain_name("movie.org."));
+  EXPECT_EQ(org->record_count(), 7U);
+}
+
+TEST(zone_diff_test, reload_leaves_zone_images) {
+  std::istringstream is("movie.edu. 60 IN SOA ns.movie.edu. al.movie.edu. "
+                        "1 2 3 4 5\n"
+                        "www.movie.edu. 60 IN A 192.249.249.2\n");
+  beryl::zone_image_writer writer;
+  beryl::read_zone(is, writer);
+  std::ostringstream image;
+  writer.write(image);
+  unit_testing::temp_file image_file(image.str());
+  unit_testing::temp_file zone_file(
+      "$TTL 1h\n"
+      "@ IN SOA ns.movie.edu. al.movie.edu. 2 3h 1h 1w 1h\n"
+      "ftp IN A 192.249.249.3\n");
+  zone_table table;
+  auto z = beryl::open_zone_image(image_file.path());
+  table.publish(z);
+
+  beryl::zone_config_entry entry{"movie.edu.", zone_file.path()};
+  EXPECT_TRUE(beryl::reload_zone(table, entry).empty());
+  auto served = table.find(domain_name("movie.edu."));
+  ASSERT_EQ(served, z);
+  ASSERT_NE(served->image(), nullptr);
+  EXPECT_TRUE(served->image()->find(domain_name("www.movie.edu."),
+                                    beryl::record_type::a));
+}